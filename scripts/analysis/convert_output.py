@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+
+import argparse
+import glob
+import os
+import struct
+
+OUTPUT_MAGIC = 0x54554F534D494F4C  # "LOIMSOUT"
+OUTPUT_VERSION = 3
+HEADER_FORMAT = "<QIIIId"
+LABEL_LENGTH_FORMAT = "<I"
+# Each entry in the per-day index written alongside collective output files
+INDEX_FORMAT = struct.Struct("<iIQQ")
+# Record formats and CSV columns for each output stream, in the same order
+# as OutputStream in src/writers/OutputWriter.h
+STREAMS = [
+    (
+        "exposures",
+        "<iqqiid",
+        "tick,sus_pid,inf_pid,start_time,end_time,propensity",
+    ),
+    ("transitions", "<iqiqi", "tick,pid,exit_state,contact_pid,contact_start"),
+    (
+        "interactions",
+        "<iqqiiqii",
+        "tick,lid,pid,start_time,end_time,other_pid,other_start_time,"
+        + "other_end_time",
+    ),
+]
+TRANSITION_STREAM = 1
+EXIT_STATE_COL = 2
+CHUNK_SIZE = 1 << 16  # records
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Converts the binary output files written by Loimos "
+        + "when built with OUTPUT_FLAGS into CSV files"
+    )
+
+    # Positional/required arguments:
+    parser.add_argument(
+        "in_dir",
+        metavar="I",
+        help="The output directory passed to Loimos",
+    )
+
+    # Named/optional arguments:
+    parser.add_argument(
+        "-o",
+        "--out-dir",
+        default=None,
+        help="The directory in which to save the CSV files. If this argument "
+        + "is not specified, they will be saved in the input directory",
+    )
+    parser.add_argument(
+        "-m",
+        "--merge",
+        action="store_true",
+        help="Write a single CSV file for each type of output, rather than "
+        + "one per input file",
+    )
+    parser.add_argument(
+        "-d",
+        "--days",
+        type=int,
+        nargs="+",
+        default=None,
+        help="Only convert the records from these days. This requires the "
+        + "outputs to have been written with --collective-output",
+    )
+
+    return parser.parse_args()
+
+
+def read_header(in_file, path):
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, stream, record_size, num_labels, weight = struct.unpack(
+        HEADER_FORMAT, in_file.read(header_size)
+    )
+    if OUTPUT_MAGIC != magic:
+        raise ValueError(f"{path} is not a Loimos output file")
+    if OUTPUT_VERSION != version:
+        raise ValueError(f"{path} was written by an incompatible Loimos version")
+
+    labels = []
+    for _ in range(num_labels):
+        (length,) = struct.unpack(
+            LABEL_LENGTH_FORMAT,
+            in_file.read(struct.calcsize(LABEL_LENGTH_FORMAT)),
+        )
+        labels.append(in_file.read(length).decode())
+
+    return stream, record_size, labels, weight
+
+
+def get_columns(path, columns):
+    """
+    Returns the CSV header for the output file at path, which has an extra
+    weight column if the file holds a sample of the records
+    """
+    with open(path, "rb") as in_file:
+        _, _, _, weight = read_header(in_file, path)
+    return columns if 1.0 == weight else columns + ",weight"
+
+
+def read_index(path):
+    """
+    Returns a dict mapping each day to the offset and number of its records
+    in the collective output file the index at path belongs to
+    """
+    with open(path, "rb") as index_file:
+        data = index_file.read()
+    return {
+        day: (offset, num_records)
+        for day, _, offset, num_records in INDEX_FORMAT.iter_unpack(data)
+    }
+
+
+def get_ranges(path, in_file, record_size, days):
+    """
+    Yields the (offset, size) of each range of bytes to convert from the
+    output file at path
+    """
+    if days is None:
+        yield in_file.tell(), None
+        return
+
+    index_path = os.path.splitext(path)[0] + ".index"
+    if not os.path.exists(index_path):
+        raise ValueError(f"{path} has no index, so can't be read by day")
+    index = read_index(index_path)
+    for day in days:
+        if day in index:
+            offset, num_records = index[day]
+            yield offset, num_records * record_size
+
+
+def convert(path, out_file, days=None):
+    """
+    Appends the records in the binary output file at path to out_file as
+    CSV rows, returning the number of records converted
+    """
+    num_records = 0
+    with open(path, "rb") as in_file:
+        stream, record_size, labels, weight = read_header(in_file, path)
+        record_format = struct.Struct(STREAMS[stream][1])
+        if record_format.size != record_size:
+            raise ValueError(
+                f"{path} has {record_size} byte records, expected "
+                + f"{record_format.size}"
+            )
+
+        for offset, size in get_ranges(path, in_file, record_size, days):
+            in_file.seek(offset)
+            num_records += convert_range(
+                in_file, out_file, stream, record_format, labels, weight, size
+            )
+
+    return num_records
+
+
+def convert_range(in_file, out_file, stream, record_format, labels, weight, size):
+    """
+    Converts size bytes of records (or everything up to the end of the file
+    if size is None) starting at the current position in in_file
+    """
+    suffix = "" if 1.0 == weight else f",{weight}"
+    num_records = 0
+    while size is None or 0 < size:
+        chunk_size = CHUNK_SIZE * record_format.size
+        if size is not None:
+            chunk_size = min(chunk_size, size)
+            size -= chunk_size
+        chunk = in_file.read(chunk_size)
+        if not chunk:
+            break
+        rows = []
+        for record in record_format.iter_unpack(chunk):
+            if TRANSITION_STREAM == stream:
+                record = list(record)
+                record[EXIT_STATE_COL] = labels[record[EXIT_STATE_COL]]
+            rows.append(",".join(str(value) for value in record) + suffix)
+        out_file.write("\n".join(rows) + "\n")
+        num_records += len(rows)
+
+    return num_records
+
+
+def main():
+    args = parse_args()
+    out_dir = args.in_dir if args.out_dir is None else args.out_dir
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+
+    for name, _, columns in STREAMS:
+        # Collective output is already a single file
+        paths = glob.glob(os.path.join(args.in_dir, f"{name}.bin"))
+        is_collective = 0 < len(paths)
+        if not is_collective:
+            paths = sorted(glob.glob(os.path.join(args.in_dir, f"{name}_*.bin")))
+        if not paths:
+            continue
+
+        if args.merge or is_collective:
+            out_path = os.path.join(out_dir, f"{name}.csv")
+            with open(out_path, "w") as out_file:
+                out_file.write(get_columns(paths[0], columns) + "\n")
+                num_records = sum(
+                    convert(path, out_file, args.days) for path in paths
+                )
+            print(f"Wrote {num_records} {name} records to {out_path}")
+            continue
+
+        for path in paths:
+            filename = os.path.splitext(os.path.basename(path))[0] + ".csv"
+            out_path = os.path.join(out_dir, filename)
+            with open(out_path, "w") as out_file:
+                out_file.write(get_columns(path, columns) + "\n")
+                num_records = convert(path, out_file, args.days)
+            print(f"Wrote {num_records} {name} records to {out_path}")
+
+
+if __name__ == "__main__":
+    main()
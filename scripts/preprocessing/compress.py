@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+
+import argparse
+import gzip
+import os
+
+DEFAULT_FILES = ["people.csv", "locations.csv", "visits.csv"]
+DEFAULT_BLOCK_SIZE = 4  # MiB
+MIB = 1 << 20
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Block-compresses population data so that Loimos can "
+        + "read it without decompressing each file in full"
+    )
+
+    # Positional/required arguments:
+    parser.add_argument(
+        "in_dir",
+        metavar="I",
+        help="A path to a directory containing a population in the format "
+        + "Loimos reads",
+    )
+
+    # Named/optional arguments:
+    parser.add_argument(
+        "-f",
+        "--files",
+        nargs="+",
+        default=DEFAULT_FILES,
+        help="The names of the files within the population dir to compress",
+    )
+    parser.add_argument(
+        "-b",
+        "--block-size",
+        type=int,
+        default=DEFAULT_BLOCK_SIZE,
+        help="The (approximate) uncompressed size of each block, in MiB. "
+        + "Smaller blocks let Loimos skip more data it doesn't need, at the "
+        + "cost of a worse compression ratio",
+    )
+    parser.add_argument(
+        "-l",
+        "--level",
+        type=int,
+        default=6,
+        help="The gzip compression level to use",
+    )
+    parser.add_argument(
+        "-k",
+        "--keep",
+        action="store_true",
+        help="Keep the uncompressed files (Loimos will read these instead "
+        + "of the compressed files if both are present)",
+    )
+
+    return parser.parse_args()
+
+
+def compress(path, block_size, level):
+    """
+    Writes path to path.gz as a series of independent gzip members, each
+    holding roughly block_size bytes of whole lines
+    """
+    with open(path, "rb") as in_file, open(path + ".gz", "wb") as out_file:
+        num_blocks = 0
+        while True:
+            block = in_file.read(block_size)
+            if not block:
+                break
+            # Finish the last line, so that blocks start at line boundaries
+            block += in_file.readline()
+            out_file.write(gzip.compress(block, compresslevel=level))
+            num_blocks += 1
+
+    print(f"  Compressed {path} into {num_blocks} blocks")
+
+
+def main():
+    args = parse_args()
+
+    for filename in args.files:
+        path = os.path.join(args.in_dir, filename)
+        compress(path, args.block_size * MIB, args.level)
+        if not args.keep:
+            os.remove(path)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,197 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * In-situ epidemiological analytics. Rather than writing out every exposure
+ * and transition so that aggregates can be computed offline, People chares
+ * fill in a few histograms as infections happen, which are reduced across
+ * all chares at the end of each day
+ */
+
+#include "Analytics.h"
+#include "Types.h"
+#include "Person.h"
+#include "Location.h"
+#include "readers/AttributeTable.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Checked in this order, so e.g. a school which is also marked as a work
+// location counts as a school
+static const char *locationTypeNames[] = {
+  "home", "school", "college", "work", "shopping", "religion", "other"
+};
+static const int numLocationTypes =
+  sizeof(locationTypeNames) / sizeof(locationTypeNames[0]);
+
+static const char *analyticsNames[] = {
+  "location_types", "secondary_cases", "generation_intervals", "attack_rates"
+};
+static const int analyticsFlags[] = {
+  ANALYTICS_LOCATION_TYPES, ANALYTICS_SECONDARY_CASES,
+  ANALYTICS_GENERATION_INTERVALS, ANALYTICS_ATTACK_RATES
+};
+static const int numAnalytics =
+  sizeof(analyticsNames) / sizeof(analyticsNames[0]);
+
+CkReduction::reducerType mergeHistogramsType;
+
+void Histograms::add(Histogram histogram, std::size_t bin, Id count) {
+  std::vector<Id> &counts = bins[histogram];
+  if (bin >= counts.size()) {
+    counts.resize(bin + 1, 0);
+  }
+  counts[bin] += count;
+}
+
+void Histograms::addPacked(const Id *data) {
+  std::size_t numHistograms = data[0];
+  if (bins.size() < numHistograms) {
+    bins.resize(numHistograms);
+  }
+  const Id *counts = data + 1 + numHistograms;
+  for (std::size_t h = 0; h < numHistograms; ++h) {
+    std::vector<Id> &histogram = bins[h];
+    std::size_t numBins = data[1 + h];
+    for (std::size_t bin = 0; bin < numBins; ++bin) {
+      if (0 != counts[bin]) {
+        if (bin >= histogram.size()) {
+          histogram.resize(bin + 1, 0);
+        }
+        histogram[bin] += counts[bin];
+      }
+    }
+    counts += numBins;
+  }
+}
+
+Histograms Histograms::join(const std::vector<Histograms> &replicates) {
+  Histograms joined;
+  joined.bins.clear();
+  for (const Histograms &replicate : replicates) {
+    joined.bins.insert(joined.bins.end(), replicate.bins.begin(),
+      replicate.bins.end());
+  }
+  return joined;
+}
+
+std::vector<Histograms> Histograms::split(int numReplicates) const {
+  std::vector<Histograms> replicates(numReplicates);
+  for (int r = 0; r < numReplicates; ++r) {
+    for (int h = 0; h < NUM_HISTOGRAMS; ++h) {
+      std::size_t joinedIdx = r * NUM_HISTOGRAMS + h;
+      if (joinedIdx < bins.size()) {
+        replicates[r].bins[h] = bins[joinedIdx];
+      }
+    }
+  }
+  return replicates;
+}
+
+std::vector<Id> Histograms::pack() const {
+  std::vector<Id> data;
+  data.push_back(bins.size());
+  for (const std::vector<Id> &counts : bins) {
+    data.push_back(counts.size());
+  }
+  for (const std::vector<Id> &counts : bins) {
+    data.insert(data.end(), counts.begin(), counts.end());
+  }
+  return data;
+}
+
+void Histograms::clear() {
+  for (std::vector<Id> &counts : bins) {
+    counts.clear();
+  }
+}
+
+static CkReductionMsg *mergeHistograms(int numMsgs, CkReductionMsg **msgs) {
+  Histograms merged;
+  for (int i = 0; i < numMsgs; ++i) {
+    merged.addPacked(reinterpret_cast<const Id *>(msgs[i]->getData()));
+  }
+  std::vector<Id> data = merged.pack();
+  return CkReductionMsg::buildNew(data.size() * sizeof(Id), data.data());
+}
+
+void registerHistogramReducer() {
+  mergeHistogramsType = CkReduction::addReducer(mergeHistograms);
+}
+
+int parseAnalyticsFlags(std::string names) {
+  int flags = 0;
+  std::stringstream stream(names);
+  std::string name;
+  while (std::getline(stream, name, ',')) {
+    if ("all" == name) {
+      flags |= ANALYTICS_ALL;
+      continue;
+    }
+
+    const char **found = std::find(analyticsNames,
+      analyticsNames + numAnalytics, name);
+    if (analyticsNames + numAnalytics == found) {
+      CkAbort("Error: unknown analytics type \"%s\"\n", name.c_str());
+    }
+    flags |= analyticsFlags[found - analyticsNames];
+  }
+  return flags;
+}
+
+Analytics::Analytics(int flags_, const AttributeTable &personAttributes,
+    const AttributeTable &locationAttributes) : flags(flags_) {
+  ageIndex = personAttributes.getAttributeIndex("age");
+  if (isEnabled(ANALYTICS_ATTACK_RATES) && -1 == ageIndex) {
+    CkAbort("Error: people need an age attribute to compute attack rates\n");
+  }
+
+  for (int i = 0; i < numLocationTypes; ++i) {
+    int index = locationAttributes.getAttributeIndex(locationTypeNames[i]);
+    if (-1 != index
+        && DataTypes::bool_ != locationAttributes.list[index].dataType) {
+      index = -1;
+    }
+    locationTypeIndices.push_back(index);
+  }
+}
+
+bool Analytics::isEnabled() const {
+  return 0 != flags;
+}
+
+bool Analytics::isEnabled(int flag) const {
+  return 0 != (flags & flag);
+}
+
+int Analytics::getLocationType(const Location &location) const {
+  if (!isEnabled(ANALYTICS_LOCATION_TYPES)) {
+    return numLocationTypes;
+  }
+
+  for (int i = 0; i < numLocationTypes; ++i) {
+    if (-1 != locationTypeIndices[i]
+        && location.getValue(locationTypeIndices[i]).bool_val) {
+      return i;
+    }
+  }
+  return numLocationTypes;
+}
+
+std::size_t Analytics::getAgeBin(const Person &person) const {
+  return std::max(0, person.getValue(ageIndex).int32_val) / AGE_BIN_WIDTH;
+}
+
+std::string Analytics::getLocationTypeName(int locationType) const {
+  if (0 <= locationType && locationType < numLocationTypes) {
+    return locationTypeNames[locationType];
+  }
+  return "unknown";
+}
@@ -0,0 +1,96 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef ANALYTICS_H_
+#define ANALYTICS_H_
+
+#include "Types.h"
+#include "Person.h"
+#include "Location.h"
+#include "readers/AttributeTable.h"
+#include "charm++.h"
+
+#include <string>
+#include <vector>
+
+// In-situ analytics - these are flags that can be or-ed together
+#define ANALYTICS_LOCATION_TYPES 1
+#define ANALYTICS_SECONDARY_CASES 2
+#define ANALYTICS_GENERATION_INTERVALS 4
+#define ANALYTICS_ATTACK_RATES 8
+#define ANALYTICS_ALL 15
+
+// Width (in years) of the age groups attack rates are reported for
+#define AGE_BIN_WIDTH 10
+
+enum Histogram {
+  // Indexed by location type (see Analytics::getLocationType)
+  INFECTIONS_BY_LOCATION_TYPE,
+  // Indexed by number of secondary cases, for the people who stopped being
+  // infectious the day before (and, after the last day, for everyone who
+  // was still infectious)
+  SECONDARY_CASES,
+  // Indexed by days between the infector's and infectee's infections
+  GENERATION_INTERVALS,
+  // Indexed by age group
+  INFECTIONS_BY_AGE,
+  PEOPLE_BY_AGE,
+  NUM_HISTOGRAMS
+};
+
+// A set of histograms which may each have any number of bins, so that
+// chares only need to send the bins they actually used
+struct Histograms {
+  std::vector<std::vector<Id> > bins;
+
+  Histograms() : bins(NUM_HISTOGRAMS) {}
+  void add(Histogram histogram, std::size_t bin, Id count = 1);
+  // Adds in the counts from histograms flattened by pack, adding more
+  // histograms if there are more in the data than in these
+  void addPacked(const Id *data);
+  // Combines each replicate's histograms into a single set, one replicate
+  // after another, so that they can all be reduced at once
+  static Histograms join(const std::vector<Histograms> &replicates);
+  // Undoes join, given the number of replicates that were joined
+  std::vector<Histograms> split(int numReplicates) const;
+  // Flattens these into the number of histograms, followed by the number of
+  // bins in each histogram, followed by the counts in each bin
+  std::vector<Id> pack() const;
+  void clear();
+
+  void pup(PUP::er &p) {  // NOLINT(runtime/references)
+    p | bins;
+  }
+};
+
+// Custom reducer which sums packed Histograms, even if they don't all have
+// the same number of bins
+extern CkReduction::reducerType mergeHistogramsType;
+void registerHistogramReducer();
+
+// Parses a comma-separated list of analytics names (or "all") into flags
+int parseAnalyticsFlags(std::string names);
+
+class Analytics {
+ private:
+  int flags;
+  int ageIndex;
+  // Index of the bool location attribute for each location type
+  std::vector<int> locationTypeIndices;
+
+ public:
+  Analytics(int flags, const AttributeTable &personAttributes,
+    const AttributeTable &locationAttributes);
+  bool isEnabled() const;
+  bool isEnabled(int flag) const;
+  // Returns the first location type the location is marked as, or the
+  // "unknown" type if it isn't marked as any of them
+  int getLocationType(const Location &location) const;
+  std::size_t getAgeBin(const Person &person) const;
+  std::string getLocationTypeName(int locationType) const;
+};
+
+#endif  // ANALYTICS_H_
@@ -0,0 +1,53 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "Checkpoint.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+std::string getCheckpointDirectory(const std::string &checkpointPath,
+    int numDays) {
+  return checkpointPath + "/day_" + std::to_string(numDays);
+}
+
+std::string getCheckpointFile(const std::string &directory,
+    const std::string &name, int index) {
+  return directory + "/" + name + "_" + std::to_string(index) + ".ckpt";
+}
+
+FILE *openCheckpointFile(const std::string &path, const char *mode) {
+  FILE *f = fopen(path.c_str(), mode);
+  if (NULL == f) {
+    CkAbort("Error: failed to open checkpoint file %s: %s\n", path.c_str(),
+      strerror(errno));
+  }
+  return f;
+}
+
+const void *mapSnapshotFile(const std::string &path, size_t *size) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat fileStat;
+  if (0 > fd || 0 != fstat(fd, &fileStat) || 0 == fileStat.st_size) {
+    CkAbort("Error: unable to read snapshot %s\n", path.c_str());
+  }
+  *size = fileStat.st_size;
+  void *data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    CkAbort("Error: unable to map snapshot %s\n", path.c_str());
+  }
+  close(fd);
+  return data;
+}
+
+void unmapSnapshotFile(const void *data, size_t size) {
+  munmap(const_cast<void *>(data), size);
+}
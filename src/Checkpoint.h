@@ -0,0 +1,85 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "charm++.h"
+#include "pup.h"
+
+#include <cstdio>
+#include <string>
+
+// Checkpoints only hold what changes as the simulation runs (disease
+// states, generators, day counters and the like), rather than everything
+// needed to migrate a chare, so that a restarted run can load the
+// population as usual (possibly with different interventions or
+// parameters) and then pick up where the checkpointed run left off.
+// Each chare saves itself to its own file in the checkpoint's directory
+// with a pupCheckpoint method
+
+// Returns the directory holding the checkpoint taken after the given
+// number of days
+std::string getCheckpointDirectory(const std::string &checkpointPath,
+  int numDays);
+// Returns the path of the file holding the given chare's checkpoint
+std::string getCheckpointFile(const std::string &directory,
+  const std::string &name, int index);
+FILE *openCheckpointFile(const std::string &path, const char *mode);
+
+template <class T>
+void saveCheckpoint(const std::string &path, T *obj) {
+  FILE *f = openCheckpointFile(path, "wb");
+  PUP::toDisk p(f);
+  obj->pupCheckpoint(p);
+  fclose(f);
+}
+
+template <class T>
+void loadCheckpoint(const std::string &path, T *obj) {
+  FILE *f = openCheckpointFile(path, "rb");
+  PUP::fromDisk p(f);
+  obj->pupCheckpoint(p);
+  fclose(f);
+}
+
+// Snapshots of chares taken right after startup are saved the same way,
+// but with pupSnapshot, and are mapped into memory rather than read in
+// when they're loaded
+template <class T>
+void saveSnapshot(const std::string &path, T *obj) {
+  FILE *f = openCheckpointFile(path, "wb");
+  PUP::toDisk p(f);
+  obj->pupSnapshot(p);
+  fclose(f);
+}
+
+const void *mapSnapshotFile(const std::string &path, size_t *size);
+void unmapSnapshotFile(const void *data, size_t size);
+
+template <class T>
+void loadSnapshot(const std::string &path, T *obj) {
+  size_t size;
+  const void *data = mapSnapshotFile(path, &size);
+  PUP::fromMem p(data);
+  obj->pupSnapshot(p);
+  unmapSnapshotFile(data, size);
+}
+
+// Used to make sure a value (e.g. a count of people) matches the one in the
+// checkpoint we're restarting from
+template <class T>
+void pupCheckpointMatch(PUP::er &p, T value,  // NOLINT(runtime/references)
+    const char *description) {
+  T savedValue = value;
+  p | savedValue;
+  if (savedValue != value) {
+    CkAbort("Error: checkpoint has a different %s than this run\n",
+      description);
+  }
+}
+
+#endif  // CHECKPOINT_H_
@@ -0,0 +1,133 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "loimos.decl.h"
+#include "ColocationMap.h"
+#include "Types.h"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+// Each traffic entry is a (People chare, Locations chare, visits) triple
+#define TRAFFIC_ENTRY_SIZE 3
+
+ColocationMap::ColocationMap(PartitionId numElements) : pes(numElements) {
+  for (PartitionId i = 0; i < numElements; ++i) {
+    pes[i] = getBlockPe(i, numElements);
+  }
+}
+
+int ColocationMap::getBlockPe(PartitionId index, PartitionId numElements) {
+  return static_cast<Id>(index) * CkNumPes() / numElements;
+}
+
+int ColocationMap::procNum(int arrayHandle, const CkArrayIndex &index) {
+  return pes[index.data()[0]];
+}
+
+void ColocationMap::SetPlacement(int numElements, int *newPes) {
+  pes.assign(newPes, newPes + numElements);
+}
+
+// Tracks how many more chares of one kind each node can take, and which
+// PE on the node the next one should go to
+struct NodeSpace {
+  std::vector<PartitionId> space;
+  std::vector<int> nextPe;
+  std::vector<int> *pes;
+
+  NodeSpace(PartitionId numElements, std::vector<int> *pes_) :
+      space(CkNumNodes(), 0), nextPe(CkNumNodes(), 0), pes(pes_) {
+    pes->assign(numElements, -1);
+    for (PartitionId i = 0; i < numElements; ++i) {
+      space[CkNodeOf(ColocationMap::getBlockPe(i, numElements))]++;
+    }
+  }
+
+  int getNode(PartitionId index) const {
+    return -1 == (*pes)[index] ? -1 : CkNodeOf((*pes)[index]);
+  }
+
+  // Chares placed on a node one after another share PEs in the same order,
+  // so the heaviest pairs placed together also tend to share a PE
+  void place(PartitionId index, int node) {
+    space[node]--;
+    (*pes)[index] = CkNodeFirst(node) + nextPe[node]++ % CkNodeSize(node);
+  }
+
+  void placeRemaining() {
+    for (PartitionId i = 0; i < static_cast<PartitionId>(pes->size()); ++i) {
+      if (-1 == (*pes)[i]) {
+        place(i, std::max_element(space.begin(), space.end()) - space.begin());
+      }
+    }
+  }
+};
+
+void getColocatedPes(PartitionId numPersonPartitions,
+    PartitionId numLocationPartitions, int numValues, const Id *traffic,
+    std::vector<int> *personPes, std::vector<int> *locationPes) {
+  NodeSpace people(numPersonPartitions, personPes);
+  NodeSpace locations(numLocationPartitions, locationPes);
+
+  int numEntries = numValues / TRAFFIC_ENTRY_SIZE;
+  std::vector<int> order(numEntries);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [traffic](int a, int b) {
+    return traffic[a * TRAFFIC_ENTRY_SIZE + 2]
+      > traffic[b * TRAFFIC_ENTRY_SIZE + 2];
+  });
+
+  for (int entry : order) {
+    PartitionId person = traffic[entry * TRAFFIC_ENTRY_SIZE];
+    PartitionId location = traffic[entry * TRAFFIC_ENTRY_SIZE + 1];
+    int personNode = people.getNode(person);
+    int locationNode = locations.getNode(location);
+
+    if (-1 == personNode && -1 == locationNode) {
+      // Start the pair off on whichever node has the most room for both
+      int bestNode = -1;
+      PartitionId bestSpace = 0;
+      for (int node = 0; node < CkNumNodes(); ++node) {
+        PartitionId space = std::min(people.space[node],
+          locations.space[node]);
+        if (space > bestSpace) {
+          bestNode = node;
+          bestSpace = space;
+        }
+      }
+      if (-1 != bestNode) {
+        people.place(person, bestNode);
+        locations.place(location, bestNode);
+      }
+
+    } else if (-1 == personNode && 0 < people.space[locationNode]) {
+      people.place(person, locationNode);
+    } else if (-1 == locationNode && 0 < locations.space[personNode]) {
+      locations.place(location, personNode);
+    }
+  }
+
+  people.placeRemaining();
+  locations.placeRemaining();
+}
+
+double getNodeLocalFraction(int numValues, const Id *traffic,
+    const std::vector<int> &personPes, const std::vector<int> &locationPes) {
+  Id totalVisits = 0;
+  Id localVisits = 0;
+  for (int i = 0; i < numValues; i += TRAFFIC_ENTRY_SIZE) {
+    Id numVisits = traffic[i + 2];
+    totalVisits += numVisits;
+    if (CkNodeOf(personPes[traffic[i]])
+        == CkNodeOf(locationPes[traffic[i + 1]])) {
+      localVisits += numVisits;
+    }
+  }
+  return 0 == totalVisits ? 1.0
+    : static_cast<double>(localVisits) / totalVisits;
+}
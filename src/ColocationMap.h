@@ -0,0 +1,48 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef COLOCATIONMAP_H_
+#define COLOCATIONMAP_H_
+
+#include "loimos.decl.h"
+#include "Types.h"
+
+#include <vector>
+
+// Places the chares of a 1D array on PEs. Initially, chares are spread out
+// in blocks, so that People and Locations chares covering the same share
+// of their id ranges start out on the same PE; once we know how many
+// visits go between each pair of People and Locations chares, each chare's
+// PE can be changed to keep heavily-communicating pairs together (see
+// getColocatedPes), after which the chares should migrate to their new PE
+class ColocationMap : public CBase_ColocationMap {
+ private:
+  std::vector<int> pes;
+
+ public:
+  explicit ColocationMap(PartitionId numElements);
+  // The PE chare index is placed on before any traffic is known
+  static int getBlockPe(PartitionId index, PartitionId numElements);
+  explicit ColocationMap(CkMigrateMessage *msg) {}
+  int procNum(int arrayHandle, const CkArrayIndex &index);
+  void SetPlacement(int numElements, int *newPes);
+};
+
+/**
+ * Greedily assigns People and Locations chares to nodes so that as many
+ * visits as possible are between chares on the same node, without putting
+ * more than its share of either kind of chare on any node. Traffic is a
+ * list of (People chare, Locations chare, number of visits) triples. Sets
+ * personPes and locationPes to the PE each chare should be placed on
+ */
+void getColocatedPes(PartitionId numPersonPartitions,
+  PartitionId numLocationPartitions, int numValues, const Id *traffic,
+  std::vector<int> *personPes, std::vector<int> *locationPes);
+// Returns the fraction of visits which are between chares on the same node
+double getNodeLocalFraction(int numValues, const Id *traffic,
+  const std::vector<int> &personPes, const std::vector<int> &locationPes);
+
+#endif  // COLOCATIONMAP_H_
@@ -63,4 +63,17 @@ const Time MINUTE_LENGTH = 60;
 #define CSV_DELIM ','
 #define FILE_READ_ERROR -1
 
+// Load balancing defaults (these can be changed on the command line). We
+// only load balance on the scheduled days when the busiest PE is predicted
+// to have more than this many times the average PE's load
+#define LB_START_DAY 6
+#define LB_INTERVAL 8
+#define LB_IMBALANCE_THRESHOLD 1.0
+
+// How many days apart checkpoints are taken, by default
+#define CHECKPOINT_INTERVAL 10
+
+// Average household size in power-law synthetic populations, by default
+#define HOUSEHOLD_SIZE 2.5
+
 #endif  // DEFS_H_
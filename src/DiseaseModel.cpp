@@ -278,9 +278,9 @@ double DiseaseModel::getLogProbNotInfected(Event susceptibleEvent,
     // ...a scaling factor (normalizes based on the unit of time)...
     model->transmissibility()
     // ...the susceptibility of the susceptible person...
-    * model->disease_states(susceptibleEvent.personState).susceptibility()
+    * model->disease_states(susceptibleEvent.single.personState).susceptibility()
     // ...and the infectivity of the infectious person
-    * model->disease_states(infectiousEvent.personState).infectivity();
+    * model->disease_states(infectiousEvent.single.personState).infectivity();
 
   // The probability of not being infected in a period of time is decided based
   // on a geometric probability distribution, with the lenght of time the two
@@ -292,18 +292,34 @@ double DiseaseModel::getLogProbNotInfected(Event susceptibleEvent,
 /**
  * Returns the propensity of a person in susceptibleState becoming infected
  * after exposure to a person in infectiousState for the period from startTime
- * to endTime
+ * to endTime, in the given replicate
  */
 double DiseaseModel::getPropensity(DiseaseState susceptibleState,
     DiseaseState infectiousState, Time startTime, Time endTime,
-    double susceptibility, double infectivity)
+    double susceptibility, double infectivity, int replicate)
     const {
   Time dt = endTime - startTime;
 
   // EpiHiper had a number of weights/scaling constants that we may add in
   // later, but for now we omit most of them (which is equivalent to setting
   // them all to one)
-  return model->transmissibility() * dt * susceptibility * infectivity
+  return getTransmissibility(replicate) * dt * susceptibility * infectivity
     * model->disease_states(susceptibleState).susceptibility()
     * model->disease_states(infectiousState).infectivity() / DAY_LENGTH;
 }
+
+/**
+ * Gives each replicate its own transmissibility (e.g. when sweeping over a
+ * range of them), in place of the one from the disease model
+ */
+void DiseaseModel::setReplicateTransmissibilities(
+    const std::vector<double> &values) {
+  replicateTransmissibilities = values;
+}
+
+double DiseaseModel::getTransmissibility(int replicate) const {
+  if (replicateTransmissibilities.empty()) {
+    return model->transmissibility();
+  }
+  return replicateTransmissibilities[replicate];
+}
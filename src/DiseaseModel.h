@@ -36,6 +36,10 @@ class DiseaseModel {
   Time timeDefToSeconds(TimeDef time) const;
   Time timeDefToDays(TimeDef time) const;
 
+  // Overrides the disease model's transmissibility in each replicate, if
+  // they were given different ones
+  std::vector<double> replicateTransmissibilities;
+
  public:
   loimos::proto::DiseaseModel *model;
 
@@ -61,7 +65,10 @@ class DiseaseModel {
       Time startTime,
       Time endTime,
       double susceptibility,
-      double infectivity) const;
+      double infectivity,
+      int replicate) const;
+  void setReplicateTransmissibilities(const std::vector<double> &values);
+  double getTransmissibility(int replicate) const;
 };
 
 #endif  // DISEASEMODEL_H_
@@ -21,13 +21,9 @@ bool Event::operator<(const Event& rhs) const {
     return type < rhs.type;
   }
 
-  // ...then break ties with the visitor's index...
-  if (personIdx != rhs.personIdx) {
-    return personIdx < rhs.personIdx;
-  }
-
-  // ...then finally break ties with the visitor's state
-  return personState < rhs.personState;
+  // ...then finally break ties with the visitor's index (a visitor's
+  // events all carry the same state, so there's no need to compare it)
+  return personIdx < rhs.personIdx;
 }
 
 // Compares two events based on the correspodning other event (if one is an
@@ -44,13 +40,8 @@ bool Event::greaterPartner(const Event &e0, const Event &e1) {
     return e0.type < e1.type;
   }
 
-  // ...then break ties with the visitor's index...
-  if (e0.personIdx != e1.personIdx) {
-    return e0.personIdx > e1.personIdx;
-  }
-
-  // ...and finally breka ties with the vistior's state
-  return e0.personState > e1.personState;
+  // ...and finally break ties with the visitor's index
+  return e0.personIdx > e1.personIdx;
 }
 
 bool Event::overlap(const Event &e0, const Event &e1) {
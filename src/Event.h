@@ -10,6 +10,21 @@
 #include "charm++.h"
 #include "Types.h"
 
+// Which replicates of the simulation a visitor is susceptible or infectious
+// in, with one bit per replicate
+struct ReplicateMasks {
+  ReplicateMask susceptible;
+  ReplicateMask infectious;
+};
+
+// A visitor's state, when there's only a single replicate
+struct SingleState {
+  // the person's curent state in the disease model
+  DiseaseState personState;
+  // Susceptibility or infectivity, depending on disease state
+  double transmissionModifier;
+};
+
 // This is just a bundle of information that we don't need to
 // guarentee any constraints on, hence why this is a stuct rather than
 // a class
@@ -18,10 +33,16 @@ struct Event {
   EventType type;
   // the index of the person arriving or leaving
   Id personIdx;
-  // the person's curent state in the disease model
-  DiseaseState personState;
-  // Susceptibility or infectivity, depending on disease state
-  double transmissionModifier;
+  union {
+    // With a single replicate (see Scenario::numReplicates), the visitor's
+    // state...
+    SingleState single;
+    // ...but with several, events only say which replicates the person is
+    // susceptible or infectious in, so that every replicate can share one
+    // sweep over the events, and their states are looked up separately.
+    // This keeps events no bigger than they need to be for sorting
+    ReplicateMasks replicates;
+  };
   // the time when this event is scheduled to occur, in seconds from the
   // start of the day
   Time scheduledTime;
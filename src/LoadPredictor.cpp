@@ -0,0 +1,68 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "LoadPredictor.h"
+
+#include <algorithm>
+
+LoadPredictor::LoadPredictor() : elapsedTime(0), totalWork(0), numDays(0),
+    dayTime(0), lastBaseWork(0), lastEpidemicWork(0), lastInfectiousCount(0),
+    growth(1) {}
+
+void LoadPredictor::addTime(double seconds) {
+  dayTime += seconds;
+}
+
+/**
+ * Records one day's work, along with how many people were infectious, which
+ * is used to guess how the epidemic share of the work will change tomorrow
+ */
+void LoadPredictor::endDay(double baseWork, double epidemicWork,
+    double infectiousCount) {
+  elapsedTime += dayTime;
+  totalWork += baseWork + epidemicWork;
+  numDays++;
+  dayTime = 0;
+
+  // If no one was infectious yesterday, we have no trend to go on
+  if (0 < lastInfectiousCount) {
+    growth = std::min(std::max(infectiousCount / lastInfectiousCount,
+      1.0 / LB_MAX_DAILY_GROWTH), LB_MAX_DAILY_GROWTH);
+  } else {
+    growth = 1;
+  }
+  lastBaseWork = baseWork;
+  lastEpidemicWork = epidemicWork;
+  lastInfectiousCount = infectiousCount;
+}
+
+double LoadPredictor::getPredictedLoad() const {
+  if (0 == numDays) {
+    return 0;
+  } else if (0 == totalWork) {
+    return elapsedTime / numDays;
+  }
+
+  double predictedWork = lastBaseWork + lastEpidemicWork * growth;
+  return predictedWork * elapsedTime / totalWork;
+}
+
+void LoadPredictor::reset() {
+  elapsedTime = 0;
+  totalWork = 0;
+  numDays = 0;
+}
+
+void LoadPredictor::pup(PUP::er &p) {
+  p | elapsedTime;
+  p | totalWork;
+  p | numDays;
+  p | dayTime;
+  p | lastBaseWork;
+  p | lastEpidemicWork;
+  p | lastInfectiousCount;
+  p | growth;
+}
@@ -0,0 +1,52 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LOADPREDICTOR_H_
+#define LOADPREDICTOR_H_
+
+#include "pup.h"
+
+// Bounds how quickly we assume the epidemic-driven share of a chare's work
+// can grow or shrink from one day to the next, so that a few infections
+// appearing on a chare that had none don't swamp the prediction
+#define LB_MAX_DAILY_GROWTH 4.0
+
+// Predicts how long a chare will spend on its next day of work. Each day,
+// the chare reports how long it spent working and how much work it did,
+// split into work that only depends on the population (e.g. sorting visits)
+// and work that depends on how many people are infectious (e.g. checking
+// susceptible and infectious visitors for overlaps), along with a count of
+// infectious people or visits. The epidemic share of the work is assumed to
+// keep growing at the same rate as that count did from yesterday to today,
+// and the predicted work is converted to a time using the time per unit of
+// work measured since the last time we load balanced
+class LoadPredictor {
+ private:
+  // Totals since the last time we load balanced
+  double elapsedTime;
+  double totalWork;
+  int numDays;
+  // Time spent so far today
+  double dayTime;
+
+  double lastBaseWork;
+  double lastEpidemicWork;
+  double lastInfectiousCount;
+  double growth;
+
+ public:
+  LoadPredictor();
+  void addTime(double seconds);
+  void endDay(double baseWork, double epidemicWork, double infectiousCount);
+  // Predicted time, in seconds, for the next day's work
+  double getPredictedLoad() const;
+  // Called after load balancing, since the chare may now be on a PE with a
+  // different speed or amount of background work
+  void reset();
+  void pup(PUP::er &p);  // NOLINT(runtime/references)
+};
+
+#endif  // LOADPREDICTOR_H_
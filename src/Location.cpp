@@ -20,6 +20,43 @@
 #include <cmath>
 #include <utility>
 #include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+// Schedules for different days are compared using the time of day at which
+// each visit happens, since their absolute start times will always differ
+static inline Time getTimeOfDay(Time time) {
+  return time % DAY_LENGTH;
+}
+
+static std::size_t hashSchedule(const std::vector<VisitMessage> &visits) {
+  std::size_t hash = visits.size();
+  std::hash<Id> hashId;
+  for (const VisitMessage &visit : visits) {
+    for (Id value : {visit.personIdx,
+        static_cast<Id>(getTimeOfDay(visit.visitStart)),
+        static_cast<Id>(visit.visitEnd - visit.visitStart)}) {
+      hash ^= hashId(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+  }
+  return hash;
+}
+
+static bool isSameSchedule(const std::vector<VisitMessage> &lhs,
+    const std::vector<VisitMessage> &rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    if (lhs[i].personIdx != rhs[i].personIdx
+        || getTimeOfDay(lhs[i].visitStart) != getTimeOfDay(rhs[i].visitStart)
+        || lhs[i].visitEnd - lhs[i].visitStart
+          != rhs[i].visitEnd - rhs[i].visitStart) {
+      return false;
+    }
+  }
+  return true;
+}
 
 Location::Location(const AttributeTable &attributes,
     int numInterventions, int uniqueId_, int numDays) :
@@ -33,18 +70,35 @@ Location::Location(const AttributeTable &attributes,
 
 Location::Location(CkMigrateMessage *msg) {}
 
+/**
+ * Leaves out events, which are always empty between days, visitOffsetByDay,
+ * which Locations can read in again if it's needed, and the visit schedules,
+ * which Locations packs for all of its locations at once (see pupSchedules)
+ */
 void Location::pup(PUP::er &p) {
   p | data;
   p | uniqueId;
-  p | events;
   p | generator;
-  p | visitOffsetByDay;
-  p | visitsByDay;
+  p | scheduleByDay;
+  p | replicateGenerators;
 #ifdef ENABLE_SC
   p | anyInfectious;
 #endif
 }
 
+void Location::addReplicates(int numReplicates, int seed) {
+  replicateGenerators.resize(numReplicates - 1);
+  for (int r = 1; r < numReplicates; ++r) {
+    seedReplicate(&replicateGenerators[r - 1], seed, r);
+  }
+}
+
+void Location::swapReplicate(int replicate) {
+  if (0 != replicate) {
+    std::swap(generator, replicateGenerators[replicate - 1]);
+  }
+}
+
 void Location::reset() {
 #ifdef ENABLE_SC
   anyInfectious = false;
@@ -65,6 +119,14 @@ void Location::restoreVisits(const void *cause) {
   visitFilters.erase(cause);
 }
 
+std::vector<const void *> Location::getVisitFilters() const {
+  std::vector<const void *> causes;
+  for (const std::pair<const void *, VisitTest> &pair : visitFilters) {
+    causes.push_back(pair.first);
+  }
+  return causes;
+}
+
 bool Location::acceptsVisit(const VisitMessage &visit) {
   for (const std::pair<const void *, VisitTest> &pair : visitFilters) {
     if (!pair.second(visit)) {
@@ -73,3 +135,53 @@ bool Location::acceptsVisit(const VisitMessage &visit) {
   }
   return true;
 }
+
+const std::vector<VisitMessage> &Location::getVisitsOnDay(int day,
+    Time *shift) const {
+  if (scheduleByDay.empty()) {
+    *shift = 0;
+    return visitsByDay[day];
+  }
+
+  // Schedules are numbered in order of the first day they occur on, so
+  // that's the first day that maps to this one's schedule
+  int scheduleIdx = scheduleByDay[day];
+  int firstDay = std::find(scheduleByDay.begin(), scheduleByDay.end(),
+    scheduleIdx) - scheduleByDay.begin();
+  *shift = (day - firstDay) * DAY_LENGTH;
+  return visitsByDay[scheduleIdx];
+}
+
+/**
+ * Replaces visitsByDay with one copy of each distinct daily schedule. Shared
+ * schedules keep the start and end times from the first day they occur on,
+ * which getVisitsOnDay tells callers how to shift onto the day they want
+ */
+int Location::deduplicateSchedules() {
+  std::vector<std::vector<VisitMessage> > schedules;
+  std::unordered_multimap<std::size_t, int> schedulesByHash;
+  scheduleByDay.resize(visitsByDay.size());
+  for (std::size_t day = 0; day < visitsByDay.size(); ++day) {
+    std::vector<VisitMessage> &visits = visitsByDay[day];
+    std::size_t hash = hashSchedule(visits);
+
+    int scheduleIdx = -1;
+    auto range = schedulesByHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (isSameSchedule(schedules[it->second], visits)) {
+        scheduleIdx = it->second;
+        break;
+      }
+    }
+
+    if (-1 == scheduleIdx) {
+      scheduleIdx = schedules.size();
+      schedules.emplace_back(std::move(visits));
+      schedulesByHash.emplace(hash, scheduleIdx);
+    }
+    scheduleByDay[day] = scheduleIdx;
+  }
+
+  visitsByDay.swap(schedules);
+  return visitsByDay.size();
+}
@@ -38,9 +38,25 @@ class Location : public DataInterface {
   // of this person's visits on day 3.
   std::vector<CacheOffset> visitOffsetByDay;
 
-  // Holds visit messages for each day
+  // Holds visit messages for each day (or, once deduplicated, for each
+  // distinct daily schedule)
   std::vector<std::vector<VisitMessage> > visitsByDay;
 
+  // Maps each day to its schedule in visitsByDay, so that days with
+  // identical schedules (e.g. every weekday) can share a single copy.
+  // Empty until deduplicateSchedules is called, in which case each day
+  // has its own entry in visitsByDay
+  std::vector<int> scheduleByDay;
+
+  // When paging visits, holds the parts of each day's visits which run
+  // past midnight into later days, as these can't be found by reading
+  // the later day's visits when it is paged in
+  std::vector<std::vector<VisitMessage> > spilloverByDay;
+
+  // The generator for every replicate but the first (see
+  // Scenario::numReplicates), which uses the main one
+  std::vector<std::default_random_engine> replicateGenerators;
+
   // This distribution should always be the same - not sure how well
   // static variables work with Charm++, so this may need to be put
   // on the stack somewhere later on
@@ -69,7 +85,19 @@ class Location : public DataInterface {
   void addEvent(const Event &e);
   void filterVisits(const void *cause, VisitTest keepVisit) override;
   void restoreVisits(const void *cause) override;
+  std::vector<const void *> getVisitFilters() const override;
   bool acceptsVisit(const VisitMessage &visit);
+  void addReplicates(int numReplicates, int seed);
+  // Swaps the given replicate's generator in as the main one (or back out)
+  void swapReplicate(int replicate);
+
+  // Returns the visits on the given day, along with how far their times
+  // need to be shifted (in seconds) to fall on that day, since shared
+  // schedules keep the times of the first day they occur on
+  const std::vector<VisitMessage> &getVisitsOnDay(int day, Time *shift) const;
+  // Merges days whose visits are the same apart from the day on which
+  // they happen, returning the number of distinct schedules
+  int deduplicateSchedules();
 };
 
 #endif  // LOCATION_H_
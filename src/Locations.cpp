@@ -17,15 +17,23 @@
 #include "Extern.h"
 #include "Defs.h"
 #include "Partitioner.h"
+#include "VisitGenerator.h"
+#include "Checkpoint.h"
 #include "contact_model/ContactModel.h"
 #include "readers/Preprocess.h"
 #include "readers/DataReader.h"
+#include "readers/NodeDataLoader.h"
 #include "intervention_model/InterventionModel.h"
 #include "intervention_model/Intervention.h"
 #include "pup_stl.h"
+#ifdef ENABLE_BENCHMARKS
+#include "benchmarks/Benchmarks.h"
+#endif
 
 #include <algorithm>
 #include <queue>
+#include <cmath>
+#include <vector>
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
@@ -36,9 +44,16 @@ std::uniform_real_distribution<> Locations::unitDistrib(0.0, 1.0);
 Locations::Locations(int seed, std::string scenarioPath) {
   scenario = globScenario.ckLocalBranch();
   day = 0;
+  visitorStates.resize(scenario->numReplicates);
+  interactions.resize(scenario->numReplicates);
 
   // Must be set to true to make AtSync work
   usesAtSync = true;
+#ifdef ENABLE_LB
+  // We report our predicted load ourselves (see UserSetLBLoad)
+  usesAutoMeasure = false;
+  migratedOnDay = -1;
+#endif  // ENABLE_LB
 
   // Getting number of locations assigned to this chare
   Partitioner *partitioner = scenario->partitioner;
@@ -70,56 +85,57 @@ Locations::Locations(int seed, std::string scenarioPath) {
       scenario->numDaysWithDistinctVisits);
   }
 
-  // Load application data
-  if (!scenario->isOnTheFly()) {
-    loadLocationData(scenarioPath);
+  // Real population data is read in by the node-level loader, which will
+  // call LoadData once this chare's slice of it is available
+  if (scenario->isOnTheFly()) {
+    initializeLocations();
   }
+}
+
+Locations::Locations(CkMigrateMessage *msg) {}
+
+void Locations::LoadData() {
+  loadLocationData(scenario->scenarioPath);
+  initializeLocations();
+}
 
+// Handles any setup which needs to happen after the locations' data is
+// either loaded or generated
+void Locations::initializeLocations() {
+  InterventionModel *interventions = scenario->interventionModel;
+  int numInterventions = interventions->getNumLocationInterventions();
   for (Location &l : locations) {
-    l.setSeed(seed);
+    l.setSeed(scenario->seed);
+    if (1 < scenario->numReplicates) {
+      l.addReplicates(scenario->numReplicates, scenario->seed);
+    }
     for (int i = 0; i < numInterventions; ++i) {
       const Intervention<Location> &inter = interventions->getLocationIntervention(i);
       l.toggleCompliance(i, inter.willComply(l, l.getGenerator()));
     }
   }
 
-#if OUTPUT_FLAGS & OUTPUT_OVERLAPS
-  interactionsFile = new std::ofstream(scenario->outputPath + "interactions_chare_"
-      + std::to_string(thisIndex) + ".csv");
-#else
-  interactionsFile = NULL;
-#endif
-
   // Notify Main
 #ifdef USE_HYPERCOMM
   contribute(CkCallback(CkReductionTarget(Main, CharesCreated), mainProxy));
+#else
+  mainProxy.CharesCreated();
 #endif
 }
 
-Locations::Locations(CkMigrateMessage *msg) {}
-
+/**
+ * Loads real location and visit data from this chare's slices of the
+ * locations and visits files, which the node-level loader has already read
+ * into memory.
+ */
 void Locations::loadLocationData(std::string scenarioPath) {
   double startTime = CkWallTimer();
-
-  std::string scenarioId = scenario->scenarioId;
-  std::ifstream locationData(scenario->scenarioPath + "locations.csv");
-  std::ifstream locationCache(scenario->scenarioPath + scenarioId
-    + "_locations.cache", std::ios_base::binary);
-  if (!locationData || !locationCache) {
-    CkAbort("Could not open person data input.");
-  }
-
-  // Find starting line for our data through location cache.
-  locationCache.seekg(thisIndex * sizeof(CacheOffset));
-  CacheOffset locationOffset;
-  locationCache.read(reinterpret_cast<char *>(&locationOffset), sizeof(CacheOffset));
-  locationData.seekg(locationOffset);
+  NodeDataLoader *loader = scenario->dataLoader;
 
   // Read in our location data.
+  FileSliceStream locationData(loader->getLocationSlice(thisIndex));
   readData(&locationData, scenario->locationDef,
       &locations, scenario->numLocations);
-  locationData.close();
-  locationCache.close();
 
   // Let contact model add any attributes it needs to the locations
   ContactModel *contactModel = scenario->contactModel;
@@ -127,35 +143,29 @@ void Locations::loadLocationData(std::string scenarioPath) {
     contactModel->computeLocationValues(&location);
   }
 
-  // Open activity data and cache.
-  std::ifstream visitData(scenarioPath + "visits.csv");
-  std::ifstream activityCache(scenarioPath + scenarioId
-      + "_visits.cache", std::ios_base::binary);
-  if (!visitData || !activityCache) {
-    CkAbort("Could not open activity input.");
-  }
-
-  // Load preprocessing meta data.
-  CacheOffset *buf = reinterpret_cast<CacheOffset *>(
-    malloc(sizeof(CacheOffset) * scenario->numDaysWithDistinctVisits));
-  for (Id c = 0; c < numLocalLocations; c++) {
-    std::vector<CacheOffset> *data_pos = &locations[c].visitOffsetByDay;
-    Id currId = locations[c].getUniqueId();
-
-    // Read in their activity data offsets.
-    activityCache.seekg(sizeof(CacheOffset) * scenario->numDaysWithDistinctVisits
-       * scenario->partitioner->getLocationCacheIndex(currId));
-    activityCache.read(reinterpret_cast<char *>(buf),
-      sizeof(CacheOffset) * scenario->numDaysWithDistinctVisits);
-    for (int day = 0; day < scenario->numDaysWithDistinctVisits; day++) {
-      data_pos->push_back(buf[day]);
+  // Load preprocessing meta data (the loader has already read in the
+  // visit cache entries for this partition).
+  setVisitOffsets(loader->getVisitOffsets(thisIndex));
+  int numDays = scenario->numDaysWithDistinctVisits;
+
+  if (scenario->pageVisits) {
+    visitFile.reset(new FileSliceStream(loader->getVisitFile()));
+    visitsEnd = loader->getVisitSlice(thisIndex).end;
+    isDayResident.assign(numDays, false);
+    loadVisitData(visitFile.get());
+    pageInVisits(0);
+  } else {
+    FileSliceStream visitData(loader->getVisitSlice(thisIndex));
+    loadVisitData(&visitData);
+
+    // We only need the offsets to page visits in
+    for (Location &location : locations) {
+      std::vector<CacheOffset>().swap(location.visitOffsetByDay);
     }
-  }
-  free(buf);
 
-  loadVisitData(&visitData);
-
-  visitData.close();
+    deduplicateSchedules();
+  }
+  loader->releaseSlices();
 
 #if ENABLE_DEBUG >= DEBUG_PER_CHARE
   CkPrintf("  Chare %d took %f s to load locations\n", thisIndex,
@@ -163,7 +173,30 @@ void Locations::loadLocationData(std::string scenarioPath) {
 #endif
 }
 
-void Locations::loadVisitData(std::ifstream *visitData) {
+// Synthetic populations often have the same visits every weekday, so we
+// only keep one copy of each of our locations' distinct daily schedules
+void Locations::deduplicateSchedules() {
+  Id numSchedules = 0;
+  for (Location &location : locations) {
+    numSchedules += location.deduplicateSchedules();
+  }
+#if ENABLE_DEBUG >= DEBUG_PER_CHARE
+  CkPrintf("  Chare %d kept " ID_PRINT_TYPE " distinct schedules out of "
+    ID_PRINT_TYPE "\n", thisIndex, numSchedules,
+    numLocalLocations * scenario->numDaysWithDistinctVisits);
+#endif
+}
+
+void Locations::setVisitOffsets(const std::vector<CacheOffset> &visitOffsets) {
+  int numDays = scenario->numDaysWithDistinctVisits;
+  for (Id c = 0; c < numLocalLocations; c++) {
+    locations[c].visitOffsetByDay.assign(
+      visitOffsets.begin() + c * numDays,
+      visitOffsets.begin() + (c + 1) * numDays);
+  }
+}
+
+void Locations::loadVisitData(std::istream *visitData) {
   loimos::proto::CSVDefinition *visitDef = scenario->visitDef;
   Time firstDay = 0;
   if (visitDef->has_start_time()) {
@@ -175,14 +208,13 @@ void Locations::loadVisitData(std::ifstream *visitData) {
   #endif
   Id numDaysWithDistinctVisits = scenario->numDaysWithDistinctVisits;
   for (Location &location : locations) {
-    location.visitsByDay.reserve(numDaysWithDistinctVisits);
+    if (scenario->pageVisits) {
+      location.spilloverByDay.resize(numDaysWithDistinctVisits);
+    } else {
+      location.visitsByDay.reserve(numDaysWithDistinctVisits);
+    }
     for (int day = 0; day < numDaysWithDistinctVisits; ++day) {
-      Time nextDaySecs = getSeconds(day + 1, firstDay);
-
-      // Seek to correct position in file.
-      CacheOffset seekPos = location
-        .visitOffsetByDay[day % numDaysWithDistinctVisits];
-      if (seekPos == EMPTY_VISIT_SCHEDULE) {
+      if (location.visitOffsetByDay[day] == EMPTY_VISIT_SCHEDULE) {
 #if ENABLE_DEBUG >= DEBUG_PER_CHARE
         CkPrintf("  Chare %d: Location %d has no visits on day %d\n",
             thisIndex, location.getUniqueId(), day);
@@ -190,53 +222,24 @@ void Locations::loadVisitData(std::ifstream *visitData) {
         continue;
       }
 
-      visitData->seekg(seekPos, std::ios_base::beg);
-
-      // Start reading
-      Id locationId = -1;
-      Id personId = -1;
-      Time visitStart = -1;
-      Time visitDuration = -1;
-      Time visitEnd = -1;
-      std::tie(locationId, personId, visitStart, visitDuration) =
-        parseActivityStream(visitData, scenario->visitDef, NULL);
-
-#if ENABLE_DEBUG >= DEBUG_PER_OBJECT
-      if (0 == locationId % 10000) {
-        CkPrintf("  locations chare %d, location %d reading from %u on day %d\n",
-            thisIndex, location.getUniqueId(), seekPos, day);
-        CkPrintf("  Location %d (%d) on day %d first visit: %d to %d, "
-            "at loc %d\n", location.getUniqueId(), locationId, day,
-            visitStart, visitStart + visitDuration, locationId);
-      }
-#endif
-
-      // Seek while same location on same day
-      while (locationId == location.getUniqueId() && visitStart < nextDaySecs) {
-        // Save visit info
-        visitEnd = visitStart + visitDuration;
-        while (visitEnd > nextDaySecs) {
-          int endDay = getDay(visitEnd, firstDay) % numDaysWithDistinctVisits;
-          Time newStart = getSeconds(endDay, firstDay);
-          location.visitsByDay[endDay].emplace_back(locationId, personId, -1,
-              newStart, visitEnd, 1.0);
-          visitEnd = std::max(nextDaySecs, visitEnd - DAY_LENGTH);
-        }
-
-        location.visitsByDay[day].emplace_back(locationId, personId, -1,
-            visitStart, visitEnd, 1.0);
-        #ifdef ENABLE_DEBUG
-          numVisits++;
-        #endif
-
-        std::tie(locationId, personId, visitStart, visitDuration) =
-          parseActivityStream(visitData,
-              scenario->visitDef, NULL);
+      // When paging, we only hold on to the parts of visits which spill over
+      // into later days (and who our visitors are); the rest of each day's
+      // visits are read in again right before they're needed
+      Id numDayVisits;
+      if (scenario->pageVisits) {
+        numDayVisits = readDayVisits(visitData, &location, day, firstDay,
+          NULL, &location.spilloverByDay, &scheduledVisitors);
+      } else {
+        numDayVisits = readDayVisits(visitData, &location, day, firstDay,
+          &location.visitsByDay[day], &location.visitsByDay, NULL);
       }
+      #ifdef ENABLE_DEBUG
+        numVisits += numDayVisits;
+      #endif
 
       // CkPrintf("  Chare %d: location %d has %u visits on day %d (offset %u)\n",
       //     thisIndex, location.getUniqueId(), location.visitsByDay[day].size(),
-      //     day, seekPos);
+      //     day, location.visitOffsetByDay[day]);
     }
   }
   #if ENABLE_DEBUG >= DEBUG_VERBOSE
@@ -246,6 +249,143 @@ void Locations::loadVisitData(std::ifstream *visitData) {
   #endif
 }
 
+/**
+ * Reads in all of location's visits on the specified day, adding them to
+ * dayVisits. Visits which run past midnight are cut off there, with the
+ * remainder added to the appropriate day(s) of laterVisits. The ids of
+ * the visitors are added to visitors. Any of these may be NULL if the
+ * corresponding data isn't needed. Returns the number of visits read
+ */
+Id Locations::readDayVisits(std::istream *visitData, Location *location,
+    int day, Time firstDay, std::vector<VisitMessage> *dayVisits,
+    std::vector<std::vector<VisitMessage> > *laterVisits,
+    std::unordered_set<Id> *visitors) {
+  Id numDaysWithDistinctVisits = scenario->numDaysWithDistinctVisits;
+  Time nextDaySecs = getSeconds(day + 1, firstDay);
+
+  // Seek to correct position in file.
+  CacheOffset seekPos = location->visitOffsetByDay[day];
+
+  // Reaching the end of our slice on the previous day leaves the stream
+  // in a failed state, which would prevent us from seeking
+  visitData->clear();
+  visitData->seekg(seekPos, std::ios_base::beg);
+
+  // Start reading
+  Id numVisits = 0;
+  Id locationId = -1;
+  Id personId = -1;
+  Time visitStart = -1;
+  Time visitDuration = -1;
+  Time visitEnd = -1;
+  std::tie(locationId, personId, visitStart, visitDuration) =
+    parseActivityStream(visitData, scenario->visitDef, NULL);
+
+#if ENABLE_DEBUG >= DEBUG_PER_OBJECT
+  if (0 == locationId % 10000) {
+    CkPrintf("  locations chare %d, location %d reading from %u on day %d\n",
+        thisIndex, location->getUniqueId(), seekPos, day);
+    CkPrintf("  Location %d (%d) on day %d first visit: %d to %d, "
+        "at loc %d\n", location->getUniqueId(), locationId, day,
+        visitStart, visitStart + visitDuration, locationId);
+  }
+#endif
+
+  // Seek while same location on same day
+  while (locationId == location->getUniqueId() && visitStart < nextDaySecs) {
+    // Save visit info
+    visitEnd = visitStart + visitDuration;
+    while (visitEnd > nextDaySecs) {
+      if (NULL != laterVisits) {
+        int endDay = getDay(visitEnd, firstDay) % numDaysWithDistinctVisits;
+        Time newStart = getSeconds(endDay, firstDay);
+        (*laterVisits)[endDay].emplace_back(locationId, personId, -1,
+            newStart, visitEnd, 1.0);
+      }
+      visitEnd = std::max(nextDaySecs, visitEnd - DAY_LENGTH);
+    }
+
+    if (NULL != dayVisits) {
+      dayVisits->emplace_back(locationId, personId, -1, visitStart, visitEnd,
+        1.0);
+    }
+    if (NULL != visitors) {
+      visitors->insert(personId);
+    }
+    numVisits++;
+
+    std::tie(locationId, personId, visitStart, visitDuration) =
+      parseActivityStream(visitData,
+          scenario->visitDef, NULL);
+  }
+  return numVisits;
+}
+
+/**
+ * Reads in every location's visits for the specified day (along with any
+ * visits spilling over into it from earlier days) from the visits file
+ */
+void Locations::pageInVisits(int dayIdx) {
+  if (isDayResident[dayIdx]) {
+    return;
+  }
+  // We don't migrate the stream along with the rest of the chare
+  if (!visitFile) {
+    visitFile.reset(new FileSliceStream(scenario->dataLoader->getVisitFile()));
+  }
+
+  loimos::proto::CSVDefinition *visitDef = scenario->visitDef;
+  Time firstDay = 0;
+  if (visitDef->has_start_time()) {
+    firstDay = visitDef->start_time().days();
+  }
+  for (Location &location : locations) {
+    std::vector<VisitMessage> &visits = location.visitsByDay[dayIdx];
+    visits = location.spilloverByDay[dayIdx];
+    if (location.visitOffsetByDay[dayIdx] != EMPTY_VISIT_SCHEDULE) {
+      readDayVisits(visitFile.get(), &location, dayIdx, firstDay, &visits,
+        NULL, NULL);
+    }
+  }
+  isDayResident[dayIdx] = true;
+}
+
+void Locations::pageOutVisits(int dayIdx) {
+  if (!isDayResident[dayIdx]) {
+    return;
+  }
+  for (Location &location : locations) {
+    std::vector<VisitMessage>().swap(location.visitsByDay[dayIdx]);
+  }
+  isDayResident[dayIdx] = false;
+}
+
+/**
+ * Returns where the visits to the specified location on the specified day
+ * end in the visits file, which is where the next non-empty schedule of any
+ * of our locations begins (or the end of all of our visits)
+ */
+CacheOffset Locations::getScheduleEnd(Id localIdx, int dayIdx) const {
+  int numDays = scenario->numDaysWithDistinctVisits;
+  for (Id c = localIdx; c < numLocalLocations; ++c) {
+    const std::vector<CacheOffset> &offsets = locations[c].visitOffsetByDay;
+    for (int d = c == localIdx ? dayIdx + 1 : 0; d < numDays; ++d) {
+      if (EMPTY_VISIT_SCHEDULE != offsets[d]) {
+        return offsets[d];
+      }
+    }
+  }
+  return visitsEnd;
+}
+
+// Pages in the next day's visits ahead of time. Since this is sent to
+// ourselves, it runs in between the rest of today's work on this PE rather
+// than alongside it; only the reads started by prefetchVisits (in
+// QueueVisits) happen in the background
+void Locations::PrefetchVisits(int dayIdx) {
+  pageInVisits(dayIdx);
+}
+
 void Locations::pup(PUP::er &p) {
   p | numLocalLocations;
   p | locations;
@@ -253,7 +393,33 @@ void Locations::pup(PUP::er &p) {
 
   if (p.isUnpacking()) {
     scenario = globScenario.ckLocalBranch();
+    visitorStates.resize(scenario->numReplicates);
+    interactions.resize(scenario->numReplicates);
   }
+
+  // When paging, whichever days are resident can just be paged in again
+  // (from wherever we end up), so only the spillover needs to come with us
+  if (scenario->pageVisits) {
+    pupSchedules(p, &locations, &Location::spilloverByDay);
+    if (p.isUnpacking()) {
+      int numDays = scenario->numDaysWithDistinctVisits;
+      isDayResident.assign(numDays, false);
+      for (Location &location : locations) {
+        location.visitsByDay.resize(numDays);
+      }
+      setVisitOffsets(scenario->dataLoader->loadVisitOffsets(thisIndex));
+      visitsEnd = scenario->dataLoader->loadVisitsEnd(thisIndex);
+    }
+  } else {
+    pupSchedules(p, &locations, &Location::visitsByDay);
+  }
+
+#ifdef ENABLE_LB
+  p | loadPredictor;
+  if (p.isUnpacking()) {
+    migratedOnDay = day;
+  }
+#endif  // ENABLE_LB
 }
 
 void Locations::ReceiveVisitSchedule(VisitScheduleMessage msg) {
@@ -271,16 +437,31 @@ void Locations::ReceiveVisitSchedule(VisitScheduleMessage msg) {
 void Locations::SendExpectedVisitors() {
   Partitioner *partitioner = scenario->partitioner;
   std::unordered_map<PartitionId, ExpectedVisitorsMessage > visitorsFromPartition;
-  for (const Location &location : locations) {
-    for (const std::vector<VisitMessage> &visits : location.visitsByDay) {
-      for (const VisitMessage &visit : visits) {
-        PartitionId personPartition = partitioner->getPersonPartitionIndex(
-          visit.personIdx);
-        if (visitorsFromPartition.find(personPartition)
-            == visitorsFromPartition.end()) {
-          visitorsFromPartition[personPartition].destPartition = thisIndex;
+  std::unordered_map<PartitionId, Id> numVisitsFromPartition;
+  auto addVisitor = [&](Id personIdx) {
+    PartitionId personPartition = partitioner->getPersonPartitionIndex(
+      personIdx);
+    numVisitsFromPartition[personPartition]++;
+    if (visitorsFromPartition.find(personPartition)
+        == visitorsFromPartition.end()) {
+      visitorsFromPartition[personPartition].destPartition = thisIndex;
+    }
+    visitorsFromPartition[personPartition].visitors.insert(personIdx);
+  };
+
+  // Most days' visits aren't in memory when paging, so we had to keep
+  // track of visitors separately
+  if (scenario->pageVisits) {
+    for (Id personIdx : scheduledVisitors) {
+      addVisitor(personIdx);
+    }
+    std::unordered_set<Id>().swap(scheduledVisitors);
+  } else {
+    for (const Location &location : locations) {
+      for (const std::vector<VisitMessage> &visits : location.visitsByDay) {
+        for (const VisitMessage &visit : visits) {
+          addVisitor(visit.personIdx);
         }
-        visitorsFromPartition[personPartition].visitors.insert(visit.personIdx);
       }
     }
   }
@@ -289,42 +470,148 @@ void Locations::SendExpectedVisitors() {
     peopleArray[entry.first].ReceiveExpectedVisitors(entry.second);
   }
   visitorsFromPartition.clear();
+
+  if (scenario->colocateChares) {
+    std::vector<Id> traffic;
+    for (const auto &entry : numVisitsFromPartition) {
+      traffic.push_back(entry.first);
+      traffic.push_back(thisIndex);
+      traffic.push_back(entry.second);
+    }
+    CkCallback cb(CkReductionTarget(Main, ReceivePartitionTraffic), mainProxy);
+    contribute(traffic, CkReduction::concat, cb);
+  }
+}
+
+// Marks whether someone in state is susceptible or infectious in replicate
+inline void Locations::addReplicateState(ReplicateMasks *masks,
+    DiseaseState state, int replicate) const {
+  ReplicateMask bit = static_cast<ReplicateMask>(1) << replicate;
+  if (scenario->diseaseModel->isSusceptible(state)) {
+    masks->susceptible |= bit;
+  } else if (scenario->diseaseModel->isInfectious(state)) {
+    masks->infectious |= bit;
+  }
+}
+
+// Which replicates the visitor is susceptible or infectious in, which with a
+// single replicate we work out from their state (see Event)
+inline ReplicateMasks Locations::getReplicates(const Event &event) const {
+  if (1 < scenario->numReplicates) {
+    return event.replicates;
+  }
+  ReplicateMasks masks { 0, 0 };
+  addReplicateState(&masks, event.single.personState, 0);
+  return masks;
 }
 
 void Locations::ReceiveVisitorStates(PersonStatesMessage msg) {
+  double startTime = CkWallTimer();
+  size_t numVisitors = msg.states.size() / scenario->numReplicates;
   for (size_t i = 0; i < msg.states.size(); i++) {
     PersonState *state = &msg.states[i];
-    std::memcpy(&visitorStates[state->uniqueId], state, sizeof(PersonState));
+    int replicate = i / numVisitors;
+    std::memcpy(&visitorStates[replicate][state->uniqueId], state,
+      sizeof(PersonState));
+
+    // Each replicate's states come in turn, so start over with the first
+    ReplicateMasks &masks = visitorReplicates[state->uniqueId];
+    if (0 == replicate) {
+      masks = ReplicateMasks { 0, 0 };
+    }
+    addReplicateState(&masks, state->state, replicate);
   }
 
   msg.states.clear();
+  timings.add(VISITS_TIME, CkWallTimer() - startTime);
+}
+
+// Turns a visit into arrival and departure events at the location
+inline void Locations::queueVisit(Location *location,
+    const VisitMessage &visit, Time shift) {
+  const PersonState &state = visitorStates[0][visit.personIdx];
+  Event arrival;
+  arrival.type = ARRIVAL;
+  arrival.personIdx = visit.personIdx;
+  arrival.single.personState = state.state;
+  arrival.single.transmissionModifier = state.transmissionModifier;
+  arrival.scheduledTime = visit.visitStart + shift;
+  Event departure = arrival;
+  departure.type = DEPARTURE;
+  departure.scheduledTime = visit.visitEnd + shift;
+  if (1 < scenario->numReplicates) {
+    arrival.replicates = departure.replicates =
+      visitorReplicates[visit.personIdx];
+  }
+  Event::pair(&arrival, &departure);
+
+  location->addEvent(arrival);
+  location->addEvent(departure);
+
+#ifdef ENABLE_SC
+  // We can only skip locations where no one is infectious in any replicate
+  if (!location->anyInfectious && 0 != getReplicates(arrival).infectious) {
+    location->anyInfectious = true;
+  }
+#endif
 }
 
 void Locations::QueueVisits() {
-  for (Location &location : locations) {
-    const std::vector<VisitMessage> &visits =
-      location.visitsByDay[day % scenario->numDaysWithDistinctVisits];
+  double startTime = CkWallTimer();
+  int numDays = scenario->numDaysWithDistinctVisits;
+  int dayIdx = day % numDays;
+  int nextDayIdx = (day + 1) % numDays;
+  if (scenario->pageVisits) {
+    int lastDayIdx = (day + numDays - 1) % numDays;
+    if (lastDayIdx != dayIdx && lastDayIdx != nextDayIdx) {
+      pageOutVisits(lastDayIdx);
+    }
+    // This is a no-op unless the prefetch hasn't run yet
+    pageInVisits(dayIdx);
+  }
 
+  // Synthetic visits may not be stored anywhere, in which case we regenerate
+  // today's from scratch (the same way the visitors' chares did)
+  if (scenario->lazyVisits) {
+    std::vector<VisitMessage> visits;
+    scenario->visitGenerator->generateIncomingVisits(thisIndex, dayIdx,
+      &visits);
+    Partitioner *partitioner = scenario->partitioner;
     for (const VisitMessage &visit : visits) {
-      const PersonState &state = visitorStates[visit.personIdx];
-      Event arrival { ARRIVAL, visit.personIdx, state.state,
-        state.transmissionModifier, visit.visitStart };
-      Event departure { DEPARTURE, visit.personIdx, state.state,
-        state.transmissionModifier, visit.visitEnd };
-      Event::pair(&arrival, &departure);
-
-      location.addEvent(arrival);
-      location.addEvent(departure);
+      Id localIdx = partitioner->getLocalLocationIndex(visit.locationIdx,
+        thisIndex);
+      queueVisit(&locations[localIdx], visit, 0);
+    }
+  } else {
+    for (Location &location : locations) {
+      Time shift = 0;
+      for (const VisitMessage &visit : location.getVisitsOnDay(dayIdx,
+          &shift)) {
+        queueVisit(&location, visit, shift);
+      }
+    }
+  }
 
-#ifdef ENABLE_SC
-      bool isInfectious = scenario->diseaseModel->isInfectious(state.state);
-      if (!location.anyInfectious && isInfectious) {
-        location.anyInfectious = true;
+  if (scenario->pageVisits && !isDayResident[nextDayIdx]) {
+    // Visits are sorted by location, so the next day's visits all lie
+    // between the start of the first location's and the end of the last's
+    CacheOffset begin = EMPTY_VISIT_SCHEDULE;
+    Id lastIdx = -1;
+    for (Id c = 0; c < numLocalLocations; ++c) {
+      CacheOffset offset = locations[c].visitOffsetByDay[nextDayIdx];
+      if (EMPTY_VISIT_SCHEDULE != offset) {
+        begin = std::min(begin, offset);
+        lastIdx = c;
       }
-#endif
     }
+    if (-1 != lastIdx) {
+      scenario->dataLoader->prefetchVisits(begin,
+        getScheduleEnd(lastIdx, nextDayIdx));
+    }
+    thisProxy[thisIndex].PrefetchVisits(nextDayIdx);
   }
 
+  timings.add(INTERACTIONS_TIME, CkWallTimer() - startTime);
   ComputeInteractions();
 }
 
@@ -361,10 +648,23 @@ void Locations::ReceiveVisitMessages(VisitMessage visitMsg) {
   //   visitMsg.visitStart, visitMsg.visitEnd);
 
   // Wrap visit info...
-  Event arrival { ARRIVAL, visitMsg.personIdx, visitMsg.personState,
-    visitMsg.transmissionModifier, visitMsg.visitStart };
-  Event departure { DEPARTURE, visitMsg.personIdx, visitMsg.personState,
-    visitMsg.transmissionModifier, visitMsg.visitEnd };
+  Event arrival;
+  arrival.type = ARRIVAL;
+  arrival.personIdx = visitMsg.personIdx;
+  arrival.single.personState = visitMsg.personState;
+  arrival.single.transmissionModifier = visitMsg.transmissionModifier;
+  arrival.scheduledTime = visitMsg.visitStart;
+  Event departure = arrival;
+  departure.type = DEPARTURE;
+  departure.scheduledTime = visitMsg.visitEnd;
+  if (1 < scenario->numReplicates) {
+    // Visits only carry the first replicate's state
+    visitorStates[0][visitMsg.personIdx] = PersonState(visitMsg.personIdx,
+      visitMsg.personState, visitMsg.transmissionModifier);
+    ReplicateMasks replicates { 0, 0 };
+    addReplicateState(&replicates, visitMsg.personState, 0);
+    arrival.replicates = departure.replicates = replicates;
+  }
   Event::pair(&arrival, &departure);
 
 #ifdef ENABLE_DEBUG
@@ -394,18 +694,48 @@ void Locations::ComputeInteractions() {
   Counter numInteractions = 0;
   exposureDuration = 0;
   expectedExposureDuration = 0;
+  double startTime = CkWallTimer();
+#ifdef ENABLE_LB
+  eventWork = 0;
+  pairChecks = 0;
+  infectiousVisits = 0;
+#endif  // ENABLE_LB
+  int numSlowest = scenario->timingReport ? scenario->numSlowestLocations : 0;
   for (Location &loc : locations) {
-    Counter locVisits = loc.events.size() / 2;
+    Id numEvents = loc.events.size();
+    Counter locVisits = numEvents / 2;
     numVisits += locVisits;
 
+    // Timing every location is only worth it if we're reporting on them
+    double locStartTime = 0 < numSlowest ? CkWallTimer() : 0.0;
     Counter locInters = processEvents(&loc);
     numInteractions += locInters;
+    if (0 < numSlowest) {
+      timings.addLocation(loc.getUniqueId(), numEvents,
+        CkWallTimer() - locStartTime, numSlowest);
+    }
 
     // if (0 < locInters) {
     //   CkPrintf("    Chare %d: loc %d found %d interactions from %d visits\n",
     //       thisIndex, loc.getUniqueId(), locInters, locVisits);
     // }
   }
+  double elapsed = CkWallTimer() - startTime;
+#ifdef ENABLE_LB
+  loadPredictor.addTime(elapsed);
+  loadPredictor.endDay(eventWork, pairChecks, infectiousVisits);
+#endif  // ENABLE_LB
+
+  timings.add(INTERACTIONS_TIME, elapsed);
+  if (scenario->timingReport) {
+    std::vector<char> packed = TimingSummary(timings, thisIndex,
+      numSlowest).pack();
+    CkCallback timingCb(CkReductionTarget(Main, ReceiveLocationTimings),
+      mainProxy);
+    contribute(packed.size(), packed.data(),
+      mergeTimingSummariesType, timingCb);
+  }
+  timings.clear();
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   CkCallback cb(CkReductionTarget(Main, ReceiveInteractionsCount), mainProxy);
   contribute(sizeof(Counter), &numInteractions,
@@ -424,7 +754,6 @@ void Locations::ComputeInteractions() {
 }
 
 Counter Locations::processEvents(Location *loc) {
-  std::vector<Event> *arrivals;
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   Counter numInteractions = 0;
   Counter numPresent = 0;
@@ -438,7 +767,19 @@ Counter Locations::processEvents(Location *loc) {
   }
 #endif
 
+#ifdef ENABLE_LB
+  eventWork += loc->events.size() * std::log2(loc->events.size() + 1);
+#endif  // ENABLE_LB
+
+  timings.add(EVENTS_SORTED, loc->events.size());
   std::sort(loc->events.begin(), loc->events.end());
+  Counter numPairs = 0;
+
+  // Every replicate has the same visits, so rather than sweeping over the
+  // events once per replicate, we check each pair of visitors once and only
+  // then look at which replicates one is susceptible and the other infectious
+  // in. Someone can be susceptible in some replicates and infectious in
+  // others, in which case they wait in both lists
   for (const Event &event : loc->events) {
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
     if (ARRIVAL == event.type) {
@@ -449,37 +790,63 @@ Counter Locations::processEvents(Location *loc) {
     }
 #endif
 
-    DiseaseModel *diseaseModel = scenario->diseaseModel;
-    if (diseaseModel->isSusceptible(event.personState)) {
-      arrivals = &susceptibleArrivals;
-
-    } else if (diseaseModel->isInfectious(event.personState)) {
-      arrivals = &infectiousArrivals;
-
-    // If a person can neither infect other people nor be infected themself,
-    // we can just ignore their comings and goings
-    } else {
+    // If a person can neither infect other people nor be infected themself
+    // in any replicate, we can just ignore their comings and goings
+    ReplicateMasks replicates = getReplicates(event);
+    bool isSusceptible = 0 != replicates.susceptible;
+    bool isInfectious = 0 != replicates.infectious;
+    if (!isSusceptible && !isInfectious) {
       continue;
     }
 
     if (ARRIVAL == event.type) {
-      arrivals->push_back(event);
-      std::push_heap(arrivals->begin(), arrivals->end(), Event::greaterPartner);
+      if (isSusceptible) {
+        susceptibleArrivals.push_back(event);
+        std::push_heap(susceptibleArrivals.begin(), susceptibleArrivals.end(),
+          Event::greaterPartner);
+      }
+      if (isInfectious) {
+        infectiousArrivals.push_back(event);
+        std::push_heap(infectiousArrivals.begin(), infectiousArrivals.end(),
+          Event::greaterPartner);
+#ifdef ENABLE_LB
+        infectiousVisits++;
+#endif  // ENABLE_LB
+      }
 
     } else if (DEPARTURE == event.type) {
-      // Remove the arrival event corresponding to this departure
-      std::pop_heap(arrivals->begin(), arrivals->end(), Event::greaterPartner);
-      arrivals->pop_back();
+      // Remove the arrival events corresponding to this departure
+      if (isSusceptible) {
+        std::pop_heap(susceptibleArrivals.begin(), susceptibleArrivals.end(),
+          Event::greaterPartner);
+        susceptibleArrivals.pop_back();
+      }
+      if (isInfectious) {
+        std::pop_heap(infectiousArrivals.begin(), infectiousArrivals.end(),
+          Event::greaterPartner);
+        infectiousArrivals.pop_back();
+      }
+
+      // Everyone of the other kind still here gets checked against this visitor
+      numPairs += (isSusceptible ? infectiousArrivals.size() : 0)
+        + (isInfectious ? susceptibleArrivals.size() : 0);
 
 #if OUTPUT_FLAGS & OUTPUT_OVERLAPS
-      saveInteractions(*loc, event, interactionsFile);
+      saveInteractions(*loc, event);
 #endif
 
-      onDeparture(loc, event);
+      onDeparture(loc, event, replicates);
     }
   }
+  timings.add(PAIRS_EVALUATED, numPairs);
+#ifdef ENABLE_LB
+  pairChecks += numPairs;
+#endif  // ENABLE_LB
+  for (std::unordered_map<Id, std::vector<Interaction> > &replicateInteractions
+      : interactions) {
+    replicateInteractions.clear();
+  }
   loc->reset();
-  interactions.clear();
 
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   double p = scenario->contactModel->getContactProbability(*loc);
@@ -502,16 +869,19 @@ Counter Locations::processEvents(Location *loc) {
 
 #if OUTPUT_FLAGS & OUTPUT_OVERLAPS
 Counter Locations::saveInteractions(const Location &loc,
-    const Event &departure, std::ofstream *out) {
+    const Event &departure) {
+  OutputWriter *writer = scenario->outputWriter;
   Counter duration = 0;
   Time end = departure.scheduledTime;
   for (const Event &a : susceptibleArrivals) {
     if (Event::overlap(a, departure)) {
-      if (NULL != out) {
-        *out << loc.getUniqueId() << "," << departure.personIdx << ","
-          << departure.partnerTime << ","  << departure.scheduledTime << ","
-          << a.personIdx << "," << a.scheduledTime << "," << a.partnerTime
-          << std::endl;
+      // Order the pair so that sampling doesn't depend on who left first
+      if (writer->isSampled(day, std::min(departure.personIdx, a.personIdx),
+          std::max(departure.personIdx, a.personIdx))) {
+        OverlapRecord record { day, loc.getUniqueId(), departure.personIdx,
+          departure.partnerTime, departure.scheduledTime, a.personIdx,
+          a.scheduledTime, a.partnerTime };
+        writer->write(record);
       }
 
       Time start = std::max(a.scheduledTime, departure.partnerTime);
@@ -520,11 +890,13 @@ Counter Locations::saveInteractions(const Location &loc,
   }
   for (const Event &a : infectiousArrivals) {
     if (Event::overlap(a, departure)) {
-      if (NULL != out) {
-        *out << loc.getUniqueId() << "," << departure.personIdx << ","
-          << departure.partnerTime << ","  << departure.scheduledTime << ","
-          << a.personIdx << "," << a.scheduledTime << "," << a.partnerTime
-          << std::endl;
+      // Order the pair so that sampling doesn't depend on who left first
+      if (writer->isSampled(day, std::min(departure.personIdx, a.personIdx),
+          std::max(departure.personIdx, a.personIdx))) {
+        OverlapRecord record { day, loc.getUniqueId(), departure.personIdx,
+          departure.partnerTime, departure.scheduledTime, a.personIdx,
+          a.scheduledTime, a.partnerTime };
+        writer->write(record);
       }
 
       Time start = std::max(a.scheduledTime, departure.partnerTime);
@@ -535,19 +907,20 @@ Counter Locations::saveInteractions(const Location &loc,
 }
 #endif  // OUTPUT_OVERLAPS
 
-// Simple dispatch to the susceptible/infectious depature handlers
-inline void Locations::onDeparture(Location *loc, const Event& departure) {
-  DiseaseModel *diseaseModel = scenario->diseaseModel;
-  if (diseaseModel->isSusceptible(departure.personState)) {
-    onSusceptibleDeparture(loc, departure);
-
-  } else if (diseaseModel->isInfectious(departure.personState)) {
+// Simple dispatch to the susceptible/infectious depature handlers (someone
+// who is susceptible in some replicates and infectious in others needs both)
+inline void Locations::onDeparture(Location *loc, const Event& departure,
+    const ReplicateMasks &replicates) {
+  if (0 != replicates.susceptible) {
+    onSusceptibleDeparture(loc, departure, replicates.susceptible);
+  }
+  if (0 != replicates.infectious) {
     onInfectiousDeparture(loc, departure);
   }
 }
 
 void Locations::onSusceptibleDeparture(Location *loc,
-    const Event& susceptibleDeparture) {
+    const Event& susceptibleDeparture, ReplicateMask replicates) {
   // Each infectious person at this location might have infected this
   // susceptible person
   for (const Event &infectiousArrival : infectiousArrivals) {
@@ -558,7 +931,11 @@ void Locations::onSusceptibleDeparture(Location *loc,
         susceptibleDeparture.scheduledTime);
   }
 
-  sendInteractions(loc, susceptibleDeparture.personIdx);
+  for (int r = 0; 0 != replicates; ++r, replicates >>= 1) {
+    if (replicates & 1) {
+      sendInteractions(loc, susceptibleDeparture.personIdx, r);
+    }
+  }
 }
 
 void Locations::onInfectiousDeparture(Location *loc,
@@ -577,29 +954,71 @@ void Locations::onInfectiousDeparture(Location *loc,
 inline void Locations::registerInteraction(Location *loc,
     const Event &susceptibleEvent, const Event &infectiousEvent,
     Time startTime, Time endTime) {
-  if (!scenario->contactModel->madeContact(susceptibleEvent, infectiousEvent, loc)) {
-    return;
+  // With a single replicate, we only get here for a susceptible visitor and
+  // an infectious one, but otherwise only replicates where one is
+  // susceptible and the other infectious count
+  bool hasReplicates = 1 < scenario->numReplicates;
+  ReplicateMask replicates = 1;
+  if (hasReplicates) {
+    replicates = susceptibleEvent.replicates.susceptible
+      & infectiousEvent.replicates.infectious;
   }
 
-  exposureDuration += endTime - startTime;
-  // CkPrintf("  inf: %ld sus: %ld dt: "COUNTER_PRINT_TYPE"\n",
-  //     infectiousEvent.personIdx, susceptibleEvent.personIdx,
-  //     endTime - startTime);
-  double propensity = scenario->diseaseModel->getPropensity(
-    susceptibleEvent.personState, infectiousEvent.personState, startTime, endTime,
-    susceptibleEvent.transmissionModifier, infectiousEvent.transmissionModifier);
+  // Each replicate draws from its own generator, so that replicates are
+  // independent of each other rather than all making the same contacts
+  for (int r = 0; 0 != replicates; ++r, replicates >>= 1) {
+    if (0 == (replicates & 1)) {
+      continue;
+    }
+    loc->swapReplicate(r);
+    bool madeContact = scenario->contactModel->madeContact(susceptibleEvent,
+      infectiousEvent, loc);
+    loc->swapReplicate(r);
+    if (!madeContact) {
+      continue;
+    }
 
-  // Note that this will create a new vector if this is the first potential
-  // infection for the susceptible person in question
-  Interaction inter { propensity, infectiousEvent.personIdx,
-    infectiousEvent.personState, startTime, endTime };
-  interactions[susceptibleEvent.personIdx].emplace_back(inter);
+    exposureDuration += endTime - startTime;
+    // CkPrintf("  inf: %ld sus: %ld dt: "COUNTER_PRINT_TYPE"\n",
+    //     infectiousEvent.personIdx, susceptibleEvent.personIdx,
+    //     endTime - startTime);
+    DiseaseState susceptibleState = susceptibleEvent.single.personState;
+    double susceptibility = susceptibleEvent.single.transmissionModifier;
+    DiseaseState infectiousState = infectiousEvent.single.personState;
+    double infectivity = infectiousEvent.single.transmissionModifier;
+    if (hasReplicates) {
+      const PersonState &susceptible =
+        visitorStates[r][susceptibleEvent.personIdx];
+      const PersonState &infectious = visitorStates[r][infectiousEvent.personIdx];
+      susceptibleState = susceptible.state;
+      susceptibility = susceptible.transmissionModifier;
+      infectiousState = infectious.state;
+      infectivity = infectious.transmissionModifier;
+    }
+    double propensity = scenario->diseaseModel->getPropensity(
+      susceptibleState, infectiousState, startTime, endTime, susceptibility,
+      infectivity, r);
+
+    // Note that this will create a new vector if this is the first potential
+    // infection for the susceptible person in question
+    Interaction inter { propensity, infectiousEvent.personIdx,
+      infectiousState, startTime, endTime };
+    interactions[r][susceptibleEvent.personIdx].emplace_back(inter);
+  }
 }
 
 // Simple helper function which send the list of interactions with the
 // specified person to the appropriate People chare
 inline void Locations::sendInteractions(Location *loc,
-    Id personIdx) {
+    Id personIdx, int replicate) {
+  // Nothing to send if they didn't meet anyone infectious in this replicate
+  std::unordered_map<Id, std::vector<Interaction> > &replicateInteractions =
+    interactions[replicate];
+  auto personInteractions = replicateInteractions.find(personIdx);
+  if (replicateInteractions.end() == personInteractions) {
+    return;
+  }
+
   Partitioner *partitioner = scenario->partitioner;
   PartitionId personPartition = partitioner->getPersonPartitionIndex(personIdx);
 #ifdef ENABLE_DEBUG
@@ -612,13 +1031,21 @@ inline void Locations::sendInteractions(Location *loc,
   }
 #endif
 
-  InteractionMessage interMsg(loc->getUniqueId(), personIdx,
-      interactions[personIdx]);
+  Analytics *analytics = scenario->analytics;
+  int locationType = analytics->isEnabled(ANALYTICS_LOCATION_TYPES)
+    ? analytics->getLocationType(*loc) : -1;
+  InteractionMessage interMsg(loc->getUniqueId(), personIdx, replicate,
+      personInteractions->second, locationType);
+  // Sizing messages means packing them, so only do it if it's reported
+  if (scenario->timingReport) {
+    timings.addMessage(&interMsg);
+  }
 #ifdef USE_HYPERCOMM
   Aggregator *agg = aggregatorProxy.ckLocalBranch();
   if (agg->interact_aggregator) {
     agg->interact_aggregator->send(peopleArray[personPartition], interMsg);
-    continue;
+    replicateInteractions.erase(personInteractions);
+    return;
   }
 #endif  // USE_HYPERCOMM
 
@@ -626,7 +1053,7 @@ inline void Locations::sendInteractions(Location *loc,
 
   // CkPrintf(
   //   "    Sending %d interactions to person %d in partition %d\r\n",
-  //   (int) interactions[personIdx].size(),
+  //   (int) personInteractions->second.size(),
   //   personIdx,
   //   personPartition
   // );
@@ -634,7 +1061,7 @@ inline void Locations::sendInteractions(Location *loc,
   // Free up space where we were storing interactions data. This also prevents
   // interactions from being sent multiple times if this person has multiple
   // visits to this location
-  interactions.erase(personIdx);
+  replicateInteractions.erase(personInteractions);
 }
 
 void Locations::ReceiveIntervention(PartitionId interventionIdx) {
@@ -649,13 +1076,116 @@ void Locations::ReceiveIntervention(PartitionId interventionIdx) {
   }
 }
 
+/**
+ * Moves this chare to the PE Main picked to keep it near the People chares
+ * whose people visit it most
+ */
+void Locations::Colocate(int numPes, int *pes) {
+  if (CkMyPe() != pes[thisIndex]) {
+    migrateMe(pes[thisIndex]);
+  }
+}
+
+void Locations::SaveCheckpoint(std::string directory) {
+  saveCheckpoint(getCheckpointFile(directory, "locations", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointSaved), mainProxy));
+}
+
+void Locations::RestoreCheckpoint(std::string directory) {
+  loadCheckpoint(getCheckpointFile(directory, "locations", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointRestored),
+    mainProxy));
+}
+
+void Locations::SaveSnapshot(std::string directory) {
+  saveSnapshot(getCheckpointFile(directory, "locations", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointSaved), mainProxy));
+}
+
+void Locations::LoadSnapshot(std::string directory) {
+  loadSnapshot(getCheckpointFile(directory, "locations", thisIndex), this);
+  initializeLocations();
+}
+
+/**
+ * Saves or restores our locations and their visits as they are right after
+ * startup, which is everything we'd pack up to migrate
+ */
+void Locations::pupSnapshot(PUP::er &p) {
+  pupCheckpointMatch(p, numLocalLocations, "number of locations on a chare");
+  pup(p);
+#ifdef ENABLE_LB
+  migratedOnDay = -1;
+#endif  // ENABLE_LB
+}
+
+/**
+ * Saves or restores everything about our locations that changes as the
+ * simulation runs, which is just the day, their generators (in every
+ * replicate) and what interventions have done to them, since visitors'
+ * states are sent anew each day
+ */
+void Locations::pupCheckpoint(PUP::er &p) {
+  pupCheckpointMatch(p, numLocalLocations, "number of locations on a chare");
+  p | day;
+  InterventionModel *interventions = scenario->interventionModel;
+  bool sameInterventions = interventions->pupCheckpointHash(p);
+  for (Location &location : locations) {
+    p | *location.getGenerator();
+    p | location.replicateGenerators;
+    interventions->pupLocation(p, &location, scenario->locationAttributes,
+      sameInterventions);
+  }
+}
+
+#ifdef ENABLE_BENCHMARKS
+/**
+ * Runs the benchmarks in place of the simulation, using this chare's
+ * locations and the scenario it was loaded with
+ */
+void Locations::RunBenchmarks() {
+  runBenchmarks(this, scenario);
+  CkExit();
+}
+#endif  // ENABLE_BENCHMARKS
+
 #ifdef ENABLE_LB
+/**
+ * Sends Main our predicted load for tomorrow, so it can decide whether the
+ * PEs are imbalanced enough to be worth load balancing
+ */
+void Locations::ReportPredictedLoad() {
+  std::vector<double> loads(CkNumPes(), 0.0);
+  loads[CkMyPe()] = loadPredictor.getPredictedLoad();
+  CkCallback cb(CkReductionTarget(Main, ReceivePredictedLoads), mainProxy);
+  contribute(loads, CkReduction::sum_double, cb);
+}
+
+/**
+ * Gives the load balancer our predicted load rather than a measured one,
+ * since the load on a location depends on how many of its visitors are
+ * infectious, which changes over the course of the epidemic
+ */
+void Locations::UserSetLBLoad() {
+  setObjTime(loadPredictor.getPredictedLoad());
+}
+
 void Locations::ResumeFromSync() {
 #if ENABLE_DEBUG >= DEBUG_PER_CHARE
   CkPrintf("  Done load balancing on location chare %d\n", thisIndex);
 #endif
 
+  loadPredictor.reset();
+
+  // Let Main know how much data load balancing moved
+  std::vector<Id> migrationStats(2, 0);
+  if (migratedOnDay == day) {
+    PUP::sizer sizer;
+    pup(sizer);
+    migrationStats[0] = 1;
+    migrationStats[1] = sizer.size();
+  }
   CkCallback cb(CkReductionTarget(Main, locationsLBComplete), mainProxy);
-  contribute(cb);
+  contribute(migrationStats, CkReduction::CONCAT(sum_, ID_REDUCTION_TYPE), cb);
 }
 #endif  // ENABLE_LB
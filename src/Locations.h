@@ -10,27 +10,64 @@
 #include "Types.h"
 #include "Location.h"
 #include "Scenario.h"
+#include "LoadPredictor.h"
+#include "TimingReport.h"
 #include "Location.h"
 #include "contact_model/ContactModel.h"
+#include "readers/NodeDataLoader.h"
 
 #include <vector>
 #include <set>
 #include <string>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 
 class Locations : public CBase_Locations {
+#ifdef ENABLE_BENCHMARKS
+  // So processEvents can be benchmarked directly (see benchmarks/)
+  friend struct LocationsBenchmark;
+#endif
+
  private:
   Id numLocalLocations;
   Id firstLocalLocationIdx;
   std::vector<Location> locations;
   Scenario *scenario;
-  std::ofstream *interactionsFile;
   Counter exposureDuration;
   Counter expectedExposureDuration;
   int day;
 
-  std::unordered_map<Id, PersonState> visitorStates;
+  // The current state of each of our visitors, in each replicate, along with
+  // which replicates each of them is susceptible or infectious in
+  std::vector<std::unordered_map<Id, PersonState> > visitorStates;
+  std::unordered_map<Id, ReplicateMasks> visitorReplicates;
+
+  // Used when paging visits: everyone who visits any of our locations on
+  // any day (needed before any days are paged in), which days are resident,
+  // the visits file they're paged in from, and where our visits end in it
+  std::unordered_set<Id> scheduledVisitors;
+  std::vector<bool> isDayResident;
+  std::unique_ptr<FileSliceStream> visitFile;
+  CacheOffset visitsEnd;
+
+  // How long we spent on each phase of today, how much work we did, and
+  // which of our locations took the longest
+  ChareTimings timings;
+
+#ifdef ENABLE_LB
+  // Used to predict tomorrow's load from how much work we did today: the
+  // work of sorting each location's events, the number of times a departing
+  // visitor had to be checked against someone of the other kind, and the
+  // number of infectious visits, which drives the latter
+  LoadPredictor loadPredictor;
+  double eventWork;
+  Counter pairChecks;
+  Counter infectiousVisits;
+  // The day we arrived on, if we've been migrated
+  int migratedOnDay;
+#endif  // ENABLE_LB
 
   // For random generation.
   static std::uniform_real_distribution<> unitDistrib;
@@ -41,17 +78,24 @@ class Locations : public CBase_Locations {
   std::vector<Event> susceptibleArrivals;
 
   // Maps each susceptible person's id to a list of interactions with people
-  // who could have infected them
-  std::unordered_map<Id, std::vector<Interaction> > interactions;
+  // who could have infected them, in each replicate
+  std::vector<std::unordered_map<Id, std::vector<Interaction> > > interactions;
 
   // Runs through all of the current events and return the indices of
   // any people who have been infected
   Counter processEvents(Location *loc);
+  inline void addReplicateState(ReplicateMasks *masks, DiseaseState state,
+    int replicate) const;
+  inline ReplicateMasks getReplicates(const Event &event) const;
+  inline void queueVisit(Location *location, const VisitMessage &visit,
+    Time shift);
 
   // Helper functions to handle when a person leaves a location
   // onDeparture branches to one of the two other functions
-  inline void onDeparture(Location *loc, const Event& departure);
-  void onSusceptibleDeparture(Location *loc, const Event& departure);
+  inline void onDeparture(Location *loc, const Event& departure,
+    const ReplicateMasks &replicates);
+  void onSusceptibleDeparture(Location *loc, const Event& departure,
+    ReplicateMask replicates);
   void onInfectiousDeparture(Location *loc, const Event& departure);
 
   // Helper function which packages all the neccessary information about
@@ -62,27 +106,50 @@ class Locations : public CBase_Locations {
 
   // Simple helper function which send the list of interactions with the
   // specified person to the appropriate People chare
-  inline void sendInteractions(Location *loc, Id personIdx);
+  inline void sendInteractions(Location *loc, Id personIdx, int replicate);
 
 #if OUTPUT_FLAGS & OUTPUT_OVERLAPS
-  Counter saveInteractions(const Location &loc, const Event &departure,
-    std::ofstream *out);
+  Counter saveInteractions(const Location &loc, const Event &departure);
 #endif
   void loadLocationData(std::string scenarioPath);
-  void loadVisitData(std::ifstream *activityData);
+  void deduplicateSchedules();
+  void setVisitOffsets(const std::vector<CacheOffset> &visitOffsets);
+  void loadVisitData(std::istream *activityData);
+  Id readDayVisits(std::istream *visitData, Location *location, int day,
+    Time firstDay, std::vector<VisitMessage> *dayVisits,
+    std::vector<std::vector<VisitMessage> > *laterVisits,
+    std::unordered_set<Id> *visitors);
+  void pageInVisits(int dayIdx);
+  void pageOutVisits(int dayIdx);
+  CacheOffset getScheduleEnd(Id localIdx, int dayIdx) const;
+  void initializeLocations();
 
  public:
   explicit Locations(int seed, std::string scenarioPath);
   explicit Locations(CkMigrateMessage *msg);
   void pup(PUP::er &p);  // NOLINT(runtime/references)
+  void LoadData();
   void ReceiveVisitSchedule(VisitScheduleMessage msg);
   void SendExpectedVisitors();
   void ReceiveVisitorStates(PersonStatesMessage msg);
   void QueueVisits();
+  void PrefetchVisits(int dayIdx);
   void ReceiveVisitMessages(VisitMessage visitMsg);
   void ComputeInteractions();  // calls ReceiveInfections
   void ReceiveIntervention(PartitionId interventionIdx);
+  void Colocate(int numPes, int *pes);
+  void SaveCheckpoint(std::string directory);
+  void RestoreCheckpoint(std::string directory);
+  void pupCheckpoint(PUP::er &p);  // NOLINT(runtime/references)
+  void SaveSnapshot(std::string directory);
+  void LoadSnapshot(std::string directory);
+  void pupSnapshot(PUP::er &p);  // NOLINT(runtime/references)
+  #ifdef ENABLE_BENCHMARKS
+  void RunBenchmarks();
+  #endif  // ENABLE_BENCHMARKS
   #ifdef ENABLE_LB
+  void ReportPredictedLoad();
+  void UserSetLBLoad();
   void ResumeFromSync();
   #endif  // ENABLE_LB
 };
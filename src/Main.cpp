@@ -11,9 +11,13 @@
 #include "Locations.h"
 #include "DiseaseModel.h"
 #include "Partitioner.h"
+#include "ColocationMap.h"
+#include "Checkpoint.h"
+#include "TimingReport.h"
 #include "contact_model/ContactModel.h"
 #include "readers/Parse.h"
 #include "readers/Preprocess.h"
+#include "partitioning/PopulationPartitioner.h"
 
 #include <string>
 #include <tuple>
@@ -27,6 +31,7 @@
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
+#include <algorithm>
 #include <sys/resource.h>
 
 #ifdef USE_HYPERCOMM
@@ -38,9 +43,15 @@
 #include "gtest/gtest.h"
 #endif
 
+#ifdef ENABLE_BENCHMARKS
+#include "benchmark/benchmark.h"
+#endif
+
 /* readonly */ CProxy_Main mainProxy;
 /* readonly */ CProxy_People peopleArray;
 /* readonly */ CProxy_Locations locationsArray;
+/* readonly */ CProxy_ColocationMap peopleMap;
+/* readonly */ CProxy_ColocationMap locationsMap;
 #ifdef USE_HYPERCOMM
 /* readonly */ CProxy_Aggregator aggregatorProxy;
 #endif
@@ -98,6 +109,20 @@ class TraceSwitcher : public CBase_TraceSwitcher {
   #endif  // ENABLE_LB
 };
 
+/**
+ * Returns where the given replicate's copy of the output at path should
+ * go, by adding the replicate's index to the end of the file name (before
+ * the extension, if it has one)
+ */
+static std::string getReplicatePath(const std::string &path, int replicate) {
+  std::string suffix = "_" + std::to_string(replicate);
+  std::size_t extension = path.rfind('.');
+  if (std::string::npos == extension || path.rfind('/') > extension) {
+    return path + suffix;
+  }
+  return path.substr(0, extension) + suffix + path.substr(extension);
+}
+
 Main::Main(CkArgMsg* msg) {
   mainProxy = thisProxy;
 
@@ -105,15 +130,116 @@ Main::Main(CkArgMsg* msg) {
   CkPrintf("Debug printing enabled (verbosity at level %d)\n", ENABLE_DEBUG);
 #endif
 
+#ifdef ENABLE_BENCHMARKS
+  // This takes out the benchmarks' own flags, leaving the usual arguments
+  // to set up the scenario the benchmarks run in
+  benchmark::Initialize(&msg->argc, msg->argv);
+#endif
+
   Arguments args;
   parse(msg->argc, msg->argv, &args);
   delete msg;
 
   profile.stepStartTime = CkWallTimer();
 
+  // Every node loads from the renumbered population, so this has to be done
+  // before any of them start reading. Partitioning renumbers everything
+  // anyway, so there's no need to remap ids separately when doing both
+  if ((args.multilevelPartition || args.remapIds) && !args.isOnTheFlyRun) {
+    PartitionId numPersonOffsets =
+      args.partitionsToOffsetsRatio * args.numPersonPartitions;
+    PartitionId numLocationOffsets =
+      args.partitionsToOffsetsRatio * args.numLocationPartitions;
+    std::string renumberedPath = args.multilevelPartition
+      ? partitionPopulation(args.scenarioPath, args.cachePath,
+        numPersonOffsets, numLocationOffsets, args.seed)
+      : densifyPopulation(args.scenarioPath, args.cachePath,
+        numPersonOffsets, numLocationOffsets);
+    if (args.cachePath == args.scenarioPath) {
+      args.cachePath = renumberedPath;
+    }
+    args.scenarioPath = renumberedPath;
+  }
+
   globScenario = CProxy_Scenario::ckNew(args);
   scenario = globScenario.ckLocalBranch();
-  accumulated.resize(scenario->diseaseModel->getNumberOfStates(), 0);
+  accumulated.resize(scenario->diseaseModel->getNumberOfStates()
+    * scenario->numReplicates, 0);
+  initialInfections.resize(scenario->numReplicates);
+
+  // Open output csv (one for each replicate, if there's more than one)
+#ifdef OUTPUT_FLAGS
+  std::string summaryPath = scenario->outputPath + "summary.csv";
+#else
+  std::string summaryPath = scenario->outputPath;
+#endif
+  summaryPaths.resize(scenario->numReplicates);
+  summaryFiles.resize(scenario->numReplicates);
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    summaryPaths[r] = 1 == scenario->numReplicates ? summaryPath
+      : getReplicatePath(summaryPath, r);
+    summaryFiles[r].open(summaryPaths[r]);
+    if (!summaryFiles[r]) {
+      CkAbort("Error: invalid output path, %s\n", summaryPaths[r].c_str());
+    }
+
+    // Write header row (when restarting, this comes with the summary so far)
+    if (!scenario->isRestart()) {
+      summaryFiles[r] << "day,state,total_in_state,change_in_state"
+        << std::endl;
+    }
+  }
+
+  firstDay = 0;
+  lastInfectiousCount = 0;
+  if (!scenario->checkpointPath.empty()) {
+    createDirectory(scenario->checkpointPath, ".");
+  }
+  if (scenario->isRestart()) {
+    LoadCheckpoint();
+  }
+
+  if (scenario->analytics->isEnabled()) {
+#ifdef OUTPUT_FLAGS
+    std::string analyticsPath = scenario->outputPath + "analytics.csv";
+#else
+    std::string analyticsPath = scenario->outputPath + ".analytics.csv";
+#endif
+    analyticsFiles.resize(scenario->numReplicates);
+    infectionsByAge.resize(scenario->numReplicates);
+    peopleByAge.resize(scenario->numReplicates);
+    for (int r = 0; r < scenario->numReplicates; ++r) {
+      std::string replicatePath = 1 == scenario->numReplicates ? analyticsPath
+        : getReplicatePath(analyticsPath, r);
+      analyticsFiles[r].open(replicatePath);
+      if (!analyticsFiles[r]) {
+        CkAbort("Error: invalid output path, %s\n", replicatePath.c_str());
+      }
+      analyticsFiles[r] << "day,metric,bin,value" << std::endl;
+    }
+  }
+
+  if (scenario->timingReport) {
+#ifdef OUTPUT_FLAGS
+    std::string timingPath = scenario->outputPath + "timing.csv";
+    std::string slowestPath = scenario->outputPath + "slowest_locations.csv";
+#else
+    std::string timingPath = scenario->outputPath + ".timing.csv";
+    std::string slowestPath = scenario->outputPath + ".slowest_locations.csv";
+#endif
+    timingFile.open(timingPath);
+    if (!timingFile) {
+      CkAbort("Error: invalid output path, %s\n", timingPath.c_str());
+    }
+    timingFile << "day,chares,metric,statistic,value" << std::endl;
+
+    slowestLocationsFile.open(slowestPath);
+    if (!slowestLocationsFile) {
+      CkAbort("Error: invalid output path, %s\n", slowestPath.c_str());
+    }
+    slowestLocationsFile << "day,rank,location,chare,events,seconds"
+      << std::endl;
+  }
 
   CkPrintf("\nFinished loading shared/global data in %lf seconds.\n",
       CkWallTimer() - profile.stepStartTime);
@@ -155,14 +281,35 @@ Main::Main(CkArgMsg* msg) {
       onTheFly->averageVisitsPerDay);
   }
 
-  chareCount = numPersonPartitions;  // Number of chare arrays/groups
+  // Number of chares which must finish loading their data before we start
+#ifdef USE_HYPERCOMM
+  // The locations and the aggregators each report with a single reduction
+  chareCount = numPersonPartitions + 2;
+#else
+  chareCount = numPersonPartitions + numLocationPartitions;
+#endif
   createdCount = 0;
   profile.stepStartTime = CkWallTimer();
 
+  peopleMap = CProxy_ColocationMap::ckNew(numPersonPartitions);
+  CkArrayOptions peopleOptions(numPersonPartitions);
+  peopleOptions.setMap(peopleMap);
   peopleArray = CProxy_People::ckNew(scenario->seed, scenario->scenarioPath,
-    numPersonPartitions);
+    peopleOptions);
+
+  locationsMap = CProxy_ColocationMap::ckNew(numLocationPartitions);
+  CkArrayOptions locationsOptions(numLocationPartitions);
+  locationsOptions.setMap(locationsMap);
   locationsArray = CProxy_Locations::ckNew(scenario->seed, scenario->scenarioPath,
-    numLocationPartitions);
+    locationsOptions);
+
+  // Each node reads in the data for all of its chares at once, unless they
+  // can all just be restored from a snapshot
+  if (scenario->hasStartupSnapshot) {
+    LoadStartupSnapshot();
+  } else if (!scenario->isOnTheFly()) {
+    globScenario.LoadData();
+  }
 
 #ifdef ENABLE_TRACING
   traceArray = CProxy_TraceSwitcher::ckNew();
@@ -224,12 +371,28 @@ void Main::CharesCreated() {
     CkPrintf("\nFinished loading people and location data in %lf seconds.\n",
         CkWallTimer() - profile.stepStartTime);
 
+#ifdef ENABLE_BENCHMARKS
+    // The benchmarks run on a single chare, which exits when they finish
+    locationsArray[0].RunBenchmarks();
+#else
     mainProxy.run();
+#endif
   }
 }
 
 void Main::SeedInfections() {
-  std::default_random_engine generator(scenario->seed);
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    SeedInfections(r);
+  }
+}
+
+/**
+ * Infects today's share of the initial infections in the given replicate.
+ * Each replicate picks its own initial infections, using its own seed
+ */
+void Main::SeedInfections(int replicate) {
+  std::default_random_engine generator(scenario->seed + replicate);
+  std::vector<Id> &infections = initialInfections[replicate];
 
   // Determine all of the intitial infections on the first day so we can
   // guarentee they are unique (not checking this quickly runs into birthday
@@ -246,7 +409,7 @@ void Main::SeedInfections() {
         * scenario->numDaysToSeedOutbreak,
       scenario->numPeople);
     std::unordered_set<Id> initialInfectionsSet;
-    initialInfections.reserve(totalInitialInfections);
+    infections.reserve(totalInitialInfections);
 
     // Use set to check membership because it's faster and we can spare the
     // memory; totalInitialInfections should be fairly small
@@ -254,7 +417,7 @@ void Main::SeedInfections() {
     while (initialInfectionsSet.size() < totalInitialInfections) {
       Id personIdx = personDistrib(generator);
       if (initialInfectionsSet.count(personIdx) == 0) {
-        initialInfections.emplace_back(personIdx);
+        infections.emplace_back(personIdx);
         initialInfectionsSet.emplace(personIdx);
       }
     }
@@ -262,10 +425,10 @@ void Main::SeedInfections() {
 
   // Check for empty is to avoid issues with small test populations
   for (int i = 0;
-      i < scenario->numInitialInfectionsPerDay && !initialInfections.empty();
+      i < scenario->numInitialInfectionsPerDay && !infections.empty();
       ++i) {
-    Id personIdx = initialInfections.back();
-    initialInfections.pop_back();
+    Id personIdx = infections.back();
+    infections.pop_back();
 
     PartitionId peoplePartitionIdx =
       scenario->partitioner->getPersonPartitionIndex(personIdx);
@@ -275,7 +438,7 @@ void Main::SeedInfections() {
     interactions.emplace_back(
       std::numeric_limits<double>::max(), -1, -1, -1, -1);
 
-    InteractionMessage interMsg(-1, personIdx, interactions);
+    InteractionMessage interMsg(-1, personIdx, replicate, interactions, -1);
     #ifdef USE_HYPERCOMM
     Aggregator* agg = aggregatorProxy.ckLocalBranch();
     if (agg->interact_aggregator) {
@@ -289,42 +452,340 @@ void Main::SeedInfections() {
   }
 }
 
-void Main::SaveStats(Id *data) {
+/**
+ * Appends the number of people in each state at the end of the current day
+ * to the summary file
+ */
+void Main::SaveStats(const Id *stateCounts) {
   DiseaseModel *diseaseModel = scenario->diseaseModel;
   DiseaseState numDiseaseStates = diseaseModel->getNumberOfStates();
 
-  // Open output csv
-#ifdef OUTPUT_FLAGS
-  std::ofstream outFile(scenario->outputPath + "summary.csv");
-#else
-  std::ofstream outFile(scenario->outputPath);
-#endif
-  if (!outFile) {
-    CkAbort("Error: invalid output path, %s\n", scenario->outputPath.c_str());
-  }
-
-  // Write header row
-  outFile << "day,state,total_in_state,change_in_state" << std::endl;
-
-  for (day = 0; day < scenario->numDays; ++day, data += numDiseaseStates) {
-    // Get number of disease state changes.
+  // Get number of disease state changes (each replicate's counts come one
+  // after another)
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    std::ofstream &summaryFile = summaryFiles[r];
     for (DiseaseState i = 0; i < numDiseaseStates; i++) {
-      Id num_in_state = data[i];
-      Id change_in_state = num_in_state - accumulated[i];
+      int idx = r * numDiseaseStates + i;
+      Id num_in_state = stateCounts[idx];
+      Id change_in_state = num_in_state - accumulated[idx];
       if (num_in_state != 0 || change_in_state != 0) {
         // Write out data for state on that day
-        outFile << day << ","
+        summaryFile << day << ","
           << diseaseModel->lookupStateName(i) << ","
           << num_in_state << ","
-          << change_in_state << std::endl;
+          << change_in_state << "\n";
       }
-      accumulated[i] = num_in_state;
+      accumulated[idx] = num_in_state;
     }
+    summaryFile.flush();
+  }
+}
+
+/**
+ * Appends the current day's in-situ analytics (see Analytics.h) to each
+ * replicate's analytics file
+ */
+void Main::SaveAnalytics(const Id *histogramData) {
+  Histograms joined;
+  joined.addPacked(histogramData);
+  std::vector<Histograms> replicates = joined.split(scenario->numReplicates);
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    SaveAnalytics(r, replicates[r]);
+  }
+}
+
+/**
+ * Appends the current day's in-situ analytics for a single replicate to
+ * its analytics file
+ */
+void Main::SaveAnalytics(int replicate, const Histograms &histograms) {
+  const Analytics *analytics = scenario->analytics;
+  std::ofstream &analyticsFile = analyticsFiles[replicate];
+  std::vector<Id> &peopleByAge = this->peopleByAge[replicate];
+  std::vector<Id> &infectionsByAge = this->infectionsByAge[replicate];
+
+  const std::vector<Id> &locationTypes =
+    histograms.bins[INFECTIONS_BY_LOCATION_TYPE];
+  for (std::size_t i = 0; i < locationTypes.size(); ++i) {
+    analyticsFile << day << ",infections_by_location_type,"
+      << analytics->getLocationTypeName(i) << "," << locationTypes[i] << "\n";
   }
 
-  outFile.close();
-  // CkPrintf("  Found %lu visits and %lu interactions in summaries\n",
-  //     numVisits, numInteractions);
+  const std::vector<Id> &secondaryCases = histograms.bins[SECONDARY_CASES];
+  Id numInfectors = 0;
+  Id numSecondaryCases = 0;
+  for (std::size_t i = 0; i < secondaryCases.size(); ++i) {
+    analyticsFile << day << ",secondary_cases," << i << ","
+      << secondaryCases[i] << "\n";
+    numInfectors += secondaryCases[i];
+    numSecondaryCases += i * secondaryCases[i];
+  }
+  if (0 != numInfectors) {
+    analyticsFile << day << ",mean_secondary_cases,,"
+      << static_cast<double>(numSecondaryCases) / numInfectors << "\n";
+  }
+
+  const std::vector<Id> &intervals = histograms.bins[GENERATION_INTERVALS];
+  for (std::size_t i = 0; i < intervals.size(); ++i) {
+    analyticsFile << day << ",generation_interval," << i << ","
+      << intervals[i] << "\n";
+  }
+
+  // People are only counted on the first day
+  const std::vector<Id> &people = histograms.bins[PEOPLE_BY_AGE];
+  if (peopleByAge.size() < people.size()) {
+    peopleByAge.resize(people.size(), 0);
+  }
+  for (std::size_t i = 0; i < people.size(); ++i) {
+    peopleByAge[i] += people[i];
+  }
+  const std::vector<Id> &infections = histograms.bins[INFECTIONS_BY_AGE];
+  if (infectionsByAge.size() < infections.size()) {
+    infectionsByAge.resize(infections.size(), 0);
+  }
+  for (std::size_t i = 0; i < infectionsByAge.size(); ++i) {
+    if (i < infections.size()) {
+      infectionsByAge[i] += infections[i];
+    }
+    if (0 != infectionsByAge[i] && i < peopleByAge.size()) {
+      analyticsFile << day << ",attack_rate," << i * AGE_BIN_WIDTH << "-"
+        << (i + 1) * AGE_BIN_WIDTH - 1 << ","
+        << static_cast<double>(infectionsByAge[i]) / peopleByAge[i] << "\n";
+    }
+  }
+  analyticsFile.flush();
+}
+
+/**
+ * Appends summaries of how long each kind of chare spent on each phase of
+ * the current day and how much work they did, along with the slowest
+ * locations, to the timing report (see TimingReport.h)
+ */
+void Main::SaveTimings(const char *peopleData,
+    const char *locationsData) {
+  static const double percentiles[] = { 0.5, 0.9, 0.99 };
+  TimingSummary people(peopleData);
+  TimingSummary locations(locationsData);
+  const TimingSummary *summaries[] = { &people, &locations };
+  const char *chareNames[] = { "people", "locations" };
+
+  for (int i = 0; i < 2; ++i) {
+    const TimingSummary *summary = summaries[i];
+    for (int m = 0; m < NUM_CHARE_METRICS; ++m) {
+      ChareMetric metric = static_cast<ChareMetric>(m);
+      std::string prefix = std::to_string(day) + "," + chareNames[i] + ","
+        + getChareMetricName(metric) + ",";
+      timingFile << prefix << "min," << summary->getMin(metric) << "\n"
+        << prefix << "mean," << summary->getMean(metric) << "\n"
+        << prefix << "max," << summary->getMax(metric) << "\n"
+        << prefix << "max_chare," << summary->getMaxChare(metric) << "\n";
+      for (double p : percentiles) {
+        timingFile << prefix << "p" << static_cast<int>(100 * p) << ","
+          << summary->getPercentile(metric, p) << "\n";
+      }
+    }
+  }
+  timingFile.flush();
+
+  const std::vector<LocationTiming> &slowest =
+    locations.getSlowestLocations();
+  for (std::size_t rank = 0; rank < slowest.size(); ++rank) {
+    const LocationTiming &location = slowest[rank];
+    slowestLocationsFile << day << "," << rank + 1 << ","
+      << location.locationIdx << "," << location.chare << ","
+      << location.numEvents << "," << location.time << "\n";
+  }
+  slowestLocationsFile.flush();
+
+  double meanTime = locations.getMean(INTERACTIONS_TIME);
+  if (0 < meanTime) {
+    CkPrintf("  Slowest locations chare (" PARTITION_ID_PRINT_TYPE ") took "
+      "%fs to compute interactions (%.2fx the mean)\n",
+      locations.getMaxChare(INTERACTIONS_TIME),
+      locations.getMax(INTERACTIONS_TIME),
+      locations.getMax(INTERACTIONS_TIME) / meanTime);
+  }
+}
+
+/**
+ * Saves what we need to pick the simulation back up at the start of the
+ * next day, along with the summaries so far, and then has every chare save
+ * its own state alongside them
+ */
+void Main::SaveCheckpoint() {
+  profile.stepStartTime = CkWallTimer();
+  std::string directory =
+    getCheckpointDirectory(scenario->checkpointPath, day + 1);
+  createDirectory(directory, scenario->checkpointPath);
+  saveCheckpoint(getCheckpointFile(directory, "main", 0), this);
+  saveCheckpoint(getCheckpointFile(directory, "interventions", 0),
+    scenario->interventionModel);
+
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    summaryFiles[r].flush();
+    std::ifstream summary(summaryPaths[r]);
+    std::ofstream savedSummary(getCheckpointFile(directory, "summary", r));
+    savedSummary << summary.rdbuf();
+    if (!savedSummary) {
+      CkAbort("Error: failed to save summary to checkpoint %s\n",
+        directory.c_str());
+    }
+  }
+
+  peopleArray.SaveCheckpoint(directory);
+  locationsArray.SaveCheckpoint(directory);
+}
+
+/**
+ * Picks up where the checkpoint we're restarting from left off, starting
+ * each summary off with the one saved in the checkpoint. The chares are
+ * restored separately, once they've been created
+ */
+void Main::LoadCheckpoint() {
+  const std::string &directory = scenario->restartPath;
+  loadCheckpoint(getCheckpointFile(directory, "main", 0), this);
+
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    std::string path = getCheckpointFile(directory, "summary", r);
+    std::ifstream savedSummary(path);
+    if (!savedSummary) {
+      CkAbort("Error: failed to open saved summary %s\n", path.c_str());
+    }
+    summaryFiles[r] << savedSummary.rdbuf();
+    summaryFiles[r].flush();
+  }
+  CkPrintf("Restarting from %s on day %d\n", directory.c_str(), firstDay);
+}
+
+void Main::pupCheckpoint(PUP::er &p) {
+  pupCheckpointMatch(p, scenario->numReplicates, "number of replicates");
+  pupCheckpointMatch(p, scenario->partitioner->getNumPersonPartitions(),
+    "number of people chares");
+  pupCheckpointMatch(p, scenario->partitioner->getNumLocationPartitions(),
+    "number of location chares");
+
+  // Checkpoints are taken at the end of a day, so we pick up on the next one
+  int nextDay = day + 1;
+  p | nextDay;
+  if (p.isUnpacking()) {
+    firstDay = nextDay;
+  }
+  p | accumulated;
+  p | initialInfections;
+  p | lastInfectiousCount;
+  p | infectionsByAge;
+  p | peopleByAge;
+}
+
+/**
+ * Has every chare save itself as it is right after startup. The snapshot is
+ * only marked as complete (see FinishStartupSnapshot) once they're all done
+ */
+void Main::SaveStartupSnapshot() {
+  profile.stepStartTime = CkWallTimer();
+  createDirectory(scenario->snapshotPath, scenario->cachePath);
+  peopleArray.SaveSnapshot(scenario->snapshotPath);
+  locationsArray.SaveSnapshot(scenario->snapshotPath);
+}
+
+void Main::FinishStartupSnapshot() {
+  const std::string &directory = scenario->snapshotPath;
+  saveSnapshot(getCheckpointFile(directory, "main", 0), this);
+
+  // Later runs only use the snapshot if this matches their caches
+  std::ofstream marker(directory + "/caches", std::ios_base::binary);
+  marker << scenario->dataLoader->getCacheHeaders();
+  if (!marker) {
+    CkAbort("Error: failed to save snapshot %s\n", directory.c_str());
+  }
+  CkPrintf("  Saving startup snapshot to %s took %fs\n", directory.c_str(),
+    CkWallTimer() - profile.stepStartTime);
+}
+
+/**
+ * Has every chare restore itself from the startup snapshot, in place of
+ * loading the population (and later, going through startup)
+ */
+void Main::LoadStartupSnapshot() {
+  const std::string &directory = scenario->snapshotPath;
+  loadSnapshot(getCheckpointFile(directory, "main", 0), this);
+  if (scenario->colocateChares && partitionTraffic.empty()) {
+    CkAbort("Error: startup snapshot %s was saved without colocating "
+      "chares, so it can't be used to colocate them\n", directory.c_str());
+  }
+
+  CkPrintf("Restoring chares from startup snapshot %s\n", directory.c_str());
+  peopleArray.LoadSnapshot(directory);
+  locationsArray.LoadSnapshot(directory);
+}
+
+void Main::pupSnapshot(PUP::er &p) {
+  pupCheckpointMatch(p, scenario->partitioner->getNumPersonPartitions(),
+    "number of people chares");
+  pupCheckpointMatch(p, scenario->partitioner->getNumLocationPartitions(),
+    "number of location chares");
+  pupCheckpointMatch(p, scenario->numDaysWithDistinctVisits,
+    "number of days of visits");
+  p | partitionTraffic;
+}
+
+/**
+ * Decides where each chare should be placed given the number of visits
+ * between each pair of People and Locations chares, and updates the array
+ * maps so that chares' new PEs become their home PEs
+ */
+void Main::ColocateChares(int numValues, const Id *traffic) {
+  PartitionId numPersonPartitions = scenario->partitioner->getNumPersonPartitions();
+  PartitionId numLocationPartitions =
+    scenario->partitioner->getNumLocationPartitions();
+  std::vector<int> blockPersonPes(numPersonPartitions);
+  for (PartitionId p = 0; p < numPersonPartitions; ++p) {
+    blockPersonPes[p] = ColocationMap::getBlockPe(p, numPersonPartitions);
+  }
+  std::vector<int> blockLocationPes(numLocationPartitions);
+  for (PartitionId p = 0; p < numLocationPartitions; ++p) {
+    blockLocationPes[p] = ColocationMap::getBlockPe(p, numLocationPartitions);
+  }
+
+  // Kept in case we save a snapshot, which skips the exchange this came from
+  partitionTraffic.assign(traffic, traffic + numValues);
+  getColocatedPes(numPersonPartitions, numLocationPartitions, numValues,
+    traffic, &personPes, &locationPes);
+  CkPrintf("  Colocating chares raises the fraction of visits within a node "
+    "from %.2f%% to %.2f%%\n",
+    100.0 * getNodeLocalFraction(numValues, traffic, blockPersonPes,
+      blockLocationPes),
+    100.0 * getNodeLocalFraction(numValues, traffic, personPes, locationPes));
+
+  peopleMap.SetPlacement(personPes.size(), personPes.data());
+  locationsMap.SetPlacement(locationPes.size(), locationPes.data());
+}
+
+#ifdef ENABLE_LB
+/**
+ * Combines the predicted load on each PE from the People and Locations
+ * arrays, and decides whether the busiest PE is far enough above the
+ * average for load balancing to be worth the cost of migrating chares
+ */
+bool Main::isPredictedImbalanced(int numPes, const double *loads,
+    const double *otherLoads) {
+  double maxLoad = 0;
+  double totalLoad = 0;
+  for (int pe = 0; pe < numPes; ++pe) {
+    double load = loads[pe] + otherLoads[pe];
+    maxLoad = std::max(maxLoad, load);
+    totalLoad += load;
+  }
+
+  if (0 == totalLoad) {
+    return false;
+  }
+  double imbalance = maxLoad * numPes / totalLoad;
+  bool isImbalanced = imbalance > scenario->lbThreshold;
+  CkPrintf("  Predicted load imbalance (max/mean) of %.3f, %s\n", imbalance,
+    isImbalanced ? "load balancing" : "skipping load balancing");
+  return isImbalanced;
 }
+#endif  // ENABLE_LB
 
 #include "loimos.def.h"
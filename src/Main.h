@@ -9,29 +9,69 @@
 
 #include "charm++.h"
 #include "Scenario.h"
+#include "Analytics.h"
 #include "Types.h"
 
 #include <vector>
 #include <string>
 #include <memory>
+#include <fstream>
 
 class Main : public CBase_Main {
   Main_SDAG_CODE
   int day;
+  // The first day to simulate, which is only after 0 when restarting
+  int firstDay;
+  // Both of these have an entry for each replicate
   std::vector<int> accumulated;
-  std::vector<int> initialInfections;
+  std::vector<std::vector<Id> > initialInfections;
   PartitionId chareCount;
   PartitionId createdCount;
   Id lastInfectiousCount;
 
   Scenario *scenario;
   Profile profile;
+  std::vector<std::string> summaryPaths;
+  std::vector<std::ofstream> summaryFiles;
+  std::vector<std::ofstream> analyticsFiles;
+  // Summaries of each day's per-chare timings, and the slowest locations
+  std::ofstream timingFile;
+  std::ofstream slowestLocationsFile;
+  // Totals over all days so far in each replicate, for computing attack rates
+  std::vector<std::vector<Id> > infectionsByAge;
+  std::vector<std::vector<Id> > peopleByAge;
+  // Where each chare should move to so that it's on the same node as the
+  // chares it exchanges the most visits with
+  std::vector<int> personPes;
+  std::vector<int> locationPes;
+  // The number of visits between each pair of People and Locations chares
+  // that colocating chares was based on
+  std::vector<Id> partitionTraffic;
+#ifdef ENABLE_LB
+  bool shouldLoadBalance;
+#endif  // ENABLE_LB
 
  public:
   explicit Main(CkArgMsg* msg);
   void CharesCreated();
   void SeedInfections();
-  void SaveStats(Id *data);
+  void SeedInfections(int replicate);
+  void SaveStats(const Id *stateCounts);
+  void SaveAnalytics(const Id *histogramData);
+  void SaveAnalytics(int replicate, const Histograms &histograms);
+  void SaveTimings(const char *peopleData, const char *locationsData);
+  void ColocateChares(int numValues, const Id *traffic);
+  void SaveCheckpoint();
+  void LoadCheckpoint();
+  void pupCheckpoint(PUP::er &p);  // NOLINT(runtime/references)
+  void SaveStartupSnapshot();
+  void FinishStartupSnapshot();
+  void LoadStartupSnapshot();
+  void pupSnapshot(PUP::er &p);  // NOLINT(runtime/references)
+#ifdef ENABLE_LB
+  bool isPredictedImbalanced(int numPes, const double *loads,
+    const double *otherLoads);
+#endif  // ENABLE_LB
 };
 
 #endif  // MAIN_H_
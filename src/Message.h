@@ -60,19 +60,34 @@ using VisitTest = std::function<bool(const VisitMessage &)>;
 struct InteractionMessage {
   Id locationIdx;
   Id personIdx;
+  // Which replicate these interactions happened in
+  int replicate;
   std::vector<Interaction> interactions;
+  // The type of location they all happened at (see Analytics.h), which is
+  // only sent when infections are being attributed to location types, and
+  // is -1 otherwise
+  int locationType;
 
   InteractionMessage() {}
   explicit InteractionMessage(CkMigrateMessage *msg) {}
-  InteractionMessage(Id locationIdx_, Id personIdx_,
-      const std::vector<Interaction>& interactions_)
+  InteractionMessage(Id locationIdx_, Id personIdx_, int replicate_,
+      const std::vector<Interaction>& interactions_, int locationType_)
     : locationIdx(locationIdx_), personIdx(personIdx_),
-    interactions(interactions_) {}
+    replicate(replicate_), interactions(interactions_),
+    locationType(locationType_) {}
 
   void pup(PUP::er& p) {  // NOLINT(runtime/references)
     p | locationIdx;
     p | personIdx;
+    p | replicate;
     p | interactions;
+    bool hasLocationType = -1 != locationType;
+    p | hasLocationType;
+    if (hasLocationType) {
+      p | locationType;
+    } else if (p.isUnpacking()) {
+      locationType = -1;
+    }
   }
 };
 
@@ -107,6 +122,7 @@ PUPbytes(PersonState);
 
 struct PersonStatesMessage {
   PartitionId sourcePartition;
+  // Holds the same people's states in each replicate in turn
   std::vector<PersonState> states;
 
   PersonStatesMessage() {}
@@ -120,4 +136,41 @@ struct PersonStatesMessage {
   }
 };
 
+// Packs the visit schedules (one list of visits per day) held by each of
+// objects as an index of how many days each object has and how many visits
+// are on each day, followed by every visit back to back, rather than as a
+// separate vector with its own header for every object and day. schedules
+// picks which of each object's schedules to pack (e.g. &Person::visitsByDay)
+template <class T>
+void pupSchedules(PUP::er &p, std::vector<T> *objects,  // NOLINT(runtime/references)
+    std::vector<std::vector<VisitMessage> > T::*schedules) {
+  std::vector<int> index;
+  if (!p.isUnpacking()) {
+    for (T &object : *objects) {
+      const std::vector<std::vector<VisitMessage> > &days = object.*schedules;
+      index.push_back(days.size());
+      for (const std::vector<VisitMessage> &visits : days) {
+        index.push_back(visits.size());
+      }
+    }
+  }
+  p | index;
+
+  std::size_t i = 0;
+  for (T &object : *objects) {
+    std::vector<std::vector<VisitMessage> > &days = object.*schedules;
+    if (p.isUnpacking()) {
+      days.resize(index[i]);
+    }
+    i++;
+    for (std::vector<VisitMessage> &visits : days) {
+      if (p.isUnpacking()) {
+        visits.resize(index[i]);
+      }
+      i++;
+      PUParray(p, visits.data(), visits.size());
+    }
+  }
+}
+
 #endif  // MESSAGE_H_
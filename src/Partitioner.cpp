@@ -10,6 +10,7 @@
 #include "Types.h"
 #include "protobuf/data.pb.h"
 #include "readers/Preprocess.h"
+#include "readers/Compression.h"
 
 #include <vector>
 #include <cmath>
@@ -178,6 +179,26 @@ Id getGlobalIndex(Id localIndex, PartitionId PartitionId,
   return localIndex + offsets[PartitionId];
 }
 
+void PartitionLookup::build(const std::vector<Id> &offsets_, Id numObjects) {
+  offsets = offsets_;
+  firstIndex = offsets.front();
+  std::size_t maxBuckets = PARTITION_LOOKUP_BUCKETS_PER_PARTITION
+    * offsets.size();
+  shift = 0;
+  while (static_cast<std::size_t>(numObjects >> shift) > maxBuckets) {
+    shift++;
+  }
+
+  // Lookups past the end of the last bucket are clamped to it, so it needs
+  // to end after the last index
+  lastBucket = numObjects >> shift;
+  bucketPartitions.resize(lastBucket + 2);
+  for (std::size_t bucket = 0; bucket < bucketPartitions.size(); ++bucket) {
+    bucketPartitions[bucket] = ::getPartition(
+      firstIndex + (static_cast<Id>(bucket) << shift), offsets);
+  }
+}
+
 PartitionId getPartition(Id globalIndex,
     const std::vector<Id> &offsets) {
   PartitionId result = std::distance(offsets.begin(),
@@ -205,8 +226,10 @@ Partitioner::Partitioner(std::string scenarioPath,
     loimos::proto::CSVDefinition *locationOffsetDef) :
     numPeople(personMetadata->num_rows()),
     numLocations(locationMetadata->num_rows()) {
-  Id firstLocationIdx = getFirstIndex(locationMetadata, scenarioPath + "locations.csv");
-  Id firstPersonIdx = getFirstIndex(personMetadata, scenarioPath + "people.csv");
+  Id firstLocationIdx = getFirstIndex(locationMetadata,
+    resolveInputPath(scenarioPath + "locations.csv"));
+  Id firstPersonIdx = getFirstIndex(personMetadata,
+    resolveInputPath(scenarioPath + "people.csv"));
 
   PartitionId numOffsets = personOffsetDef->partition_offsets_size();
   if (0 < numOffsets && numPersonPartitions > numOffsets) {
@@ -227,6 +250,8 @@ Partitioner::Partitioner(std::string scenarioPath,
     personOffsetDef, &personPartitionOffsets);
   setPartitionOffsets(numLocationPartitions, firstLocationIdx, numLocations,
     locationOffsetDef, &locationPartitionOffsets);
+  personLookup.build(personPartitionOffsets, numPeople);
+  locationLookup.build(locationPartitionOffsets, numLocations);
 
 #if ENABLE_DEBUG >= DEBUG_PER_CHARE
   if (0 == CkMyNode()) {
@@ -256,6 +281,8 @@ Partitioner::Partitioner(PartitionId numPersonPartitions,
     &personPartitionOffsets);
   setPartitionOffsets(numLocationPartitions, 0, numLocations,
     &locationPartitionOffsets);
+  personLookup.build(personPartitionOffsets, numPeople);
+  locationLookup.build(locationPartitionOffsets, numLocations);
 }
 
 void Partitioner::setPartitionOffsets(PartitionId numPartitions,
@@ -321,7 +348,7 @@ CacheOffset Partitioner::getLocationCacheIndex(Id globalIndex) const {
 }
 
 PartitionId Partitioner::getLocationPartitionIndex(Id globalIndex) const {
-  return getPartition(globalIndex, locationPartitionOffsets);
+  return locationLookup.getPartition(globalIndex);
 }
 
 Id Partitioner::getLocationPartitionSize(PartitionId partitionIndex) const {
@@ -345,7 +372,7 @@ CacheOffset Partitioner::getPersonCacheIndex(Id globalIndex) const {
 }
 
 PartitionId Partitioner::getPersonPartitionIndex(Id globalIndex) const {
-  return getPartition(globalIndex, personPartitionOffsets);
+  return personLookup.getPartition(globalIndex);
 }
 
 Id Partitioner::getPersonPartitionSize(PartitionId partitionIndex) const {
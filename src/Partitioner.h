@@ -9,9 +9,13 @@
 #include "Types.h"
 #include "protobuf/data.pb.h"
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
+// The lookup tables have about this many buckets per partition
+#define PARTITION_LOOKUP_BUCKETS_PER_PARTITION 8
+
 template <typename T>
 bool outOfBounds(T lower, T upper, T value) {
   return lower > value || upper <= value;
@@ -42,11 +46,40 @@ PartitionId getPartition(Id globalIndex, const std::vector<Id> &offsets);
 Id getPartitionSize(PartitionId partitionIndex,
     Id numObjects, const std::vector<Id> &offsets);
 
+// Finds which partition a global index is in without a full binary search:
+// indices are split into equal, power-of-two sized buckets, each of which
+// records the partitions its first index and the next bucket's first index
+// are in. Most buckets lie entirely within one partition, and the rest only
+// need to search the few offsets between those two partitions
+struct PartitionLookup {
+  std::vector<Id> offsets;
+  std::vector<PartitionId> bucketPartitions;
+  Id firstIndex;
+  int shift;
+  std::size_t lastBucket;
+
+  void build(const std::vector<Id> &offsets, Id numObjects);
+
+  PartitionId getPartition(Id globalIndex) const {
+    std::size_t bucket = std::min(lastBucket,
+      static_cast<std::size_t>(globalIndex - firstIndex) >> shift);
+    PartitionId first = bucketPartitions[bucket];
+    PartitionId last = bucketPartitions[bucket + 1];
+    if (first == last) {
+      return first;
+    }
+    return std::upper_bound(offsets.begin() + first + 1,
+      offsets.begin() + last + 1, globalIndex) - offsets.begin() - 1;
+  }
+};
+
 struct Partitioner {
   Id numPeople;
   Id numLocations;
   std::vector<Id> locationPartitionOffsets;
   std::vector<Id> personPartitionOffsets;
+  PartitionLookup locationLookup;
+  PartitionLookup personLookup;
 
   Partitioner(std::string scenarioPath,
     PartitionId numPersonPartitions,
@@ -14,8 +14,11 @@
 #include "DiseaseModel.h"
 #include "Person.h"
 #include "Partitioner.h"
+#include "VisitGenerator.h"
+#include "Checkpoint.h"
 #include "readers/Preprocess.h"
 #include "readers/DataReader.h"
+#include "readers/NodeDataLoader.h"
 #include "intervention_model/InterventionModel.h"
 #include "intervention_model/Intervention.h"
 
@@ -40,14 +43,15 @@ std::uniform_real_distribution<> unitDistrib(0, 1);
 People::People(int seed, std::string scenarioPath) {
   // Must be set to true to make AtSync work
   usesAtSync = true;
+#ifdef ENABLE_LB
+  // We report our predicted load ourselves (see UserSetLBLoad)
+  usesAutoMeasure = false;
+  migratedOnDay = -1;
+#endif  // ENABLE_LB
 
   day = 0;
   scenario = globScenario.ckLocalBranch();
 
-  // Allocate space to summarize the state summaries for every day
-  DiseaseState totalStates = scenario->diseaseModel->getNumberOfStates();
-  stateSummaries.resize(totalStates * scenario->numDays, 0);
-
   // Get the number of people assigned to this chare
   Partitioner *partitioner = scenario->partitioner;
   numLocalPeople = partitioner->getPersonPartitionSize(thisIndex);
@@ -79,54 +83,77 @@ People::People(int seed, std::string scenarioPath) {
         scenario->numDaysWithDistinctVisits);
   }
 
+  // Real population data is read in by the node-level loader, which will
+  // call LoadData once this chare's slice of it is available
   if (scenario->isOnTheFly()) {
     generatePeopleData(firstLocalPersonIdx, seed);
-    generateVisitData();
-  } else {
-    // Load in people data from file.
-    loadPeopleData(scenarioPath);
+    if (!scenario->lazyVisits) {
+      generateVisitData();
+    }
+    initializePeople();
+
+#if ENABLE_DEBUG >= DEBUG_PER_CHARE
+    CkPrintf("  Chare %d took %f s to load people\n", thisIndex,
+        CkWallTimer() - startTime);
+#endif
   }
+}
+
+People::People(CkMigrateMessage *msg) {}
+
+void People::LoadData() {
+#if ENABLE_DEBUG >= DEBUG_PER_CHARE
+  double startTime = CkWallTimer();
+#endif
 
-for (Person &p : people) {
-  if (!scenario->isOnTheFly()) {
+  // Load in people data from the copy the node-level loader read in
+  loadPeopleData(scenario->scenarioPath);
+  for (Person &p : people) {
     // Need to wait until after unique ids are set in case they don't start at 0
-    p.setSeed(seed);
-  }
-  for (int i = 0; i < numInterventions; ++i) {
-    const Intervention<Person> &inter = interventions->getPersonIntervention(i);
-    p.toggleCompliance(i, inter.willComply(p, p.getGenerator()));
+    p.setSeed(scenario->seed);
   }
-}
+  initializePeople();
 
 #if ENABLE_DEBUG >= DEBUG_PER_CHARE
   CkPrintf("  Chare %d took %f s to load people\n", thisIndex,
       CkWallTimer() - startTime);
 #endif
+}
 
-#if OUTPUT_FLAGS & OUTPUT_EXPOSURES
-  exposuresFile = new std::ofstream(scenario->outputPath + "exposures_chare_"
-      + std::to_string(thisIndex) + ".csv");
-  *exposuresFile << "tick,sus_pid,inf_pid,start_time,end_time,propensity"
-      << std::endl;
-#else
-  exposuresFile = NULL;
-#endif
+// Handles any setup which needs to happen after the people's data is
+// either loaded or generated
+void People::initializePeople() {
+  InterventionModel *interventions = scenario->interventionModel;
+  int numInterventions = interventions->getNumPersonInterventions();
+  for (Person &p : people) {
+    for (int i = 0; i < numInterventions; ++i) {
+      const Intervention<Person> &inter = interventions->getPersonIntervention(i);
+      p.toggleCompliance(i, inter.willComply(p, p.getGenerator()));
+    }
+  }
 
-#if OUTPUT_FLAGS & OUTPUT_TRANSITIONS
-  transitionsFile = new std::ofstream(scenario->outputPath + "transitions_chare_"
-      + std::to_string(thisIndex) + ".csv");
-  *transitionsFile << "tick,pid,exit_state,contact_pid,contact_start"
-      << std::endl;
-#else
-  transitionsFile = NULL;
-#endif
+  // This also clears out any replicates restored from a snapshot
+  for (Person &p : people) {
+    p.addReplicates(scenario->numReplicates, scenario->seed);
+  }
+
+  Analytics *analytics = scenario->analytics;
+  if (analytics->isEnabled()) {
+    histograms.assign(scenario->numReplicates, Histograms());
+    finishedInfectors.assign(scenario->numReplicates, std::vector<Id>());
+  }
+  if (analytics->isEnabled(ANALYTICS_ATTACK_RATES)) {
+    for (Histograms &replicateHistograms : histograms) {
+      for (const Person &p : people) {
+        replicateHistograms.add(PEOPLE_BY_AGE, analytics->getAgeBin(p));
+      }
+    }
+  }
 
   // Notify Main
   mainProxy.CharesCreated();
 }
 
-People::People(CkMigrateMessage *msg) {}
-
 void People::generatePeopleData(Id firstLocalPersonIdx, int seed) {
   // Init peoples ids and randomly init ages.
   std::uniform_int_distribution<int> age_dist(0, 100);
@@ -150,173 +177,76 @@ void People::generatePeopleData(Id firstLocalPersonIdx, int seed) {
 }
 
 /**
- * Randomly generates an itinerary (number of visits to random locations)
- * for each person
+ * Generates and stores every day's itinerary for each person, unless they're
+ * regenerated each day instead (see VisitGenerator)
  */
 void People::generateVisitData() {
-  int totalNumVisits = 0;
-  OnTheFlyArguments *onTheFly = scenario->onTheFly;
-  Partitioner *partitioner = scenario->partitioner;
-
-  // Model number of visits as a poisson distribution.
-  std::poisson_distribution<int> num_visits_generator(onTheFly->averageVisitsPerDay);
-
-  // Model visit distance as poisson distribution.
-  std::poisson_distribution<Id> visit_distance_generator(LOCATION_LAMBDA);
-
-  // Model visit times as uniform.
-  std::uniform_int_distribution<Time> time_dist(0, DAY_LENGTH);  // in seconds
-  std::priority_queue<Time, std::vector<Time>, std::greater<Time> > times;
-
-  // Flip a coin to decide directions in each dimension
-  std::uniform_int_distribution<int> dir_gen(0, 1);
-
-  // Calculate minigrid sizes.
-  Id numLocationPartitions = onTheFly->locationPartitionGrid.area();
-  Id numLocationsPerPartition = getNumElementsPerPartition(
-    scenario->numLocations, numLocationPartitions);
-
 #if ENABLE_DEBUG >= DEBUG_BASIC
   if (0 == thisIndex) {
     CkPrintf("location grid at each chare is "
       ID_PRINT_TYPE " by " ID_PRINT_TYPE "\n",
-      onTheFly->localLocationGrid.width, onTheFly->localLocationGrid.height);
+      scenario->onTheFly->localLocationGrid.width,
+      scenario->onTheFly->localLocationGrid.height);
   }
 #endif
 
-  // Choose one location partition for the people in this partition to call home
-  Id homePartitionIdx = thisIndex % numLocationPartitions;
-  Id homePartitionX = homePartitionIdx % onTheFly->locationPartitionGrid.width;
-  Id homePartitionY = homePartitionIdx / onTheFly->locationPartitionGrid.width;
-  Id homePartitionStartX = homePartitionX * onTheFly->localLocationGrid.width;
-  Id homePartitionStartY = homePartitionY * onTheFly->localLocationGrid.height;
-  Id homePartitionNumLocations = getNumLocalElements(
-    scenario->numLocations, numLocationPartitions, homePartitionIdx);
-
-  // Calculate schedule for each person.
-  Id firstLocationIdx = partitioner->getGlobalLocationIndex(0, 0);
+  // Each chare generates its own people's visits, so generation is spread
+  // across every PE
+#if ENABLE_DEBUG >= DEBUG_BASIC
+  double startTime = CkWallTimer();
+  Counter numVisits = 0;
+#endif
+  const VisitGenerator *generator = scenario->visitGenerator;
   for (Person &p : people) {
-    Id personIdx = p.getUniqueId();
-
-    // Calculate home location
-    Id localPersonIdx = (personIdx - firstLocationIdx) % homePartitionNumLocations;
-    Id homeX = homePartitionStartX + localPersonIdx % onTheFly->localLocationGrid.width;
-    Id homeY = homePartitionStartY + localPersonIdx / onTheFly->localLocationGrid.width;
-
-    p.visitsByDay.resize(scenario->numDaysWithDistinctVisits);
-    for (std::vector<VisitMessage> &visits : p.visitsByDay) {
-      std::default_random_engine *generator = p.getGenerator();
-      // Get random number of visits for this person.
-      int numVisits = num_visits_generator(*generator);
-      // Randomly generate start and end times for each visit,
-      // using a priority queue ensures the times are in order.
-      for (int j = 0; j < 2 * numVisits; j++) {
-        times.push(time_dist(*generator));
-      }
+    for (int d = 0; d < scenario->numDaysWithDistinctVisits; ++d) {
+      generator->generateVisits(p.getUniqueId(), thisIndex, d,
+        &p.visitsByDay[d]);
+#if ENABLE_DEBUG >= DEBUG_BASIC
+      numVisits += p.visitsByDay[d].size();
+#endif
+    }
+  }
 
-      totalNumVisits += numVisits;
-
-      // Randomly pick nearby location for person to visit.
-      for (int j = 0; j < numVisits; j++) {
-        // Generate visit start and end times.
-        Time visitStart = times.top();
-        times.pop();
-        Time visitEnd = times.top();
-        times.pop();
-        // Skip empty visits.
-        if (visitStart == visitEnd)
-          continue;
-
-        // Get number of locations away this person should visit.
-        Id numHops = std::min(visit_distance_generator(*generator),
-          onTheFly->locationGrid.width + onTheFly->locationGrid.height - 2);
-
-        Id destinationOffsetX = 0;
-        Id destinationOffsetY = 0;
-
-        if (numHops != 0) {
-          // Calculate maximum hops that can be taken from home location in each
-          // direction. (i.e. might be constrained for home locations close to edge)
-          Id maxHopsNegativeX = std::min(numHops, homeX);
-          Id maxHopsPositiveX = std::min(numHops,
-            onTheFly->locationGrid.width - 1 - homeX);
-          Id maxHopsNegativeY = std::min(numHops, homeY);
-          Id maxHopsPositiveY = std::min(numHops,
-            onTheFly->locationGrid.height - 1 - homeY);
-
-          // Choose random number of hops in the X direction.
-          std::uniform_int_distribution<Id> dist_gen(-maxHopsNegativeX,
-            maxHopsPositiveX);
-          destinationOffsetX = dist_gen(*generator);
-
-          // Travel the remaining hops in the Y direction
-          numHops -= std::abs(destinationOffsetX);
-          if (numHops != 0) {
-            // Choose a random direction between positive and negative
-            if (dir_gen(*generator) == 0) {
-              // Offset positively in Y.
-              destinationOffsetY = std::min(numHops, maxHopsPositiveY);
-            } else {
-              // Offset negatively in Y.
-              destinationOffsetY = -std::min(numHops, maxHopsNegativeY);
-            }
-          }
-        }
+#if ENABLE_DEBUG >= DEBUG_BASIC
+  if (0 == thisIndex) {
+    double elapsed = CkWallTimer() - startTime;
+    CkPrintf("Chare 0 generated %.0f visits in %fs (%.3g visits/s)\n",
+      numVisits, elapsed, numVisits / elapsed);
+  }
+#endif
+}
 
-        // Finally calculate the index of the location to actually visit...
-        Id destinationX = homeX + destinationOffsetX;
-        Id destinationY = homeY + destinationOffsetY;
-
-        // ...and translate it from 2D to 1D, respecting the 2D distribution
-        // of the locations across partitions
-        PartitionId partitionX = destinationX / onTheFly->localLocationGrid.width;
-        PartitionId partitionY = destinationY / onTheFly->localLocationGrid.height;
-        Id destinationIdx =
-            (destinationX % onTheFly->localLocationGrid.width)
-          + (destinationY % onTheFly->localLocationGrid.height)
-            * onTheFly->localLocationGrid.width
-          + partitionX * numLocationsPerPartition
-          + partitionY * onTheFly->locationPartitionGrid.width
-            * numLocationsPerPartition;
-
-        visits.emplace_back(destinationIdx, personIdx, 0, visitStart,
-            visitEnd, 0);
-
-  #if ENABLE_DEBUG >= DEBUG_PER_OBJECT
-        CkPrintf(
-            "person %d will visit location (%d, %d) with offset (%d,%d)\r\n",
-            personIdx, destinationX, destinationY, destinationOffsetX,
-            destinationOffsetY);
-        CkPrintf("(%d, %d) -> %d in partition (%d, %d)\r\n",
-            destinationX, destinationY, destinationIdx, partitionX, partitionY);
-  #endif
-      }
+/**
+ * Works out which Locations chares each of our people will visit on the
+ * given day, when visits are regenerated each day rather than stored
+ */
+void People::findVisitorsOnDay(int dayIdx) {
+  const VisitGenerator *generator = scenario->visitGenerator;
+  Partitioner *partitioner = scenario->partitioner;
+  std::vector<VisitMessage> visits;
+  visitorsToPartition.clear();
+  for (const Person &person : people) {
+    visits.clear();
+    generator->generateVisits(person.getUniqueId(), thisIndex, dayIdx,
+      &visits);
+    for (const VisitMessage &visit : visits) {
+      PartitionId locationPartition
+        = partitioner->getLocationPartitionIndex(visit.locationIdx);
+      visitorsToPartition[locationPartition].insert(person.getUniqueId());
     }
   }
 }
 
 /**
- * Loads real people data from file.
+ * Loads real people data from this chare's slice of the people file, which
+ * the node-level loader has already read into memory.
  */
 void People::loadPeopleData(std::string scenarioPath) {
-  std::string scenarioId = scenario->scenarioId;
-  std::ifstream peopleData(scenario->scenarioPath + "people.csv");
-  std::ifstream peopleCache(scenario->scenarioPath + scenarioId + "_people.cache",
-    std::ios_base::binary);
-  if (!peopleData || !peopleCache) {
-    CkAbort("Could not open person data input.");
-  }
-
-  // Find starting line for our data through people cache.
-  peopleCache.seekg(thisIndex * sizeof(CacheOffset));
-  CacheOffset peopleOffset;
-  peopleCache.read(reinterpret_cast<char *>(&peopleOffset), sizeof(CacheOffset));
-  peopleData.seekg(peopleOffset);
+  NodeDataLoader *loader = scenario->dataLoader;
+  FileSliceStream peopleData(loader->getPersonSlice(thisIndex));
 
-  // Read in from remote file.
   readData(&peopleData, scenario->personDef, &people, scenario->numPeople);
-  peopleData.close();
-  peopleCache.close();
+  loader->releaseSlices();
 
   DiseaseModel *diseaseModel = scenario->diseaseModel;
   for (Person &person : people) {
@@ -329,7 +259,16 @@ void People::pup(PUP::er &p) {
   p | day;
   p | totalVisitsForDay;
   p | people;
-  p | stateSummaries;
+  pupSchedules(p, &people, &Person::visitsByDay);
+  p | visitorsToPartition;
+  p | histograms;
+  p | finishedInfectors;
+#ifdef ENABLE_LB
+  p | loadPredictor;
+  if (p.isUnpacking()) {
+    migratedOnDay = day;
+  }
+#endif  // ENABLE_LB
 
   if (p.isUnpacking()) {
     scenario = globScenario.ckLocalBranch();
@@ -359,10 +298,25 @@ void People::SendVisitSchedules() {
     person.visitsByDay.clear();
   }
 
+  std::vector<Id> traffic;
   for (auto &entry : schedules) {
     PartitionId partitionIdx = entry.first;
+    if (scenario->colocateChares) {
+      Id numVisits = 0;
+      for (const std::vector<VisitMessage> &visits : entry.second.visitsByDay) {
+        numVisits += visits.size();
+      }
+      traffic.push_back(thisIndex);
+      traffic.push_back(partitionIdx);
+      traffic.push_back(numVisits);
+    }
     locationsArray[partitionIdx].ReceiveVisitSchedule(entry.second);
   }
+
+  if (scenario->colocateChares) {
+    CkCallback cb(CkReductionTarget(Main, ReceivePartitionTraffic), mainProxy);
+    contribute(traffic, CkReduction::concat, cb);
+  }
 }
 
 void People::ReceiveExpectedVisitors(ExpectedVisitorsMessage msg) {
@@ -372,25 +326,51 @@ void People::ReceiveExpectedVisitors(ExpectedVisitorsMessage msg) {
 }
 
 void People::SendVisitorStates() {
+  double startTime = CkWallTimer();
+#ifdef ENABLE_LB
+  statesSent = 0;
+#endif  // ENABLE_LB
+  if (scenario->lazyVisits) {
+    findVisitorsOnDay(day % scenario->numDaysWithDistinctVisits);
+  }
+
   const Partitioner *partitioner = scenario->partitioner;
   for (auto &entry : visitorsToPartition) {
     PartitionId partitionIdx = entry.first;
     const std::unordered_set<Id> &visitors = entry.second;
 
     PersonStatesMessage msg(thisIndex);
-    msg.states.reserve(visitors.size());
-    for (Id visitor : visitors) {
-      Id localIdx = partitioner->getLocalPersonIndex(visitor, thisIndex);
-      const Person &person = people[localIdx];
-      msg.states.emplace_back(person.getUniqueId(),
-        person.state, getTransmissionModifier(person));
+    msg.states.reserve(visitors.size() * scenario->numReplicates);
+    for (int r = 0; r < scenario->numReplicates; ++r) {
+      for (Id visitor : visitors) {
+        Id localIdx = partitioner->getLocalPersonIndex(visitor, thisIndex);
+        Person &person = people[localIdx];
+        person.swapReplicate(r);
+        msg.states.emplace_back(person.getUniqueId(),
+          person.state, getTransmissionModifier(person));
+        person.swapReplicate(r);
+      }
     }
 
+#ifdef ENABLE_LB
+    statesSent += msg.states.size();
+#endif  // ENABLE_LB
+    // Sizing messages means packing them, so only do it if it's reported
+    if (scenario->timingReport) {
+      timings.addMessage(&msg);
+    }
     locationsArray[partitionIdx].ReceiveVisitorStates(msg);
   }
+
+  double elapsed = CkWallTimer() - startTime;
+  timings.add(VISITS_TIME, elapsed);
+#ifdef ENABLE_LB
+  loadPredictor.addTime(elapsed);
+#endif  // ENABLE_LB
 }
 
 void People::SendVisitMessages() {
+  double startTime = CkWallTimer();
   // Send activities for each person.
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   Id minId = scenario->numPeople;
@@ -439,9 +419,13 @@ void People::SendVisitMessages() {
       }
 #endif  // USE_HYPERCOMM
 
+      if (scenario->timingReport) {
+        timings.addMessage(&visitMessage);
+      }
       locationsArray[locationPartition].ReceiveVisitMessages(visitMessage);
     }
   }
+  timings.add(VISITS_TIME, CkWallTimer() - startTime);
 
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   CkCallback cb(CkReductionTarget(Main, ReceiveVisitsSentCount), mainProxy);
@@ -471,6 +455,7 @@ double People::getTransmissionModifier(const Person &person) {
 }
 
 void People::ReceiveInteractions(InteractionMessage interMsg) {
+  double startTime = CkWallTimer();
   Id localIdx = scenario->partitioner->getLocalPersonIndex(
     interMsg.personIdx, thisIndex);
 
@@ -496,8 +481,37 @@ void People::ReceiveInteractions(InteractionMessage interMsg) {
   // Just concatenate the interaction lists so that we can process all of the
   // interactions at the end of the day
   Person &person = people[localIdx];
-  person.interactions.insert(person.interactions.end(),
-    interMsg.interactions.cbegin(), interMsg.interactions.cend());
+  std::vector<Interaction> &interactions = 0 == interMsg.replicate
+    ? person.interactions : person.replicates[interMsg.replicate - 1].interactions;
+  interactions.insert(interactions.end(), interMsg.interactions.cbegin(),
+    interMsg.interactions.cend());
+  if (scenario->analytics->isEnabled(ANALYTICS_LOCATION_TYPES)) {
+    std::vector<int> &locationTypes = 0 == interMsg.replicate
+      ? person.interactionLocationTypes
+      : person.replicates[interMsg.replicate - 1].interactionLocationTypes;
+    locationTypes.insert(locationTypes.end(), interMsg.interactions.size(),
+      interMsg.locationType);
+  }
+  timings.add(INTERACTIONS_TIME, CkWallTimer() - startTime);
+}
+
+/**
+ * Credits the given person with infecting someone on infectionDay in the
+ * given replicate
+ */
+void People::ReceiveSecondaryCase(Id infectorIdx, int infectionDay,
+    int replicate) {
+  Id localIdx = scenario->partitioner->getLocalPersonIndex(infectorIdx,
+    thisIndex);
+  InfectionHistory &history = people[localIdx].getHistory(replicate);
+  history.secondaryCases++;
+
+  // People infected before the simulation started have no infection day
+  if (scenario->analytics->isEnabled(ANALYTICS_GENERATION_INTERVALS)
+      && 0 <= history.infectionDay) {
+    histograms[replicate].add(GENERATION_INTERVALS,
+      infectionDay - history.infectionDay);
+  }
 }
 
 void People::ReceiveIntervention(int interventionIdx) {
@@ -511,65 +525,173 @@ void People::ReceiveIntervention(int interventionIdx) {
   }
 }
 
+/**
+ * Moves this chare to the PE Main picked to keep it near the Locations
+ * chares its people visit most
+ */
+void People::Colocate(int numPes, int *pes) {
+  if (CkMyPe() != pes[thisIndex]) {
+    migrateMe(pes[thisIndex]);
+  }
+}
+
+void People::SaveCheckpoint(std::string directory) {
+  saveCheckpoint(getCheckpointFile(directory, "people", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointSaved), mainProxy));
+}
+
+void People::RestoreCheckpoint(std::string directory) {
+  loadCheckpoint(getCheckpointFile(directory, "people", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointRestored),
+    mainProxy));
+}
+
+void People::SaveSnapshot(std::string directory) {
+  saveSnapshot(getCheckpointFile(directory, "people", thisIndex), this);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointSaved), mainProxy));
+}
+
+void People::LoadSnapshot(std::string directory) {
+  loadSnapshot(getCheckpointFile(directory, "people", thisIndex), this);
+  for (Person &p : people) {
+    p.setSeed(scenario->seed);
+  }
+  initializePeople();
+}
+
+/**
+ * Saves or restores our people, and which Locations chares they visit, as
+ * they are right after startup. Anything which depends on the run's
+ * parameters rather than the population is set up again once restored
+ */
+void People::pupSnapshot(PUP::er &p) {
+  pupCheckpointMatch(p, numLocalPeople, "number of people on a chare");
+  for (Person &person : people) {
+    person.pup(p);
+  }
+  pupSchedules(p, &people, &Person::visitsByDay);
+  p | visitorsToPartition;
+}
+
+/**
+ * Saves or restores everything about our people that changes as the
+ * simulation runs (Person::pup leaves out their visits). What interventions
+ * have done to them is only restored if this run uses the same ones
+ */
+void People::pupCheckpoint(PUP::er &p) {
+  pupCheckpointMatch(p, numLocalPeople, "number of people on a chare");
+  p | day;
+  for (Person &person : people) {
+    person.pup(p);
+  }
+  InterventionModel *interventions = scenario->interventionModel;
+  bool sameInterventions = interventions->pupCheckpointHash(p);
+  for (Person &person : people) {
+    interventions->pupPerson(p, &person, scenario->personAttributes,
+      sameInterventions);
+  }
+  p | histograms;
+  p | finishedInfectors;
+}
+
 void People::EndOfDayStateUpdate() {
+  double startTime = CkWallTimer();
+#ifdef ENABLE_LB
+  Counter numInteractions = 0;
+  Counter numInfectious = 0;
+#endif  // ENABLE_LB
   DiseaseModel *diseaseModel = scenario->diseaseModel;
-  // Get ready to count today's states
-  DiseaseState totalStates = diseaseModel->getNumberOfStates();
-  int offset = totalStates * day;
+  // Get ready to count today's states (in each replicate in turn)
+  DiseaseState numStates = diseaseModel->getNumberOfStates();
+  std::vector<Id> stateCounts(numStates * scenario->numReplicates, 0);
+
+  // Anyone who stopped being infectious yesterday has now been credited with
+  // all of their infections
+  for (int r = 0; r < static_cast<int>(finishedInfectors.size()); ++r) {
+    for (Id localIdx : finishedInfectors[r]) {
+      creditSecondaryCases(&people[localIdx].getHistory(r), r);
+    }
+    finishedInfectors[r].clear();
+  }
 
   // Handle state transitions at the end of the day.
-  Id infectiousCount = 0;
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   Counter totalExposuresPerDay = 0;
 #endif
-  for (Person &person : people) {
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    Id *replicateCounts = stateCounts.data() + r * numStates;
+    for (Person &person : people) {
+      person.swapReplicate(r);
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
-    totalExposuresPerDay += person.interactions.size();
+      totalExposuresPerDay += person.interactions.size();
 #endif
-    ProcessInteractions(&person);
-    UpdateDiseaseState(&person);
+#ifdef ENABLE_LB
+      numInteractions += person.interactions.size();
+#endif  // ENABLE_LB
+      ProcessInteractions(&person, r);
+      UpdateDiseaseState(&person, r);
 
-    DiseaseState resultantState = person.state;
-    stateSummaries[resultantState + offset]++;
-    if (diseaseModel->isInfectious(resultantState)) {
-      infectiousCount++;
+      replicateCounts[person.state]++;
+#ifdef ENABLE_LB
+      if (diseaseModel->isInfectious(person.state)) {
+        numInfectious++;
+      }
+#endif  // ENABLE_LB
+      person.swapReplicate(r);
     }
   }
 
-  // contributing to reduction
-  CkCallback cb(CkReductionTarget(Main, ReceiveInfectiousCount), mainProxy);
-  contribute(sizeof(Id), &infectiousCount,
-      CONCAT(CkReduction::sum_, ID_REDUCTION_TYPE), cb);
+  // contributing to reduction (Main both saves these counts and uses them
+  // to decide whether to keep going)
+  CkCallback cb(CkReductionTarget(Main, ReceiveStateCounts), mainProxy);
+  contribute(stateCounts, CkReduction::CONCAT(sum_, ID_REDUCTION_TYPE), cb);
 #if ENABLE_DEBUG >= DEBUG_VERBOSE
   CkCallback expCb(CkReductionTarget(Main, ReceiveExposuresCount), mainProxy);
   contribute(sizeof(Counter), &totalExposuresPerDay,
       CONCAT(CkReduction::sum_, COUNTER_REDUCTION_TYPE), expCb);
 #endif
+  if (scenario->analytics->isEnabled()) {
+    sendAnalytics();
+  }
+
+  double elapsed = CkWallTimer() - startTime;
+#ifdef ENABLE_LB
+  loadPredictor.addTime(elapsed);
+  loadPredictor.endDay(people.size() + statesSent, numInteractions,
+    numInfectious);
+#endif  // ENABLE_LB
+
+  timings.add(STATE_UPDATE_TIME, elapsed);
+  if (scenario->timingReport) {
+    std::vector<char> packed = TimingSummary(timings, thisIndex, 0).pack();
+    CkCallback timingCb(CkReductionTarget(Main, ReceivePeopleTimings),
+      mainProxy);
+    contribute(packed.size(), packed.data(),
+      mergeTimingSummariesType, timingCb);
+  }
+  timings.clear();
 
   // Get ready for the next day
   day++;
 }
 
-void People::SendStats() {
-  CkCallback cb(CkReductionTarget(Main, ReceiveStats), mainProxy);
-  contribute(stateSummaries, CkReduction::CONCAT(sum_, ID_REDUCTION_TYPE),
-    cb);
-}
-
 double propensityToProbability(double propensity) {
   return 1.0 - exp(-propensity);
 }
 
-void People::ProcessInteractions(Person *person) {
+void People::ProcessInteractions(Person *person, int replicate) {
   double totalPropensity = 0.0;
   uint numInteractions = static_cast<uint>(person->interactions.size());
   for (const Interaction &inter : person->interactions) {
     totalPropensity += inter.propensity;
 #if OUTPUT_FLAGS & OUTPUT_EXPOSURES
     // tick,sus_pid,inf_pid,start_time,end_time,propensity
-    *exposuresFile << day << "," << person->getUniqueId() << ","
-        << inter.infectiousIdx << "," << inter.startTime << ","
-        << inter.endTime << "," << inter.propensity << std::endl;
+    if (scenario->outputWriter->isSampled(day, person->getUniqueId(),
+        inter.infectiousIdx)) {
+      ExposureRecord record { day, person->getUniqueId(), inter.infectiousIdx,
+        inter.startTime, inter.endTime, inter.propensity };
+      scenario->outputWriter->write(record);
+    }
 #endif
   }
 
@@ -601,20 +723,104 @@ void People::ProcessInteractions(Person *person) {
       person->secondsLeftInState = -1;
       std::tie(person->next_state, std::ignore) =
         diseaseModel->transitionFromState(person->state, generator);
+      if (scenario->analytics->isEnabled()) {
+        int locationType = person->interactionLocationTypes.empty() ? -1
+          : person->interactionLocationTypes[interactionIdx];
+        recordInfection(person, person->interactions[interactionIdx],
+          locationType, replicate);
+      }
 
 #if OUTPUT_FLAGS & OUTPUT_TRANSITIONS
       // tick,pid,exit_state,contact_pid,contact_start
       const Interaction &inter = person->interactions[interactionIdx];
-      *transitionsFile << day << "," << person->getUniqueId() << ","
-          << diseaseModel->getStateLabel(person->next_state) << ","
-          << inter.infectiousIdx << "," << inter.startTime << std::endl;
+      TransitionRecord record { day, person->getUniqueId(),
+        person->next_state, inter.infectiousIdx, inter.startTime };
+      scenario->outputWriter->write(record);
 #endif
     }
   }
   person->interactions.clear();
+  person->interactionLocationTypes.clear();
+}
+
+/**
+ * Adds a person's secondary cases to today's histogram for the given
+ * replicate, and starts their count over in case they're infected again later
+ */
+void People::creditSecondaryCases(InfectionHistory *history, int replicate) {
+  histograms[replicate].add(SECONDARY_CASES, history->secondaryCases);
+  history->secondaryCases = 0;
+}
+
+/**
+ * Sends today's histograms for every replicate on to Main, all together
+ * (see Main::SaveAnalytics)
+ */
+void People::sendAnalytics() {
+  std::vector<Id> packed = Histograms::join(histograms).pack();
+  CkCallback analyticsCb(CkReductionTarget(Main, ReceiveAnalytics),
+    mainProxy);
+  contribute(packed.size() * sizeof(Id), packed.data(), mergeHistogramsType,
+    analyticsCb);
+  for (Histograms &replicateHistograms : histograms) {
+    replicateHistograms.clear();
+  }
+}
+
+/**
+ * Credits everyone who was still infectious when the run ended (or who
+ * stopped on the last day) with the secondary cases they caused, so that
+ * they aren't left out of the distribution
+ */
+void People::FinishSecondaryCases() {
+  DiseaseModel *diseaseModel = scenario->diseaseModel;
+  for (int r = 0; r < scenario->numReplicates; ++r) {
+    for (Id localIdx : finishedInfectors[r]) {
+      creditSecondaryCases(&people[localIdx].getHistory(r), r);
+    }
+    finishedInfectors[r].clear();
+
+    for (Person &person : people) {
+      person.swapReplicate(r);
+      if (diseaseModel->isInfectious(person.state)) {
+        creditSecondaryCases(&person.history, r);
+      }
+      person.swapReplicate(r);
+    }
+  }
+  sendAnalytics();
+}
+
+/**
+ * Records that the given person (with the given replicate swapped in) was
+ * infected today
+ */
+void People::recordInfection(Person *person, const Interaction &inter,
+    int locationType, int replicate) {
+  Analytics *analytics = scenario->analytics;
+  Histograms &replicateHistograms = histograms[replicate];
+  person->history.infectionDay = day;
+  if (analytics->isEnabled(ANALYTICS_ATTACK_RATES)) {
+    replicateHistograms.add(INFECTIONS_BY_AGE, analytics->getAgeBin(*person));
+  }
+
+  // Initial infections aren't caused by anyone
+  if (-1 == inter.infectiousIdx) {
+    return;
+  }
+  if (analytics->isEnabled(ANALYTICS_LOCATION_TYPES)) {
+    replicateHistograms.add(INFECTIONS_BY_LOCATION_TYPE, locationType);
+  }
+  if (analytics->isEnabled(ANALYTICS_SECONDARY_CASES
+      | ANALYTICS_GENERATION_INTERVALS)) {
+    PartitionId partition =
+      scenario->partitioner->getPersonPartitionIndex(inter.infectiousIdx);
+    thisProxy[partition].ReceiveSecondaryCase(inter.infectiousIdx, day,
+      replicate);
+  }
 }
 
-void People::UpdateDiseaseState(Person *person) {
+void People::UpdateDiseaseState(Person *person, int replicate) {
   // Transition to next state or mark the passage of time
   person->secondsLeftInState -= DAY_LENGTH;
   std::default_random_engine *generator = person->getGenerator();
@@ -624,21 +830,59 @@ void People::UpdateDiseaseState(Person *person) {
     // they're infected
     if (!scenario->diseaseModel->isSusceptible(person->state)) {
       // tick,pid,exit_state,contact_pid,contact_start
-      *transitionsFile << day << "," << person->getUniqueId() << ","
-          << scenario->diseaseModel->getStateLabel(person->next_state)
-          << ",-1,-1" << std::endl;
+      TransitionRecord record { day, person->getUniqueId(),
+        person->next_state, -1, -1 };
+      scenario->outputWriter->write(record);
     }
 #endif
 
+    DiseaseModel *diseaseModel = scenario->diseaseModel;
+    if (scenario->analytics->isEnabled(ANALYTICS_SECONDARY_CASES)
+        && diseaseModel->isInfectious(person->state)
+        && !diseaseModel->isInfectious(person->next_state)) {
+      finishedInfectors[replicate].push_back(
+        scenario->partitioner->getLocalPersonIndex(person->getUniqueId(),
+          thisIndex));
+    }
+
     person->state = person->next_state;
     std::tie(person->next_state, person->secondsLeftInState) =
-      scenario->diseaseModel->transitionFromState(person->state, generator);
+      diseaseModel->transitionFromState(person->state, generator);
   }
 }
 
 #ifdef ENABLE_LB
+/**
+ * Sends Main our predicted load for tomorrow, so it can decide whether the
+ * PEs are imbalanced enough to be worth load balancing
+ */
+void People::ReportPredictedLoad() {
+  std::vector<double> loads(CkNumPes(), 0.0);
+  loads[CkMyPe()] = loadPredictor.getPredictedLoad();
+  CkCallback cb(CkReductionTarget(Main, ReceivePredictedLoads), mainProxy);
+  contribute(loads, CkReduction::sum_double, cb);
+}
+
+/**
+ * Gives the load balancer our predicted load rather than a measured one,
+ * since it grows and shrinks with the number of infectious people
+ */
+void People::UserSetLBLoad() {
+  setObjTime(loadPredictor.getPredictedLoad());
+}
+
 void People::ResumeFromSync() {
+  loadPredictor.reset();
+
+  // Let Main know how much data load balancing moved
+  std::vector<Id> migrationStats(2, 0);
+  if (migratedOnDay == day) {
+    PUP::sizer sizer;
+    pup(sizer);
+    migrationStats[0] = 1;
+    migrationStats[1] = sizer.size();
+  }
   CkCallback cb(CkReductionTarget(Main, peopleLBComplete), mainProxy);
-  contribute(cb);
+  contribute(migrationStats, CkReduction::CONCAT(sum_, ID_REDUCTION_TYPE), cb);
 }
 #endif  // ENABLE_LB
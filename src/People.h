@@ -13,6 +13,9 @@
 #include "Interaction.h"
 #include "Person.h"
 #include "Message.h"
+#include "Analytics.h"
+#include "TimingReport.h"
+#include "LoadPredictor.h"
 #include "intervention_model/Intervention.h"
 
 #include <functional>
@@ -26,23 +29,50 @@
 #include <unordered_set>
 #include <unordered_map>
 
-#define LOCATION_LAMBDA 5.2
-
 class People : public CBase_People {
+#ifdef ENABLE_BENCHMARKS
+  // So the benchmarks can throw away the interactions they send (see
+  // benchmarks/)
+  friend struct PeopleBenchmark;
+#endif
+
  private:
   int day;
   Id numLocalPeople;
   Counter totalVisitsForDay;
   std::vector<Person> people;
   Scenario *scenario;
-  std::vector<Id> stateSummaries;
-  std::ofstream *exposuresFile;
-  std::ofstream *transitionsFile;
   std::unordered_map<PartitionId, std::unordered_set<Id> > visitorsToPartition;
 
-  void ProcessInteractions(Person *person);
-  void UpdateDiseaseState(Person *person);
+  // Only used when in-situ analytics are enabled, with one entry for each
+  // replicate (see Person::getHistory for what's tracked for each person)
+  std::vector<Histograms> histograms;
+  // People who stopped being infectious today, who may still be credited
+  // with infections from today
+  std::vector<std::vector<Id> > finishedInfectors;
+
+  // How long we spent on each phase of today, and how much we sent
+  ChareTimings timings;
+
+#ifdef ENABLE_LB
+  // Used to predict tomorrow's load from how many visitor states we sent
+  // and how many interactions we processed today, along with how many of
+  // our people will be infectious tomorrow
+  LoadPredictor loadPredictor;
+  Counter statesSent;
+  // The day we arrived on, if we've been migrated
+  int migratedOnDay;
+#endif  // ENABLE_LB
+
+  void ProcessInteractions(Person *person, int replicate);
+  void recordInfection(Person *person, const Interaction &inter,
+    int locationType, int replicate);
+  void creditSecondaryCases(InfectionHistory *history, int replicate);
+  void sendAnalytics();
+  void UpdateDiseaseState(Person *person, int replicate);
   void loadPeopleData(std::string scenarioPath);
+  void initializePeople();
+  void findVisitorsOnDay(int dayIdx);
 
  public:
   explicit People(int seed, std::string scenarioPath);
@@ -50,16 +80,27 @@ class People : public CBase_People {
   void pup(PUP::er &p);  // NOLINT(runtime/references)
   void generatePeopleData(Id firstLocalPersonIndex, int seed);
   void generateVisitData();
+  void LoadData();
   void SendVisitSchedules();
   void ReceiveExpectedVisitors(ExpectedVisitorsMessage msg);
   void SendVisitorStates();
   void SendVisitMessages();
   double getTransmissionModifier(const Person &person);
   void ReceiveInteractions(InteractionMessage interMsg);
+  void ReceiveSecondaryCase(Id infectorIdx, int infectionDay, int replicate);
   void EndOfDayStateUpdate();
-  void SendStats();
+  void FinishSecondaryCases();
   void ReceiveIntervention(int interventionIdx);
+  void Colocate(int numPes, int *pes);
+  void SaveCheckpoint(std::string directory);
+  void RestoreCheckpoint(std::string directory);
+  void pupCheckpoint(PUP::er &p);  // NOLINT(runtime/references)
+  void SaveSnapshot(std::string directory);
+  void LoadSnapshot(std::string directory);
+  void pupSnapshot(PUP::er &p);  // NOLINT(runtime/references)
   #ifdef ENABLE_LB
+  void ReportPredictedLoad();
+  void UserSetLBLoad();
   void ResumeFromSync();
   #endif  // ENABLE_LB
 };
@@ -10,7 +10,9 @@
 #include "readers/AttributeTable.h"
 
 #include "charm++.h"
+#include <algorithm>
 #include <vector>
+#include <utility>
 
 /**
  * Defines attributes of a single person.
@@ -25,6 +27,41 @@ Person::Person(const AttributeTable &attributes, int numInterventions,
   visitsByDay.resize(numDays);
 }
 
+void Person::addReplicates(int numReplicates, int seed) {
+  replicates.resize(numReplicates - 1);
+  for (int r = 1; r < numReplicates; ++r) {
+    ReplicateState &replicate = replicates[r - 1];
+    replicate.state = state;
+    replicate.next_state = next_state;
+    replicate.secondsLeftInState = secondsLeftInState;
+    replicate.history = history;
+    seedReplicate(&replicate.generator, seed, r);
+  }
+}
+
+/**
+ * Swaps the given replicate's state into this person's main fields (or
+ * back out again, if it's already been swapped in). Replicate 0 is always
+ * held in the main fields, so swapping it is a no-op
+ */
+void Person::swapReplicate(int replicate) {
+  if (0 == replicate) {
+    return;
+  }
+  ReplicateState &other = replicates[replicate - 1];
+  std::swap(state, other.state);
+  std::swap(next_state, other.next_state);
+  std::swap(secondsLeftInState, other.secondsLeftInState);
+  std::swap(generator, other.generator);
+  interactions.swap(other.interactions);
+  interactionLocationTypes.swap(other.interactionLocationTypes);
+  std::swap(history, other.history);
+}
+
+InfectionHistory &Person::getHistory(int replicate) {
+  return 0 == replicate ? history : replicates[replicate - 1].history;
+}
+
 void Person::filterVisits(const void *cause, VisitTest keepVisit) {
   for (std::vector<VisitMessage> &visits : visitsByDay) {
     for (int i = 0; i < visits.size(); ++i) {
@@ -45,15 +82,33 @@ void Person::restoreVisits(const void *cause) {
   }
 }
 
+std::vector<const void *> Person::getVisitFilters() const {
+  std::vector<const void *> causes;
+  for (const std::vector<VisitMessage> &visits : visitsByDay) {
+    for (const VisitMessage &visit : visits) {
+      if (NULL != visit.deactivatedBy && causes.end() == std::find(
+          causes.begin(), causes.end(), visit.deactivatedBy)) {
+        causes.push_back(visit.deactivatedBy);
+      }
+    }
+  }
+  return causes;
+}
+
+/**
+ * Leaves out interactions, which are always empty between days, and
+ * visitsByDay, which People packs for all of its people at once (see
+ * pupSchedules)
+ */
 void Person::pup(PUP::er &p) {
   p | uniqueId;
   p | state;
   p | next_state;
   p | secondsLeftInState;
-  p | interactions;
-  p | visitsByDay;
   p | data;
+  p | history;
   p | generator;
+  p | replicates;
 }
 
 void Person::_print_information(loimos::proto::CSVDefinition *personDef) {
@@ -14,6 +14,39 @@
 
 #include "charm++.h"
 #include <vector>
+#include <random>
+
+// What in-situ analytics track about a person (see Analytics.h)
+struct InfectionHistory {
+  // The day they were last infected, or -1 if they haven't been since the
+  // simulation started
+  int infectionDay;
+  // How many people they've infected since then
+  int secondaryCases;
+
+  InfectionHistory() : infectionDay(-1), secondaryCases(0) {}
+};
+PUPbytes(InfectionHistory);
+
+// The parts of a person which differ between replicates (see
+// Scenario::numReplicates)
+struct ReplicateState {
+  DiseaseState state;
+  DiseaseState next_state;
+  Time secondsLeftInState;
+  std::vector<Interaction> interactions;
+  std::vector<int> interactionLocationTypes;
+  InfectionHistory history;
+  std::default_random_engine generator;
+
+  void pup(PUP::er &p) {  // NOLINT(runtime/references)
+    p | state;
+    p | next_state;
+    p | secondsLeftInState;
+    p | history;
+    p | generator;
+  }
+};
 
 class Person : public DataInterface {
  public:
@@ -25,10 +58,20 @@ class Person : public DataInterface {
   // If this is a susceptible person, this is a list of all of their
   // interactions with infectious people in the past day
   std::vector<Interaction> interactions;
+  // The type of location each of those interactions happened at, which is
+  // only kept when infections are being attributed to location types
+  std::vector<int> interactionLocationTypes;
+  // Only used when in-situ analytics are enabled
+  InfectionHistory history;
 
   // Holds visit messages for each day
   std::vector<std::vector<VisitMessage> > visitsByDay;
 
+  // This person's state in every replicate but the first, which uses the
+  // fields above. swapReplicate exchanges the two, so that the code which
+  // updates people only ever needs to look at the fields above
+  std::vector<ReplicateState> replicates;
+
   // Constructors and assignment operators
   Person() = default;
   Person(const AttributeTable &attributes, int numInterventions,
@@ -40,6 +83,13 @@ class Person : public DataInterface {
   ~Person() = default;
   void filterVisits(const void *cause, VisitTest keepVisit) override;
   void restoreVisits(const void *cause) override;
+  std::vector<const void *> getVisitFilters() const override;
+  // Starts every replicate after the first off in the same state as the
+  // first, with its own generator
+  void addReplicates(int numReplicates, int seed);
+  void swapReplicate(int replicate);
+  // Returns the given replicate's history, when none are swapped in
+  InfectionHistory &getHistory(int replicate);
   // Lets charm++ migrate objects
   void pup(PUP::er &p);  // NOLINT(runtime/references)
   // Debugging.
@@ -0,0 +1,157 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "PowerLawVisitGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Each person's routine comes from its own stream, separate from each day's
+static const uint64_t ROUTINE_STREAM = std::numeric_limits<uint64_t>::max();
+
+static Id getGcd(Id a, Id b) {
+  while (0 != b) {
+    Id tmp = a % b;
+    a = b;
+    b = tmp;
+  }
+  return a;
+}
+
+PowerLawRange::PowerLawRange(Id first_, Id size_, double exponent_) :
+    first(first_), size(size_), exponent(exponent_), scale(0) {
+  if (1.0 != exponent) {
+    scale = std::pow(size + 1, 1.0 - exponent) - 1.0;
+  }
+
+  // Any stride which shares no factors with the size visits every location
+  // once; one near the golden ratio spreads neighbouring ranks well apart
+  stride = std::max(static_cast<Id>(1), static_cast<Id>(size * 0.618));
+  while (1 != getGcd(stride, size)) {
+    stride++;
+  }
+}
+
+/**
+ * Draws a rank from a continuous power law on [1, size + 1) by inverting
+ * its CDF, and scatters it across the range
+ */
+Id PowerLawRange::draw(CounterRandom *generator) const {
+  double u = ((*generator)() >> 11) / 9007199254740992.0;
+  double x;
+  if (1.0 == exponent) {
+    x = std::pow(size + 1, u);
+  } else {
+    x = std::pow(1.0 + u * scale, 1.0 / (1.0 - exponent));
+  }
+  Id rank = std::min(static_cast<Id>(x) - 1, size - 1);
+  return first + (rank * stride) % size;
+}
+
+PowerLawVisitGenerator::PowerLawVisitGenerator(
+    const OnTheFlyArguments &onTheFly, Partitioner *partitioner,
+    Id numPeople, Id numLocations, int seed) :
+    VisitGenerator(onTheFly, partitioner, numPeople, numLocations, seed) {
+  homesPerBlock = std::max(static_cast<Id>(1), static_cast<Id>(
+    std::round(HOUSEHOLD_BLOCK_SIZE / onTheFly.householdSize)));
+  Id numBlocks = (numPeople + HOUSEHOLD_BLOCK_SIZE - 1)
+    / HOUSEHOLD_BLOCK_SIZE;
+  Id numHomes = numBlocks * homesPerBlock;
+
+  // Homes come first, in the same order as the people who live in them, so
+  // that most people are on a chare near their home's
+  Id numOthers = numLocations - numHomes;
+  if (2 > numOthers) {
+    CkAbort("Error: " ID_PRINT_TYPE " people in households of %.1f need "
+      ID_PRINT_TYPE " homes, leaving too few of the " ID_PRINT_TYPE
+      " locations for schools and other places\n", numPeople,
+      onTheFly.householdSize, numHomes, numLocations);
+  }
+  Id numSchools = std::max(static_cast<Id>(1),
+    static_cast<Id>(numOthers * SCHOOL_LOCATION_FRACTION));
+  double exponent = onTheFly.locationSizeExponent;
+  schools = PowerLawRange(numHomes, numSchools, exponent);
+  others = PowerLawRange(numHomes + numSchools, numOthers - numSchools,
+    exponent);
+}
+
+PowerLawVisitGenerator::Routine PowerLawVisitGenerator::getRoutine(
+    Id personIdx) const {
+  CounterRandom generator(getStreamKey(personIdx, ROUTINE_STREAM));
+  Routine routine;
+
+  // Members of a household aren't quite next to each other, so households
+  // vary in size
+  Id block = personIdx / HOUSEHOLD_BLOCK_SIZE;
+  routine.home = block * homesPerBlock
+    + static_cast<Id>(((generator() >> 32) * homesPerBlock) >> 32);
+
+  double u = (generator() >> 11) / 9007199254740992.0;
+  if (SCHOOL_AGE_FRACTION > u) {
+    routine.commuteLocation = schools.draw(&generator);
+    routine.commuteLength = SCHOOL_LENGTH;
+  } else if (SCHOOL_AGE_FRACTION + EMPLOYED_FRACTION > u) {
+    routine.commuteLocation = others.draw(&generator);
+    routine.commuteLength = WORK_LENGTH;
+  } else {
+    routine.commuteLocation = NO_COMMUTE;
+    routine.commuteLength = 0;
+  }
+  routine.commuteStart = COMMUTE_EARLIEST_START
+    + drawTime(&generator, COMMUTE_START_SPREAD);
+  return routine;
+}
+
+/**
+ * Generates a person's day: they start and end it at home, go to school or
+ * work in between on work days (if they do either), and then make any
+ * other outings they have planned one after another
+ */
+void PowerLawVisitGenerator::generateVisits(Id personIdx,
+    PartitionId personPartition, int dayIdx,
+    std::vector<VisitMessage> *visits) const {
+  Routine routine = getRoutine(personIdx);
+  CounterRandom generator(getStreamKey(personIdx, dayIdx));
+
+  bool commutes = NO_COMMUTE != routine.commuteLocation
+    && WORK_DAYS_PER_WEEK > dayIdx % DAYS_IN_WEEK;
+  int numOutings = numVisitsDistribution(&generator);
+  if (!commutes && 0 == numOutings) {
+    visits->emplace_back(routine.home, personIdx, 0, 0, DAY_LENGTH, 0);
+    return;
+  }
+
+  Time now = commutes ? routine.commuteStart
+    : FREE_DAY_EARLIEST_START + drawTime(&generator, FREE_DAY_START_SPREAD);
+  visits->emplace_back(routine.home, personIdx, 0, 0, now, 0);
+  if (commutes) {
+    visits->emplace_back(routine.commuteLocation, personIdx, 0, now,
+      now + routine.commuteLength, 0);
+    now += routine.commuteLength;
+  }
+
+  for (int i = 0; i < numOutings; ++i) {
+    Time start = now + drawTime(&generator, MAX_TRAVEL_TIME);
+    Time end = start + MIN_OUTING_LENGTH
+      + drawTime(&generator, MAX_OUTING_LENGTH - MIN_OUTING_LENGTH);
+    if (DAY_LENGTH <= end) {
+      break;
+    }
+    visits->emplace_back(others.draw(&generator), personIdx, 0, start, end,
+      0);
+    now = end;
+  }
+
+  visits->emplace_back(routine.home, personIdx, 0, now, DAY_LENGTH, 0);
+}
+
+void PowerLawVisitGenerator::generateIncomingVisits(
+    PartitionId locationPartition, int dayIdx,
+    std::vector<VisitMessage> *visits) const {
+  CkAbort("Error: power-law visits can't be generated lazily\n");
+}
@@ -0,0 +1,98 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef POWERLAWVISITGENERATOR_H_
+#define POWERLAWVISITGENERATOR_H_
+
+#include "VisitGenerator.h"
+#include "Defs.h"
+
+#include <vector>
+
+// People are split into blocks of this many consecutive ids, each of which
+// has its own households
+#define HOUSEHOLD_BLOCK_SIZE 64
+// Fractions of people who go to school or work on work days
+#define SCHOOL_AGE_FRACTION 0.2
+#define EMPLOYED_FRACTION 0.6
+// Fraction of the locations which aren't homes that are schools
+#define SCHOOL_LOCATION_FRACTION 0.02
+#define WORK_DAYS_PER_WEEK 5
+#define NO_COMMUTE -1
+
+// When people leave for school or work (which they do at the same time
+// every work day), and how long they stay
+const Time COMMUTE_EARLIEST_START = 7 * HOUR_LENGTH;
+const Time COMMUTE_START_SPREAD = 2 * HOUR_LENGTH;
+const Time SCHOOL_LENGTH = 7 * HOUR_LENGTH;
+const Time WORK_LENGTH = 8 * HOUR_LENGTH;
+// When people leave home on days they don't go to school or work
+const Time FREE_DAY_EARLIEST_START = 9 * HOUR_LENGTH;
+const Time FREE_DAY_START_SPREAD = 3 * HOUR_LENGTH;
+// Bounds on the gaps between and lengths of other outings
+const Time MAX_TRAVEL_TIME = HOUR_LENGTH;
+const Time MIN_OUTING_LENGTH = 15 * MINUTE_LENGTH;
+const Time MAX_OUTING_LENGTH = 2 * HOUR_LENGTH;
+
+// Picks from a range of locations, such that the number of visits each
+// gets follows a power law: the location with the nth most visits gets
+// about n^-exponent as many as the most visited one
+class PowerLawRange {
+ private:
+  Id first;
+  Id size;
+  double exponent;
+  // Precomputed part of the inverse CDF
+  double scale;
+  // Ranks are scattered across the range, so that the busiest locations
+  // don't all end up on the same chare
+  Id stride;
+
+ public:
+  PowerLawRange() {}
+  PowerLawRange(Id first, Id size, double exponent);
+  Id draw(CounterRandom *generator) const;
+};
+
+// Generates a more realistic population than the default, in which location
+// sizes are heavy-tailed and people's visits follow a weekly pattern:
+// - Locations are split into homes, schools and other locations (e.g.
+//   workplaces and shops)
+// - People live in households of varying sizes, whose members are close
+//   together in the person ids, and so usually on the same chare
+// - Some people go to the same school or workplace every work day, leaving
+//   at the same time each day
+// - Everyone makes a Poisson-distributed number of other outings each day,
+//   to locations picked from a power law
+// Everything depends only on the seed and the person, location and day
+// indices, so the population doesn't change with the number of chares
+class PowerLawVisitGenerator : public VisitGenerator {
+ private:
+  Id homesPerBlock;
+  PowerLawRange schools;
+  PowerLawRange others;
+
+  // What doesn't change from day to day about someone's visits
+  struct Routine {
+    Id home;
+    Id commuteLocation;  // NO_COMMUTE for people who stay home
+    Time commuteStart;
+    Time commuteLength;
+  };
+  Routine getRoutine(Id personIdx) const;
+
+ public:
+  PowerLawVisitGenerator(const OnTheFlyArguments &onTheFly,
+    Partitioner *partitioner, Id numPeople, Id numLocations, int seed);
+  void generateVisits(Id personIdx, PartitionId personPartition, int dayIdx,
+    std::vector<VisitMessage> *visits) const override;
+  // Anyone might visit any location, so there's no cheap way to find all
+  // of a chare's visitors
+  void generateIncomingVisits(PartitionId locationPartition, int dayIdx,
+    std::vector<VisitMessage> *visits) const override;
+};
+
+#endif  // POWERLAWVISITGENERATOR_H_
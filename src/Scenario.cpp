@@ -9,6 +9,7 @@
 #include "Types.h"
 #include "Extern.h"
 #include "Defs.h"
+#include "Checkpoint.h"
 #include "Partitioner.h"
 #include "DiseaseModel.h"
 #include "contact_model/ContactModel.h"
@@ -17,14 +18,33 @@
 
 #include "charm++.h"
 
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
 Scenario::Scenario(Arguments args) : seed(args.seed), numDays(args.numDays),
     numDaysWithDistinctVisits(args.numDaysWithDistinctVisits),
     numDaysToSeedOutbreak(args.numDaysToSeedOutbreak),
     numInitialInfectionsPerDay(args.numInitialInfectionsPerDay),
+    pageVisits(args.pageVisits && !args.isOnTheFlyRun),
+    lazyVisits(args.lazyVisits && args.isOnTheFlyRun),
+    colocateChares(args.colocateChares),
+    useStartupSnapshot(args.useStartupSnapshot && !args.isOnTheFlyRun),
+    hasStartupSnapshot(false), timingReport(args.timingReport),
+    numSlowestLocations(args.numSlowestLocations),
+    numReplicates(args.numReplicates),
+    lbStartDay(args.lbStartDay),
+    lbInterval(args.lbInterval), lbThreshold(args.lbThreshold),
+    checkpointPath(args.checkpointPath),
+    checkpointInterval(args.checkpointInterval),
+    restartPath(args.restartPath),
     scenarioPath(args.scenarioPath), outputPath(args.outputPath),
+    cachePath(args.cachePath),
     personDef(NULL), locationDef(NULL), visitDef(NULL),
-    onTheFly(NULL), partitioner(NULL), diseaseModel(NULL),
-    contactModel(NULL), interventionModel(NULL) {
+    onTheFly(NULL), partitioner(NULL), visitGenerator(NULL), diseaseModel(NULL),
+    contactModel(NULL), interventionModel(NULL), dataLoader(NULL),
+    outputWriter(NULL), analytics(NULL), numOutputDaysWritten(0), numOutputDays(-1) {
   if (args.isOnTheFlyRun) {
     onTheFly = new OnTheFlyArguments(args.onTheFly);
 
@@ -33,6 +53,8 @@ Scenario::Scenario(Arguments args) : seed(args.seed), numDays(args.numDays),
 
     partitioner = new Partitioner(args.numPersonPartitions,
         args.numLocationPartitions, numPeople, numLocations);
+    visitGenerator = createVisitGenerator(*onTheFly, partitioner, numPeople,
+      numLocations, seed);
     scenarioId = std::string("");
 
   } else {
@@ -97,15 +119,31 @@ Scenario::Scenario(Arguments args) : seed(args.seed), numDays(args.numDays),
       locationOffsetDef);
 
     if (0 == CkMyNode()) {
-      buildCache(args.scenarioPath, numPeople, partitioner->personPartitionOffsets,
-        numLocations, partitioner->locationPartitionOffsets, numDaysWithDistinctVisits);
+      buildCache(args.scenarioPath, args.cachePath, numPeople,
+        partitioner->personPartitionOffsets, numLocations,
+        partitioner->locationPartitionOffsets, numDaysWithDistinctVisits);
     }
     scenarioId = getScenarioId(numPeople, args.numPersonPartitions,
       numLocations, args.numLocationPartitions);
+    dataLoader = new NodeDataLoader(scenarioPath, cachePath, scenarioId,
+      numDaysWithDistinctVisits, partitioner, pageVisits);
+
+    // Visits that are paged in are still read from the visits file, even
+    // if everything else comes from the snapshot
+    if (useStartupSnapshot) {
+      snapshotPath = cachePath + scenarioId + (pageVisits ? "_paged" : "")
+        + "_snapshot";
+      hasStartupSnapshot = isStartupSnapshotValid();
+      if (hasStartupSnapshot && pageVisits) {
+        dataLoader->mapVisits();
+      }
+    }
   }
 
   diseaseModel = new DiseaseModel(args.diseasePath, args.transmissibility,
     personAttributes);
+  diseaseModel->setReplicateTransmissibilities(
+    args.replicateTransmissibilities);
   if (args.hasIntervention) {
     interventionModel = new InterventionModel(args.interventionPath,
       &personAttributes, &locationAttributes, *diseaseModel);
@@ -114,6 +152,17 @@ Scenario::Scenario(Arguments args) : seed(args.seed), numDays(args.numDays),
   }
 
   contactModel = createContactModel(args.contactModelType, locationAttributes);
+  analytics = new Analytics(args.analyticsFlags, personAttributes,
+    locationAttributes);
+
+#ifdef OUTPUT_FLAGS
+  std::vector<std::string> stateLabels;
+  for (DiseaseState i = 0; i < diseaseModel->getNumberOfStates(); ++i) {
+    stateLabels.emplace_back(diseaseModel->getStateLabel(i));
+  }
+  outputWriter = new OutputWriter(outputPath, OUTPUT_FLAGS, stateLabels,
+    args.collectiveOutput, args.sampleRate, seed);
+#endif
 
 #if ENABLE_DEBUG >= DEBUG_BASIC
   CkPrintf("Person Attributes:\n");
@@ -134,12 +183,94 @@ Scenario::Scenario(Arguments args) : seed(args.seed), numDays(args.numDays),
 #endif
 }
 
+/**
+ * Reads in the population data for every People and Locations chare on this
+ * node, and then lets each of them know to parse its slice of that data
+ */
+void Scenario::LoadData() {
+  std::vector<PartitionId> personPartitions;
+  for (PartitionId p = 0; p < partitioner->getNumPersonPartitions(); ++p) {
+    int pe = peopleArray.ckLocMgr()->homePe(CkArrayIndex1D(p));
+    if (CkNodeOf(pe) == CkMyNode()) {
+      personPartitions.push_back(p);
+    }
+  }
+
+  std::vector<PartitionId> locationPartitions;
+  for (PartitionId p = 0; p < partitioner->getNumLocationPartitions(); ++p) {
+    int pe = locationsArray.ckLocMgr()->homePe(CkArrayIndex1D(p));
+    if (CkNodeOf(pe) == CkMyNode()) {
+      locationPartitions.push_back(p);
+    }
+  }
+
+  dataLoader->load(personPartitions, locationPartitions);
+
+  for (PartitionId p : personPartitions) {
+    peopleArray[p].LoadData();
+  }
+  for (PartitionId p : locationPartitions) {
+    locationsArray[p].LoadData();
+  }
+}
+
+/**
+ * Sets aside this node's output for the given day, and contributes how much
+ * there is of it to the prefix sum which decides where it will be written
+ */
+void Scenario::FlushOutput(int day) {
+  std::vector<CacheOffset> sizes = outputWriter->finishDay(day);
+  CkCallback cb(CkReductionTarget(Main, ReceiveOutputSizes), mainProxy);
+  contribute(sizes, CkReduction::sum_ulong_long, cb);
+}
+
+void Scenario::WriteOutputDay(int day, int numOffsets, CacheOffset *offsets) {
+  outputWriter->writeDay(day, offsets);
+  numOutputDaysWritten++;
+  closeOutputIfDone();
+}
+
+/**
+ * Waits for all buffered output on this node to be written out, and then
+ * lets Main know we're done
+ */
+void Scenario::FinishOutput(int numDays) {
+  numOutputDays = numDays;
+  closeOutputIfDone();
+}
+
+void Scenario::closeOutputIfDone() {
+  // In collective mode, this may arrive before the last day's offsets
+  if (0 > numOutputDays || (NULL != outputWriter
+      && outputWriter->getIsCollective()
+      && numOutputDaysWritten < numOutputDays)) {
+    return;
+  }
+
+  if (NULL != outputWriter) {
+    outputWriter->close();
+  }
+  contribute(CkCallback(CkReductionTarget(Main, OutputFinished), mainProxy));
+}
+
 void Scenario::ApplyInterventions(int day, Id newDailyInfections) {
   if (hasInterventions()) {
     interventionModel->applyInterventions(day, newDailyInfections, numPeople);
   }
 }
 
+/**
+ * Picks up which interventions were triggered from the checkpoint we're
+ * restarting from. Main saves these from its own node, since they're the
+ * same on every node
+ */
+void Scenario::RestoreCheckpoint(std::string directory) {
+  loadCheckpoint(getCheckpointFile(directory, "interventions", 0),
+    interventionModel);
+  contribute(CkCallback(CkReductionTarget(Main, CheckpointRestored),
+    mainProxy));
+}
+
 bool Scenario::isOnTheFly() {
   return NULL != onTheFly;
 }
@@ -147,3 +278,37 @@ bool Scenario::isOnTheFly() {
 bool Scenario::hasInterventions() {
   return NULL != interventionModel->interventionDef;
 }
+
+/**
+ * Whether we should check the predicted loads (and maybe load balance)
+ * at the end of the given day
+ */
+bool Scenario::isLoadBalancingDay(int day) const {
+  return day >= lbStartDay && 0 == (day - lbStartDay) % lbInterval;
+}
+
+/**
+ * Whether we should save a checkpoint at the end of the given day
+ */
+bool Scenario::isCheckpointDay(int day) const {
+  return !checkpointPath.empty() && 0 == (day + 1) % checkpointInterval;
+}
+
+bool Scenario::isRestart() const {
+  return !restartPath.empty();
+}
+
+/**
+ * Whether there's a complete startup snapshot which was taken with the
+ * current caches (Main only marks a snapshot as complete once every chare
+ * has saved itself)
+ */
+bool Scenario::isStartupSnapshotValid() const {
+  std::ifstream marker(snapshotPath + "/caches", std::ios_base::binary);
+  if (!marker) {
+    return false;
+  }
+  std::string savedHeaders((std::istreambuf_iterator<char>(marker)),
+    std::istreambuf_iterator<char>());
+  return savedHeaders == dataLoader->getCacheHeaders();
+}
@@ -12,9 +12,13 @@
 #include "Location.h"
 #include "protobuf/data.pb.h"
 #include "Partitioner.h"
+#include "VisitGenerator.h"
 #include "DiseaseModel.h"
 #include "contact_model/ContactModel.h"
 #include "intervention_model/InterventionModel.h"
+#include "readers/NodeDataLoader.h"
+#include "writers/OutputWriter.h"
+#include "Analytics.h"
 
 #include <string>
 
@@ -25,11 +29,46 @@ class Scenario : public CBase_Scenario {
   const Time numDaysWithDistinctVisits;
   const Time numDaysToSeedOutbreak;
   const Id numInitialInfectionsPerDay;
+  // Whether locations should only keep the current and next days' visit
+  // schedules in memory, rather than every day's
+  const bool pageVisits;
+  // Whether synthetic visits should be regenerated each day by the chares
+  // that need them, rather than generated once and stored
+  const bool lazyVisits;
+  // Whether to move People and Locations chares which exchange a lot of
+  // visits onto the same node after startup
+  const bool colocateChares;
+  // Whether to save every chare's state right after startup, keyed by the
+  // population and how it's split into chares, so that later runs can
+  // restore them from it instead of loading the population, and whether
+  // there's already an up-to-date snapshot to restore them from
+  const bool useStartupSnapshot;
+  bool hasStartupSnapshot;
+  std::string snapshotPath;
+  // Whether chares should report summaries of their timings each day, and
+  // how many of the slowest locations to include
+  const bool timingReport;
+  const int numSlowestLocations;
+  // How many replicates of the simulation to run at once; each has its own
+  // disease states and random number generators, seeded from seed plus the
+  // replicate's index, but they share the population and visit schedules
+  const int numReplicates;
+  // On which days to consider load balancing, and how much worse than the
+  // average PE's predicted load the busiest PE's has to be for us to do it
+  const int lbStartDay;
+  const int lbInterval;
+  const double lbThreshold;
+  // Where to save checkpoints and how many days apart, and which checkpoint
+  // to restart from (if any)
+  const std::string checkpointPath;
+  const int checkpointInterval;
+  const std::string restartPath;
   Id numPeople;
   Id numLocations;
 
   const std::string scenarioPath;
   const std::string outputPath;
+  const std::string cachePath;
   std::string scenarioId;
 
   loimos::proto::CSVDefinition *personDef;
@@ -41,14 +80,33 @@ class Scenario : public CBase_Scenario {
 
   OnTheFlyArguments *onTheFly;
   Partitioner *partitioner;
+  VisitGenerator *visitGenerator;
   DiseaseModel *diseaseModel;
   ContactModel *contactModel;
   InterventionModel *interventionModel;
+  NodeDataLoader *dataLoader;
+  OutputWriter *outputWriter;
+  Analytics *analytics;
+  // Used to make sure every day's output has been queued before we close
+  // the output files in collective mode
+  int numOutputDaysWritten;
+  int numOutputDays;
+
+  void closeOutputIfDone();
 
   explicit Scenario(Arguments args);
+  void LoadData();
+  void FlushOutput(int day);
+  void WriteOutputDay(int day, int numOffsets, CacheOffset *offsets);
+  void FinishOutput(int numDays);
   void ApplyInterventions(int day, Id newDailyInfections);
+  void RestoreCheckpoint(std::string directory);
   bool isOnTheFly();
   bool hasInterventions();
+  bool isLoadBalancingDay(int day) const;
+  bool isCheckpointDay(int day) const;
+  bool isRestart() const;
+  bool isStartupSnapshotValid() const;
 };
 
 #endif  // SCENARIO_H__
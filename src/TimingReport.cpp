@@ -0,0 +1,255 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Lightweight per-chare timing. Every chare times each phase of the day and
+ * counts the work it did, and when a timing report is requested these are
+ * summarized across all chares (along with the slowest locations) by a
+ * custom reduction at the end of each day, so that stragglers can be found
+ * without tracing the whole run
+ */
+
+#include "TimingReport.h"
+#include "Types.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static const char *chareMetricNames[] = {
+  "visits_time", "interactions_time", "state_update_time", "events_sorted",
+  "pairs_evaluated", "messages_sent", "bytes_sent"
+};
+
+CkReduction::reducerType mergeTimingSummariesType;
+
+const char *getChareMetricName(ChareMetric metric) {
+  return chareMetricNames[metric];
+}
+
+static bool slowerLocation(const LocationTiming &a, const LocationTiming &b) {
+  return a.time > b.time;
+}
+
+void ChareTimings::addLocation(Id locationIdx, Id numEvents, double time,
+    int numSlowest) {
+  if (static_cast<int>(slowestLocations.size()) < numSlowest) {
+    slowestLocations.push_back(LocationTiming { locationIdx, 0, numEvents,
+      time });
+    std::push_heap(slowestLocations.begin(), slowestLocations.end(),
+      slowerLocation);
+
+  // Replace the fastest of the slowest locations so far
+  } else if (0 < numSlowest && time > slowestLocations.front().time) {
+    std::pop_heap(slowestLocations.begin(), slowestLocations.end(),
+      slowerLocation);
+    slowestLocations.back() = LocationTiming { locationIdx, 0, numEvents,
+      time };
+    std::push_heap(slowestLocations.begin(), slowestLocations.end(),
+      slowerLocation);
+  }
+}
+
+void ChareTimings::clear() {
+  std::fill(metrics, metrics + NUM_CHARE_METRICS, 0.0);
+  slowestLocations.clear();
+}
+
+// Appends a value to a packed summary
+template <typename T>
+static void packValue(std::vector<char> *data, T value) {
+  const char *bytes = reinterpret_cast<const char *>(&value);
+  data->insert(data->end(), bytes, bytes + sizeof(T));
+}
+
+// Reads a value from a packed summary, and moves past it
+template <typename T>
+static T unpackValue(const char **data) {
+  T value;
+  std::memcpy(&value, *data, sizeof(T));
+  *data += sizeof(T);
+  return value;
+}
+
+// Which histogram bin a value goes in (see NUM_TIMING_BINS)
+static int getBin(double value) {
+  if (value < std::ldexp(1.0, TIMING_MIN_OCTAVE)) {
+    return 0;
+  }
+  int bin = 1 + static_cast<int>(std::floor(
+    (std::log2(value) - TIMING_MIN_OCTAVE) * TIMING_BINS_PER_OCTAVE));
+  return std::min(bin, NUM_TIMING_BINS - 1);
+}
+
+// The geometric middle of a bin
+static double getBinValue(int bin) {
+  return std::exp2(TIMING_MIN_OCTAVE
+    + (bin - 0.5) / TIMING_BINS_PER_OCTAVE);
+}
+
+TimingSummary::TimingSummary(const ChareTimings &timings, PartitionId chare,
+    int numSlowest_) : metrics(NUM_CHARE_METRICS), numSlowest(numSlowest_),
+    slowestLocations(timings.getSlowestLocations()) {
+  for (int m = 0; m < NUM_CHARE_METRICS; ++m) {
+    double value = timings.get(static_cast<ChareMetric>(m));
+    MetricSummary &summary = metrics[m];
+    summary.count = 1;
+    summary.sum = value;
+    summary.min = value;
+    summary.max = value;
+    summary.maxChare = chare;
+    summary.bins.resize(NUM_TIMING_BINS, 0.0);
+    summary.bins[getBin(value)] = 1;
+  }
+
+  for (LocationTiming &location : slowestLocations) {
+    location.chare = chare;
+  }
+  std::sort(slowestLocations.begin(), slowestLocations.end(), slowerLocation);
+}
+
+/**
+ * The packed format is, for each metric, its count, sum, min, max and
+ * max chare, followed by the number of non-empty bins and then the index
+ * and count of each of them. This is followed by the number of slowest
+ * locations to keep, the number actually kept, and then each of those.
+ * Values keep their own types, so that location ids and event counts
+ * aren't rounded the way they would be as doubles
+ */
+TimingSummary::TimingSummary(const char *data) :
+    metrics(NUM_CHARE_METRICS) {
+  for (MetricSummary &summary : metrics) {
+    summary.count = unpackValue<double>(&data);
+    summary.sum = unpackValue<double>(&data);
+    summary.min = unpackValue<double>(&data);
+    summary.max = unpackValue<double>(&data);
+    summary.maxChare = unpackValue<PartitionId>(&data);
+    summary.bins.resize(NUM_TIMING_BINS, 0.0);
+    int numBins = unpackValue<int>(&data);
+    for (int i = 0; i < numBins; ++i) {
+      int bin = unpackValue<int>(&data);
+      summary.bins[bin] = unpackValue<double>(&data);
+    }
+  }
+
+  numSlowest = unpackValue<int>(&data);
+  int numLocations = unpackValue<int>(&data);
+  slowestLocations.resize(numLocations);
+  for (LocationTiming &location : slowestLocations) {
+    location.locationIdx = unpackValue<Id>(&data);
+    location.chare = unpackValue<PartitionId>(&data);
+    location.numEvents = unpackValue<Id>(&data);
+    location.time = unpackValue<double>(&data);
+  }
+}
+
+void TimingSummary::merge(const TimingSummary &other) {
+  for (int m = 0; m < NUM_CHARE_METRICS; ++m) {
+    MetricSummary &summary = metrics[m];
+    const MetricSummary &otherSummary = other.metrics[m];
+    summary.count += otherSummary.count;
+    summary.sum += otherSummary.sum;
+    summary.min = std::min(summary.min, otherSummary.min);
+    if (otherSummary.max > summary.max) {
+      summary.max = otherSummary.max;
+      summary.maxChare = otherSummary.maxChare;
+    }
+    for (int bin = 0; bin < NUM_TIMING_BINS; ++bin) {
+      summary.bins[bin] += otherSummary.bins[bin];
+    }
+  }
+
+  std::vector<LocationTiming> merged(slowestLocations.size()
+    + other.slowestLocations.size());
+  std::merge(slowestLocations.begin(), slowestLocations.end(),
+    other.slowestLocations.begin(), other.slowestLocations.end(),
+    merged.begin(), slowerLocation);
+  if (static_cast<int>(merged.size()) > numSlowest) {
+    merged.resize(numSlowest);
+  }
+  slowestLocations.swap(merged);
+}
+
+std::vector<char> TimingSummary::pack() const {
+  std::vector<char> data;
+  for (const MetricSummary &summary : metrics) {
+    packValue(&data, summary.count);
+    packValue(&data, summary.sum);
+    packValue(&data, summary.min);
+    packValue(&data, summary.max);
+    packValue(&data, summary.maxChare);
+
+    int numBins = NUM_TIMING_BINS - std::count(summary.bins.begin(),
+      summary.bins.end(), 0.0);
+    packValue(&data, numBins);
+    for (int bin = 0; bin < NUM_TIMING_BINS; ++bin) {
+      if (0 != summary.bins[bin]) {
+        packValue(&data, bin);
+        packValue(&data, summary.bins[bin]);
+      }
+    }
+  }
+
+  packValue(&data, numSlowest);
+  packValue(&data, static_cast<int>(slowestLocations.size()));
+  for (const LocationTiming &location : slowestLocations) {
+    packValue(&data, location.locationIdx);
+    packValue(&data, location.chare);
+    packValue(&data, location.numEvents);
+    packValue(&data, location.time);
+  }
+  return data;
+}
+
+double TimingSummary::getMin(ChareMetric metric) const {
+  return metrics[metric].min;
+}
+
+double TimingSummary::getMean(ChareMetric metric) const {
+  return metrics[metric].sum / metrics[metric].count;
+}
+
+double TimingSummary::getMax(ChareMetric metric) const {
+  return metrics[metric].max;
+}
+
+PartitionId TimingSummary::getMaxChare(ChareMetric metric) const {
+  return metrics[metric].maxChare;
+}
+
+double TimingSummary::getPercentile(ChareMetric metric,
+    double fraction) const {
+  const MetricSummary &summary = metrics[metric];
+  double rank = fraction * summary.count;
+  double countSoFar = 0;
+  for (int bin = 0; bin < NUM_TIMING_BINS; ++bin) {
+    countSoFar += summary.bins[bin];
+    if (countSoFar >= rank && 0 != summary.bins[bin]) {
+      // The first and last bins are open-ended, so the best we can say
+      // is that it's within the range we've seen
+      double value = 0 == bin ? summary.min : getBinValue(bin);
+      return std::max(summary.min, std::min(summary.max, value));
+    }
+  }
+  return summary.max;
+}
+
+static CkReductionMsg *mergeTimingSummaries(int numMsgs,
+    CkReductionMsg **msgs) {
+  TimingSummary merged(reinterpret_cast<const char *>(msgs[0]->getData()));
+  for (int i = 1; i < numMsgs; ++i) {
+    merged.merge(TimingSummary(
+      reinterpret_cast<const char *>(msgs[i]->getData())));
+  }
+  std::vector<char> data = merged.pack();
+  return CkReductionMsg::buildNew(data.size(), data.data());
+}
+
+void registerTimingReducer() {
+  mergeTimingSummariesType = CkReduction::addReducer(mergeTimingSummaries);
+}
@@ -0,0 +1,130 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef TIMINGREPORT_H_
+#define TIMINGREPORT_H_
+
+#include "Types.h"
+#include "charm++.h"
+#include "pup.h"
+
+#include <string>
+#include <vector>
+
+// How many of the slowest locations to report each day, by default
+#define TIMING_REPORT_NUM_SLOWEST 10
+// Summaries keep a histogram of each metric with this many bins per doubling,
+// which percentiles are estimated from (to within about 9%)
+#define TIMING_BINS_PER_OCTAVE 4
+// Values below 2^TIMING_MIN_OCTAVE (about a microsecond, for times) all go
+// in the first bin, and values above 2^TIMING_MAX_OCTAVE in the last
+#define TIMING_MIN_OCTAVE -20
+#define TIMING_MAX_OCTAVE 44
+#define NUM_TIMING_BINS \
+  ((TIMING_MAX_OCTAVE - TIMING_MIN_OCTAVE) * TIMING_BINS_PER_OCTAVE + 2)
+
+// What each chare times and counts each day
+enum ChareMetric {
+  // Seconds spent on each phase of the day
+  VISITS_TIME,
+  INTERACTIONS_TIME,
+  STATE_UPDATE_TIME,
+  // How much work those phases did
+  EVENTS_SORTED,
+  PAIRS_EVALUATED,
+  MESSAGES_SENT,
+  BYTES_SENT,
+  NUM_CHARE_METRICS
+};
+
+const char *getChareMetricName(ChareMetric metric);
+
+// How long it took to process one location's events
+struct LocationTiming {
+  Id locationIdx;
+  PartitionId chare;
+  Id numEvents;
+  double time;
+};
+
+// Everything one chare timed and counted today
+class ChareTimings {
+ private:
+  double metrics[NUM_CHARE_METRICS];
+  // The slowest of this chare's locations (if any), as a min-heap on time
+  std::vector<LocationTiming> slowestLocations;
+
+ public:
+  ChareTimings() { clear(); }
+  void add(ChareMetric metric, double value) {
+    metrics[metric] += value;
+  }
+  double get(ChareMetric metric) const {
+    return metrics[metric];
+  }
+  // Counts a message that's about to be sent, and its size once packed
+  template <class T>
+  void addMessage(T *msg) {
+    PUP::sizer sizer;
+    sizer | *msg;
+    metrics[MESSAGES_SENT] += 1;
+    metrics[BYTES_SENT] += sizer.size();
+  }
+  // Keeps track of the numSlowest slowest locations
+  void addLocation(Id locationIdx, Id numEvents, double time,
+    int numSlowest);
+  const std::vector<LocationTiming> &getSlowestLocations() const {
+    return slowestLocations;
+  }
+  void clear();
+};
+
+// Summary statistics of each metric over any number of chares, along with
+// the slowest locations on any of them, which can be merged with other
+// summaries as they're reduced
+class TimingSummary {
+ private:
+  struct MetricSummary {
+    double count;
+    double sum;
+    double min;
+    double max;
+    // The chare the max came from
+    PartitionId maxChare;
+    std::vector<double> bins;
+  };
+  std::vector<MetricSummary> metrics;
+  int numSlowest;
+  // Sorted from slowest to fastest
+  std::vector<LocationTiming> slowestLocations;
+
+ public:
+  // A summary of just one chare
+  TimingSummary(const ChareTimings &timings, PartitionId chare,
+    int numSlowest);
+  // Unpacks a summary flattened by pack
+  explicit TimingSummary(const char *data);
+  void merge(const TimingSummary &other);
+  // Flattens this into bytes, with only the histogram bins which aren't
+  // empty, and with ids and counts kept as integers
+  std::vector<char> pack() const;
+
+  double getMin(ChareMetric metric) const;
+  double getMean(ChareMetric metric) const;
+  double getMax(ChareMetric metric) const;
+  PartitionId getMaxChare(ChareMetric metric) const;
+  // Estimates the value the given fraction of chares are at or below
+  double getPercentile(ChareMetric metric, double fraction) const;
+  const std::vector<LocationTiming> &getSlowestLocations() const {
+    return slowestLocations;
+  }
+};
+
+// Custom reducer which merges packed TimingSummaries
+extern CkReduction::reducerType mergeTimingSummariesType;
+void registerTimingReducer();
+
+#endif  // TIMINGREPORT_H_
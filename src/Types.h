@@ -41,6 +41,11 @@ using Counter = double;
 #define COUNTER_PRINT_TYPE "%0.0f"
 #define COUNTER_REDUCTION_TYPE double
 
+// For marking which replicates of the simulation something applies to, with
+// one bit per replicate
+using ReplicateMask = uint64_t;
+#define MAX_REPLICATES 64
+
 template <class T>
 struct Grid {
   T width;
@@ -0,0 +1,261 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "VisitGenerator.h"
+#include "PowerLawVisitGenerator.h"
+#include "Defs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+PoissonTable::PoissonTable(double mean, Id max) {
+  cdf.resize(max + 1);
+  double probability = std::exp(-mean);
+  double total = 0;
+  for (Id k = 0; k <= max; ++k) {
+    total += probability;
+    cdf[k] = total;
+    probability *= mean / (k + 1);
+  }
+  cdf[max] = 1.0;
+}
+
+VisitGenerator::VisitGenerator(const OnTheFlyArguments &onTheFly,
+    Partitioner *partitioner_, Id numPeople_, Id numLocations_, int seed_) :
+    locationGrid(onTheFly.locationGrid),
+    locationPartitionGrid(onTheFly.locationPartitionGrid),
+    localLocationGrid(onTheFly.localLocationGrid), seed(seed_),
+    numPeople(numPeople_), numLocations(numLocations_),
+    partitioner(partitioner_),
+    numVisitsDistribution(onTheFly.averageVisitsPerDay,
+      std::ceil(onTheFly.averageVisitsPerDay + MAX_VISITS_DEVIATIONS
+        * std::sqrt(onTheFly.averageVisitsPerDay))) {
+  maxHops = std::min(static_cast<Id>(MAX_VISIT_HOPS),
+    locationGrid.width + locationGrid.height - 2);
+  hopsDistribution = PoissonTable(LOCATION_LAMBDA, maxHops);
+  numPersonPartitions = partitioner_->getNumPersonPartitions();
+  numLocationPartitions = locationPartitionGrid.area();
+  numLocationsPerPartition = getNumElementsPerPartition(numLocations,
+    numLocationPartitions);
+  firstLocationIdx = partitioner_->getGlobalLocationIndex(0, 0);
+  numLocationsByPartition.resize(numLocationPartitions);
+  for (PartitionId i = 0; i < numLocationPartitions; ++i) {
+    numLocationsByPartition[i] = getNumLocalElements(numLocations,
+      numLocationPartitions, i);
+  }
+}
+
+/**
+ * Finds where on the location grid a person lives. Everyone on a People
+ * chare lives in the block of locations on one Locations chare
+ */
+void VisitGenerator::getHome(Id personIdx, PartitionId personPartition,
+    Id *homeX, Id *homeY) const {
+  PartitionId homePartitionIdx = personPartition % numLocationPartitions;
+  Id homePartitionX = homePartitionIdx % locationPartitionGrid.width;
+  Id homePartitionY = homePartitionIdx / locationPartitionGrid.width;
+  Id homePartitionNumLocations = numLocationsByPartition[homePartitionIdx];
+
+  Id localPersonIdx = (personIdx - firstLocationIdx)
+    % homePartitionNumLocations;
+  *homeX = homePartitionX * localLocationGrid.width
+    + localPersonIdx % localLocationGrid.width;
+  *homeY = homePartitionY * localLocationGrid.height
+    + localPersonIdx / localLocationGrid.width;
+}
+
+// The fewest hops it takes to get from (x, y) to the given chare's block
+Id VisitGenerator::getHopsToPartition(Id x, Id y,
+    PartitionId locationPartition) const {
+  Id startX = (locationPartition % locationPartitionGrid.width)
+    * localLocationGrid.width;
+  Id startY = (locationPartition / locationPartitionGrid.width)
+    * localLocationGrid.height;
+  Id endX = startX + localLocationGrid.width - 1;
+  Id endY = startY + localLocationGrid.height - 1;
+  Id hopsX = std::max(static_cast<Id>(0), std::max(startX - x, x - endX));
+  Id hopsY = std::max(static_cast<Id>(0), std::max(startY - y, y - endY));
+  return hopsX + hopsY;
+}
+
+/**
+ * Randomly generates a person's itinerary (a number of visits to random
+ * nearby locations) for one day
+ */
+void VisitGenerator::generateVisits(Id personIdx, PartitionId personPartition,
+    int dayIdx, std::vector<VisitMessage> *visits) const {
+  CounterRandom generator(getStreamKey(personIdx, dayIdx));
+
+  // Reused with different bounds for each visit
+  std::uniform_int_distribution<Id> offsetDist;
+  using OffsetRange = std::uniform_int_distribution<Id>::param_type;
+
+  Id homeX, homeY;
+  getHome(personIdx, personPartition, &homeX, &homeY);
+
+  // Randomly generate start and end times for each visit (in seconds), and
+  // sort them so that each pair of consecutive times is a visit. For the
+  // handful of visits most people make, this is cheaper than drawing sorted
+  // times directly (e.g. from exponential spacings)
+  int numVisits = numVisitsDistribution(&generator);
+  int numTimes = 2 * numVisits;
+  Time stackTimes[2 * MAX_STACK_VISITS];
+  std::vector<Time> heapTimes;
+  Time *times = stackTimes;
+  if (MAX_STACK_VISITS < numVisits) {
+    heapTimes.resize(numTimes);
+    times = heapTimes.data();
+  }
+  for (int j = 0; j < numTimes; j++) {
+    times[j] = drawTime(&generator, DAY_LENGTH);
+  }
+  std::sort(times, times + numTimes);
+
+  // Randomly pick nearby location for person to visit.
+  visits->reserve(visits->size() + numVisits);
+  for (int j = 0; j < numVisits; j++) {
+    Time visitStart = times[2 * j];
+    Time visitEnd = times[2 * j + 1];
+    // Skip empty visits.
+    if (visitStart == visitEnd)
+      continue;
+
+    // Get number of locations away this person should visit.
+    Id numHops = hopsDistribution(&generator);
+
+    Id destinationOffsetX = 0;
+    Id destinationOffsetY = 0;
+
+    if (numHops != 0) {
+      // Calculate maximum hops that can be taken from home location in each
+      // direction. (i.e. might be constrained for home locations close to edge)
+      Id maxHopsNegativeX = std::min(numHops, homeX);
+      Id maxHopsPositiveX = std::min(numHops,
+        locationGrid.width - 1 - homeX);
+      Id maxHopsNegativeY = std::min(numHops, homeY);
+      Id maxHopsPositiveY = std::min(numHops,
+        locationGrid.height - 1 - homeY);
+
+      // Choose random number of hops in the X direction.
+      destinationOffsetX = offsetDist(generator,
+        OffsetRange(-maxHopsNegativeX, maxHopsPositiveX));
+
+      // Travel the remaining hops in the Y direction
+      numHops -= std::abs(destinationOffsetX);
+      if (numHops != 0) {
+        // Choose a random direction between positive and negative
+        if (0 == (generator() & 1)) {
+          // Offset positively in Y.
+          destinationOffsetY = std::min(numHops, maxHopsPositiveY);
+        } else {
+          // Offset negatively in Y.
+          destinationOffsetY = -std::min(numHops, maxHopsNegativeY);
+        }
+      }
+    }
+
+    // Finally calculate the index of the location to actually visit...
+    Id destinationX = homeX + destinationOffsetX;
+    Id destinationY = homeY + destinationOffsetY;
+
+    // ...and translate it from 2D to 1D, respecting the 2D distribution
+    // of the locations across partitions
+    PartitionId partitionX = destinationX / localLocationGrid.width;
+    PartitionId partitionY = destinationY / localLocationGrid.height;
+    Id destinationIdx =
+        (destinationX % localLocationGrid.width)
+      + (destinationY % localLocationGrid.height)
+        * localLocationGrid.width
+      + partitionX * numLocationsPerPartition
+      + partitionY * locationPartitionGrid.width
+        * numLocationsPerPartition;
+
+    visits->emplace_back(destinationIdx, personIdx, 0, visitStart,
+        visitEnd, 0);
+
+#if ENABLE_DEBUG >= DEBUG_PER_OBJECT
+    CkPrintf(
+        "person %d will visit location (%d, %d) with offset (%d,%d)\r\n",
+        personIdx, destinationX, destinationY, destinationOffsetX,
+        destinationOffsetY);
+    CkPrintf("(%d, %d) -> %d in partition (%d, %d)\r\n",
+        destinationX, destinationY, destinationIdx, partitionX, partitionY);
+#endif
+  }
+}
+
+/**
+ * Regenerates the visits of everyone living within reach of the given
+ * chare's block of locations, and keeps those that land in it
+ */
+void VisitGenerator::generateIncomingVisits(PartitionId locationPartition,
+    int dayIdx, std::vector<VisitMessage> *visits) const {
+  // The chares whose blocks might be close enough for their residents to
+  // reach us
+  PartitionId partitionX = locationPartition % locationPartitionGrid.width;
+  PartitionId partitionY = locationPartition / locationPartitionGrid.width;
+  PartitionId reachX = (maxHops + localLocationGrid.width - 1)
+    / localLocationGrid.width;
+  PartitionId reachY = (maxHops + localLocationGrid.height - 1)
+    / localLocationGrid.height;
+  PartitionId minX = std::max(0, partitionX - reachX);
+  PartitionId maxX = std::min(locationPartitionGrid.width - 1,
+    partitionX + reachX);
+  PartitionId minY = std::max(0, partitionY - reachY);
+  PartitionId maxY = std::min(locationPartitionGrid.height - 1,
+    partitionY + reachY);
+
+  std::vector<VisitMessage> personVisits;
+  for (PartitionId y = minY; y <= maxY; ++y) {
+    for (PartitionId x = minX; x <= maxX; ++x) {
+      // People chares are assigned home blocks round-robin
+      PartitionId homePartitionIdx = x + y * locationPartitionGrid.width;
+      for (PartitionId personPartition = homePartitionIdx;
+          personPartition < numPersonPartitions;
+          personPartition += numLocationPartitions) {
+        Id numLocalPeople = partitioner->getPersonPartitionSize(
+          personPartition);
+        for (Id i = 0; i < numLocalPeople; ++i) {
+          Id personIdx = partitioner->getGlobalPersonIndex(i, personPartition);
+          Id homeX, homeY;
+          getHome(personIdx, personPartition, &homeX, &homeY);
+          if (maxHops < getHopsToPartition(homeX, homeY, locationPartition)) {
+            continue;
+          }
+
+          personVisits.clear();
+          generateVisits(personIdx, personPartition, dayIdx, &personVisits);
+          for (const VisitMessage &visit : personVisits) {
+            if (locationPartition
+                == partitioner->getLocationPartitionIndex(visit.locationIdx)) {
+              visits->push_back(visit);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+VisitGenerator *createVisitGenerator(const OnTheFlyArguments &onTheFly,
+    Partitioner *partitioner, Id numPeople, Id numLocations, int seed) {
+  if (static_cast<int>(VisitGeneratorType::grid) == onTheFly.generatorType) {
+    return new VisitGenerator(onTheFly, partitioner, numPeople, numLocations,
+      seed);
+
+  } else if (static_cast<int>(VisitGeneratorType::power_law)
+      == onTheFly.generatorType) {
+    return new PowerLawVisitGenerator(onTheFly, partitioner, numPeople,
+      numLocations, seed);
+
+  } else {
+    CkAbort("Error: unknown visit generator type: %d\n",
+      onTheFly.generatorType);
+  }
+}
@@ -0,0 +1,156 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef VISITGENERATOR_H_
+#define VISITGENERATOR_H_
+
+#include "Types.h"
+#include "Message.h"
+#include "Partitioner.h"
+#include "readers/Parse.h"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Average number of hops between a synthetic person's home and the locations
+// they visit
+#define LOCATION_LAMBDA 5.2
+// Synthetic visits are never more than this many hops from home, which bounds
+// which people a Locations chare has to consider when regenerating its visits
+// (the chances of a longer trip are negligible at the average above)
+#define MAX_VISIT_HOPS 32
+// Visit times for people with up to this many visits in a day are sorted on
+// the stack rather than in a heap-allocated buffer
+#define MAX_STACK_VISITS 32
+// How many standard deviations above the mean number of visits per day the
+// table we sample it from goes (anything further out is practically never
+// drawn, and is rounded down)
+#define MAX_VISITS_DEVIATIONS 12
+
+// A counter-based random number generator: the nth number drawn from a
+// stream is a hash (SplitMix64's finalizer) of the stream's key and n, so
+// any stream can be replayed from its key alone
+class CounterRandom {
+ private:
+  uint64_t key;
+  uint64_t counter;
+
+ public:
+  using result_type = uint64_t;
+
+  explicit CounterRandom(uint64_t key_) : key(key_), counter(0) {}
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+  result_type operator()() {
+    return mix(key + ++counter * 0x9e3779b97f4a7c15ull);
+  }
+  static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+};
+
+// Samples a Poisson distribution by looking a single random number up in a
+// table of its CDF, rather than drawing about one random number per unit of
+// its mean. Values above max are returned as max
+class PoissonTable {
+ private:
+  std::vector<double> cdf;
+
+ public:
+  PoissonTable() {}
+  PoissonTable(double mean, Id max);
+  template <class Generator>
+  Id operator()(Generator *generator) const {
+    // The top 53 bits, as a double in [0, 1)
+    double u = ((*generator)() >> 11) / 9007199254740992.0;
+    Id value = 0;
+    Id max = cdf.size() - 1;
+    while (value < max && u >= cdf[value]) {
+      value++;
+    }
+    return value;
+  }
+};
+
+// Generates the visits for synthetic (on-the-fly) populations. Each
+// person's visits on a given day come from their own random stream, keyed
+// by the seed, the person and the day, so they can be regenerated on
+// whichever chare needs them instead of stored.
+//
+// This is the default implementation, where people live on a grid of
+// locations, with each People chare's people all living in the block of
+// locations on one Locations chare, and visit locations a random number of
+// hops from home. Other implementations should extend this class (like
+// ContactModel, this is NOT an abstract class)
+class VisitGenerator {
+ private:
+  Grid<Id> locationGrid;
+  Grid<PartitionId> locationPartitionGrid;
+  Grid<Id> localLocationGrid;
+  Id maxHops;
+  Id numLocationsPerPartition;
+  Id firstLocationIdx;
+  PartitionId numPersonPartitions;
+  PartitionId numLocationPartitions;
+  // Each home block's number of locations, which only varies if the grid
+  // doesn't divide evenly
+  std::vector<Id> numLocationsByPartition;
+  PoissonTable hopsDistribution;
+
+  void getHome(Id personIdx, PartitionId personPartition, Id *homeX,
+    Id *homeY) const;
+  Id getHopsToPartition(Id x, Id y, PartitionId locationPartition) const;
+
+ protected:
+  // These are protected rather than private so child classes can use them
+  int seed;
+  Id numPeople;
+  Id numLocations;
+  const Partitioner *partitioner;
+  // Set up once, since it's relatively expensive to construct
+  PoissonTable numVisitsDistribution;
+
+  // The key for one of a person's random streams (e.g. one for each day)
+  uint64_t getStreamKey(Id personIdx, uint64_t stream) const {
+    return CounterRandom::mix(
+      CounterRandom::mix(static_cast<uint64_t>(seed) ^ personIdx) + stream);
+  }
+  // A time in [0, max], from scaling 32 random bits onto the range rather
+  // than rejecting draws past a multiple of its length, which biases it by
+  // less than max / 2^32
+  static Time drawTime(CounterRandom *generator, Time max) {
+    return (((*generator)() >> 32) * (max + 1)) >> 32;
+  }
+
+ public:
+  VisitGenerator(const OnTheFlyArguments &onTheFly, Partitioner *partitioner,
+    Id numPeople, Id numLocations, int seed);
+  virtual ~VisitGenerator() {}
+  // Appends the person's visits on the given day
+  virtual void generateVisits(Id personIdx, PartitionId personPartition,
+    int dayIdx, std::vector<VisitMessage> *visits) const;
+  // Appends every visit to a location on the given Locations chare on the
+  // given day, by regenerating the visits of everyone who lives close enough
+  virtual void generateIncomingVisits(PartitionId locationPartition,
+    int dayIdx, std::vector<VisitMessage> *visits) const;
+};
+
+// This enum provides an easy way of specifying which visit generator to use.
+// Each enum value should correspond to a class which extends VisitGenerator
+enum class VisitGeneratorType { grid, power_law };
+
+// This creates a new instance of the visit generator class indicated by
+// onTheFly.generatorType
+VisitGenerator *createVisitGenerator(const OnTheFlyArguments &onTheFly,
+  Partitioner *partitioner, Id numPeople, Id numLocations, int seed);
+
+#endif  // VISITGENERATOR_H_
@@ -0,0 +1,60 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "Benchmarks.h"
+#include "../Defs.h"
+#include "../Locations.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <vector>
+#include <random>
+
+Locations *benchmarkLocations = NULL;
+Scenario *benchmarkScenario = NULL;
+
+void runBenchmarks(Locations *locations, Scenario *scenario) {
+  benchmarkLocations = locations;
+  benchmarkScenario = scenario;
+  benchmark::RunSpecifiedBenchmarks();
+}
+
+std::vector<Event> generateEvents(int numVisits, double infectiousFraction,
+    DiseaseState susceptibleState, DiseaseState infectiousState,
+    std::default_random_engine *generator) {
+  std::uniform_int_distribution<Time> timeDist(0, DAY_LENGTH);
+  std::bernoulli_distribution isInfectiousDist(infectiousFraction);
+
+  std::vector<Event> events;
+  events.reserve(2 * numVisits);
+  for (Id personIdx = 0; personIdx < numVisits; ++personIdx) {
+    Time start = timeDist(*generator);
+    Time end = timeDist(*generator);
+    if (end < start) {
+      std::swap(start, end);
+    }
+
+    DiseaseState state = isInfectiousDist(*generator) ? infectiousState
+      : susceptibleState;
+    Event arrival;
+    arrival.type = ARRIVAL;
+    arrival.personIdx = personIdx;
+    arrival.single.personState = state;
+    arrival.single.transmissionModifier = 1.0;
+    arrival.scheduledTime = start;
+    Event departure = arrival;
+    departure.type = DEPARTURE;
+    departure.scheduledTime = end;
+    Event::pair(&arrival, &departure);
+    events.push_back(arrival);
+    events.push_back(departure);
+  }
+
+  // Shuffle them, as they would be after arriving in messages
+  std::shuffle(events.begin(), events.end(), *generator);
+  return events;
+}
@@ -0,0 +1,34 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef BENCHMARKS_BENCHMARKS_H_
+#define BENCHMARKS_BENCHMARKS_H_
+
+#include "../Types.h"
+#include "../Event.h"
+#include "../Scenario.h"
+
+#include <vector>
+#include <random>
+
+class Locations;
+
+// The Locations chare the benchmarks run on. It's loaded from the same
+// arguments as a normal run, so the benchmarks use the scenario's disease
+// and contact models, partitioner, etc.
+extern Locations *benchmarkLocations;
+extern Scenario *benchmarkScenario;
+
+// Runs every benchmark selected on the command line (see benchmarks/README)
+void runBenchmarks(Locations *locations, Scenario *scenario);
+
+// Random visits to a single location, as arrival and departure events, where
+// the given fraction of the visitors are infectious and the rest susceptible
+std::vector<Event> generateEvents(int numVisits, double infectiousFraction,
+  DiseaseState susceptibleState, DiseaseState infectiousState,
+  std::default_random_engine *generator);
+
+#endif  // BENCHMARKS_BENCHMARKS_H_
@@ -0,0 +1,100 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "../Person.h"
+#include "../Defs.h"
+#include "../readers/DataReader.h"
+#include "../readers/AttributeTable.h"
+#include "../protobuf/data.pb.h"
+#include "Benchmarks.h"
+#include "benchmark/benchmark.h"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** Benchmarks parsing people and visits from CSV files. */
+
+namespace {
+
+const int NUM_ROWS = 4096;
+
+/**
+ * Times parsing visits, in the same layout as the visits.csv files in the
+ * data directory
+ */
+void BM_ParseActivityStream(benchmark::State &state) {
+  loimos::proto::CSVDefinition visitDef;
+  visitDef.add_fields()->mutable_ignore();  // day
+  visitDef.add_fields()->mutable_start_time();
+  visitDef.add_fields()->mutable_duration();
+  visitDef.add_fields()->mutable_unique_id();  // location
+  visitDef.add_fields()->mutable_foreign_id();  // person
+
+  std::default_random_engine generator(benchmarkScenario->seed);
+  std::uniform_int_distribution<Time> timeDist(0, DAY_LENGTH);
+  std::uniform_int_distribution<Id> idDist(0, 1000000);
+  std::ostringstream rows;
+  for (int i = 0; i < NUM_ROWS; ++i) {
+    Time start = timeDist(generator);
+    rows << 0 << CSV_DELIM << start << CSV_DELIM
+      << timeDist(generator) / 4 << CSV_DELIM << idDist(generator)
+      << CSV_DELIM << idDist(generator) << "\n";
+  }
+  std::string data = rows.str();
+
+  std::istringstream input(data);
+  for (auto _ : state) {
+    input.clear();
+    input.seekg(0);
+    for (int i = 0; i < NUM_ROWS; ++i) {
+      benchmark::DoNotOptimize(parseActivityStream(&input, &visitDef, NULL));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_ROWS);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ParseActivityStream);
+
+/** Times reading people's attributes, like the people.csv files do. */
+void BM_ReadData(benchmark::State &state) {
+  loimos::proto::CSVDefinition personDef;
+  personDef.add_fields()->mutable_ignore();  // household
+  personDef.add_fields()->mutable_unique_id();
+  personDef.add_fields()->mutable_int32();  // age
+  personDef.add_fields()->mutable_ignore();  // sex
+  personDef.add_fields()->mutable_double_();  // income
+  personDef.add_fields()->mutable_foreign_id();  // home location
+  AttributeTable attributes;
+  attributes.readAttributes(personDef.fields());
+
+  std::default_random_engine generator(benchmarkScenario->seed);
+  std::uniform_int_distribution<int> ageDist(0, 100);
+  std::uniform_real_distribution<double> incomeDist(0, 200000);
+  std::uniform_int_distribution<Id> idDist(0, 1000000);
+  std::ostringstream rows;
+  for (int i = 0; i < NUM_ROWS; ++i) {
+    rows << idDist(generator) << CSV_DELIM << i << CSV_DELIM
+      << ageDist(generator) << CSV_DELIM << i % 2 << CSV_DELIM
+      << incomeDist(generator) << CSV_DELIM << idDist(generator) << "\n";
+  }
+  std::string data = rows.str();
+
+  std::vector<Person> people(NUM_ROWS, Person(attributes, 0, 0, 0, 1));
+  std::istringstream input(data);
+  for (auto _ : state) {
+    input.clear();
+    input.seekg(0);
+    readData(&input, &personDef, &people, NUM_ROWS);
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_ROWS);
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ReadData);
+
+}  // namespace
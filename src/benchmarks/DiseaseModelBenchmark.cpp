@@ -0,0 +1,75 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "../DiseaseModel.h"
+#include "../Defs.h"
+#include "Benchmarks.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+/** Benchmarks the disease model's per-person and per-interaction work. */
+
+namespace {
+
+/** Times drawing the next state (and time in it) from each state in turn. */
+void BM_TransitionFromState(benchmark::State &state) {
+  const DiseaseModel *diseaseModel = benchmarkScenario->diseaseModel;
+  std::default_random_engine generator(benchmarkScenario->seed);
+  DiseaseState numStates = diseaseModel->getNumberOfStates();
+
+  DiseaseState fromState = 0;
+  for (auto _ : state) {
+    DiseaseState nextState;
+    Time timeInState;
+    std::tie(nextState, timeInState) =
+      diseaseModel->transitionFromState(fromState, &generator);
+    benchmark::DoNotOptimize(nextState);
+    benchmark::DoNotOptimize(timeInState);
+    fromState = (fromState + 1) % numStates;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TransitionFromState);
+
+/** Times computing the propensity of random interactions. */
+void BM_GetPropensity(benchmark::State &state) {
+  const DiseaseModel *diseaseModel = benchmarkScenario->diseaseModel;
+  std::default_random_engine generator(benchmarkScenario->seed);
+  std::uniform_int_distribution<Time> timeDist(0, DAY_LENGTH);
+  std::uniform_int_distribution<DiseaseState> stateDist(0,
+    diseaseModel->getNumberOfStates() - 1);
+
+  // Draw the interactions up front, so we only time the disease model
+  const int numInteractions = 4096;
+  std::vector<Time> startTimes(numInteractions);
+  std::vector<Time> endTimes(numInteractions);
+  std::vector<DiseaseState> susceptibleStates(numInteractions);
+  std::vector<DiseaseState> infectiousStates(numInteractions);
+  for (int i = 0; i < numInteractions; ++i) {
+    Time start = timeDist(generator);
+    Time end = timeDist(generator);
+    startTimes[i] = std::min(start, end);
+    endTimes[i] = std::max(start, end);
+    susceptibleStates[i] = stateDist(generator);
+    infectiousStates[i] = stateDist(generator);
+  }
+
+  int i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(diseaseModel->getPropensity(susceptibleStates[i],
+      infectiousStates[i], startTimes[i], endTimes[i], 1.0, 1.0, 0));
+    i = (i + 1) % numInteractions;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetPropensity);
+
+}  // namespace
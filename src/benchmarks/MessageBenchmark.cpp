@@ -0,0 +1,67 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "../Message.h"
+#include "../Defs.h"
+#include "../Interaction.h"
+#include "Benchmarks.h"
+#include "benchmark/benchmark.h"
+
+#include <vector>
+
+/** Benchmarks packing and unpacking the messages sent every day. */
+
+namespace {
+
+/**
+ * Times packing a message into a buffer and unpacking it again, as Charm++
+ * does for messages between processes
+ */
+template <class T>
+void pupRoundTrip(benchmark::State *state, T *msg) {
+  PUP::sizer sizer;
+  sizer | *msg;
+  std::vector<char> buffer(sizer.size());
+
+  for (auto _ : *state) {
+    PUP::toMem packer(buffer.data());
+    packer | *msg;
+    T received;
+    PUP::fromMem unpacker(buffer.data());
+    unpacker | received;
+    benchmark::DoNotOptimize(received);
+  }
+  state->SetBytesProcessed(state->iterations() * buffer.size());
+}
+
+void BM_PupInteractionMessage(benchmark::State &state) {
+  std::vector<Interaction> interactions(state.range(0),
+    Interaction(0.01, 1, 1, 0, HOUR_LENGTH));
+  InteractionMessage msg(0, 0, 0, interactions, -1);
+  pupRoundTrip(&state, &msg);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PupInteractionMessage)->RangeMultiplier(8)->Range(1, 4096);
+
+void BM_PupPersonStatesMessage(benchmark::State &state) {
+  PersonStatesMessage msg(0);
+  msg.states.resize(state.range(0), PersonState(0, 0, 1.0));
+  pupRoundTrip(&state, &msg);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PupPersonStatesMessage)->RangeMultiplier(8)->Range(8, 32768);
+
+void BM_PupVisitScheduleMessage(benchmark::State &state) {
+  VisitScheduleMessage msg(0);
+  msg.visitsByDay.resize(DAYS_IN_WEEK, std::vector<VisitMessage>(
+    state.range(0), VisitMessage(0, 0, 0, 0, HOUR_LENGTH, 1.0)));
+  pupRoundTrip(&state, &msg);
+  state.SetItemsProcessed(state.iterations() * DAYS_IN_WEEK * state.range(0));
+}
+BENCHMARK(BM_PupVisitScheduleMessage)->RangeMultiplier(8)->Range(8, 32768);
+
+}  // namespace
@@ -0,0 +1,73 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "../Partitioner.h"
+#include "Benchmarks.h"
+#include "benchmark/benchmark.h"
+
+#include <random>
+#include <vector>
+
+/** Benchmarks finding which chare (and where on it) people and locations are. */
+
+namespace {
+
+const int NUM_LOOKUPS = 4096;
+
+std::vector<Id> drawIds(Id numIds) {
+  std::default_random_engine generator(benchmarkScenario->seed);
+  std::uniform_int_distribution<Id> idDist(0, numIds - 1);
+  std::vector<Id> ids(NUM_LOOKUPS);
+  for (Id &id : ids) {
+    id = idDist(generator);
+  }
+  return ids;
+}
+
+void BM_GetPersonPartitionIndex(benchmark::State &state) {
+  const Partitioner *partitioner = benchmarkScenario->partitioner;
+  std::vector<Id> ids = drawIds(benchmarkScenario->numPeople);
+
+  for (auto _ : state) {
+    for (Id id : ids) {
+      benchmark::DoNotOptimize(partitioner->getPersonPartitionIndex(id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_LOOKUPS);
+}
+BENCHMARK(BM_GetPersonPartitionIndex);
+
+void BM_GetLocationPartitionIndex(benchmark::State &state) {
+  const Partitioner *partitioner = benchmarkScenario->partitioner;
+  std::vector<Id> ids = drawIds(benchmarkScenario->numLocations);
+
+  for (auto _ : state) {
+    for (Id id : ids) {
+      benchmark::DoNotOptimize(partitioner->getLocationPartitionIndex(id));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_LOOKUPS);
+}
+BENCHMARK(BM_GetLocationPartitionIndex);
+
+/** Times the full lookup of a location's chare and index on that chare. */
+void BM_GetLocalLocationIndex(benchmark::State &state) {
+  const Partitioner *partitioner = benchmarkScenario->partitioner;
+  std::vector<Id> ids = drawIds(benchmarkScenario->numLocations);
+
+  for (auto _ : state) {
+    for (Id id : ids) {
+      PartitionId partition = partitioner->getLocationPartitionIndex(id);
+      benchmark::DoNotOptimize(
+        partitioner->getLocalLocationIndex(id, partition));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_LOOKUPS);
+}
+BENCHMARK(BM_GetLocalLocationIndex);
+
+}  // namespace
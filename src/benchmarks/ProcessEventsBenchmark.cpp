@@ -0,0 +1,149 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../loimos.decl.h"
+#include "../Locations.h"
+#include "../People.h"
+#include "../Person.h"
+#include "../DiseaseModel.h"
+#include "../Extern.h"
+#include "Benchmarks.h"
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <vector>
+#include <random>
+
+/** Benchmarks the sweep over each location's events. */
+
+// How many times processEvents is run between clearing out the
+// interactions it sends
+#define INTERACTION_DRAIN_INTERVAL 64
+
+// Gives the benchmarks access to Locations' internals
+struct LocationsBenchmark {
+  static Location *getLocation(Locations *locations) {
+    return &locations->locations[0];
+  }
+  static void processEvents(Locations *locations, Location *loc) {
+    locations->processEvents(loc);
+  }
+};
+
+// Lets the benchmarks throw away the interactions People chares receive
+struct PeopleBenchmark {
+  static void clearInteractions(People *people) {
+    for (Person &person : people->people) {
+      person.interactions.clear();
+      person.interactionLocationTypes.clear();
+      for (ReplicateState &replicate : person.replicates) {
+        replicate.interactions.clear();
+        replicate.interactionLocationTypes.clear();
+      }
+    }
+  }
+};
+
+namespace {
+
+// The first susceptible and first infectious states in the disease model
+void findStates(const DiseaseModel *diseaseModel,
+    DiseaseState *susceptibleState, DiseaseState *infectiousState) {
+  *susceptibleState = -1;
+  *infectiousState = -1;
+  for (DiseaseState s = 0; s < diseaseModel->getNumberOfStates(); ++s) {
+    if (-1 == *susceptibleState && diseaseModel->isSusceptible(s)) {
+      *susceptibleState = s;
+    }
+    if (-1 == *infectiousState && diseaseModel->isInfectious(s)) {
+      *infectiousState = s;
+    }
+  }
+  if (-1 == *susceptibleState || -1 == *infectiousState) {
+    CkAbort("Error: benchmarks need a disease model with both susceptible "
+      "and infectious states\n");
+  }
+}
+
+// processEvents sends the interactions it finds to People chares as usual,
+// but no simulation runs to use them, so this delivers them (all chares are
+// on this PE) and then throws them away before they pile up
+void drainInteractions() {
+  CsdSchedulePoll();
+  PartitionId numPartitions =
+    benchmarkScenario->partitioner->getNumPersonPartitions();
+  for (PartitionId p = 0; p < numPartitions; ++p) {
+    People *people = peopleArray[p].ckLocal();
+    if (NULL != people) {
+      PeopleBenchmark::clearInteractions(people);
+    }
+  }
+}
+
+// Arguments are the number of visits and the percentage of visitors who are
+// infectious
+void processEventsArguments(benchmark::internal::Benchmark *b) {
+  b->ArgNames({"visits", "infectious_pct"});
+  for (int numVisits : {16, 256, 4096}) {
+    for (int percentInfectious : {1, 10, 50}) {
+      b->Args({numVisits, percentInfectious});
+    }
+  }
+}
+
+/**
+ * Times processing one location's events, including sorting them and
+ * computing the propensity of every susceptible-infectious overlap and
+ * sending the resulting interactions. Each iteration copies the same
+ * unsorted events back into the location
+ */
+void BM_ProcessEvents(benchmark::State &state) {
+  DiseaseState susceptibleState, infectiousState;
+  findStates(benchmarkScenario->diseaseModel, &susceptibleState,
+    &infectiousState);
+  std::default_random_engine generator(benchmarkScenario->seed);
+  int numVisits = state.range(0);
+  std::vector<Event> events = generateEvents(numVisits,
+    state.range(1) / 100.0, susceptibleState, infectiousState, &generator);
+
+  Location *loc = LocationsBenchmark::getLocation(benchmarkLocations);
+  int numRuns = 0;
+  for (auto _ : state) {
+    loc->events = events;
+#ifdef ENABLE_SC
+    loc->anyInfectious = true;
+#endif
+    LocationsBenchmark::processEvents(benchmarkLocations, loc);
+
+    if (0 == ++numRuns % INTERACTION_DRAIN_INTERVAL) {
+      state.PauseTiming();
+      drainInteractions();
+      state.ResumeTiming();
+    }
+  }
+  drainInteractions();
+  state.SetItemsProcessed(state.iterations() * numVisits);
+}
+BENCHMARK(BM_ProcessEvents)->Apply(processEventsArguments);
+
+/** Times sorting one location's events on their own. */
+void BM_SortEvents(benchmark::State &state) {
+  std::default_random_engine generator(benchmarkScenario->seed);
+  int numVisits = state.range(0);
+  std::vector<Event> events = generateEvents(numVisits, 0.1, 0, 1,
+    &generator);
+
+  std::vector<Event> sorted;
+  for (auto _ : state) {
+    sorted = events;
+    std::sort(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(sorted.data());
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * numVisits);
+}
+BENCHMARK(BM_SortEvents)->RangeMultiplier(8)->Range(16, 65536);
+
+}  // namespace
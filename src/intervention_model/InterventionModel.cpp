@@ -12,17 +12,27 @@
 #include "../Extern.h"
 #include "../DiseaseModel.h"
 #include "../readers/AttributeTable.h"
+#include "../readers/Preprocess.h"
 
-InterventionModel::InterventionModel() : interventionDef(NULL) {}
+#include <algorithm>
+#include <string>
+#include <vector>
+
+InterventionModel::InterventionModel() : hash(0), firstPersonAttribute(-1),
+  firstLocationAttribute(-1), interventionDef(NULL) {}
 
 InterventionModel::InterventionModel(std::string interventionPath,
     AttributeTable *personAttributes, AttributeTable *locationAttributes,
     const DiseaseModel &diseaseModel) {
   interventionDef = new loimos::proto::InterventionModel();
   readProtobuf(interventionPath, interventionDef);
+  std::string serialized = interventionDef->SerializeAsString();
+  hash = hashBytes(serialized.data(), serialized.size(), FNV_OFFSET_BASIS);
 
   triggerFlags.resize(interventionDef->triggers_size(), false);
 
+  firstPersonAttribute = personAttributes->size();
+  firstLocationAttribute = locationAttributes->size();
   personAttributes->readAttributes(interventionDef->person_attributes());
   locationAttributes->readAttributes(interventionDef->location_attributes());
 
@@ -123,3 +133,92 @@ void InterventionModel::toggleInterventions(int day, Id newDailyInfections,
     }
   }
 }
+
+/**
+ * A run restarted with different interventions than the checkpointed one
+ * leaves them all off, to be triggered as usual from the day it restarts on
+ */
+void InterventionModel::pupCheckpoint(PUP::er &p) {
+  bool sameInterventions = pupCheckpointHash(p);
+  std::vector<int> flags(triggerFlags.begin(), triggerFlags.end());
+  p | flags;
+  if (!p.isUnpacking()) {
+    return;
+  }
+
+  if (sameInterventions) {
+    triggerFlags.assign(flags.begin(), flags.end());
+  } else if (0 == CkMyNode()) {
+    CkPrintf("  Checkpoint was taken with different interventions, so they"
+      " start over from the restart\n");
+  }
+}
+
+bool InterventionModel::pupCheckpointHash(PUP::er &p) const {
+  uint64_t savedHash = hash;
+  p | savedHash;
+  return savedHash == hash;
+}
+
+/**
+ * Interventions are recorded by their index, since filters are keyed by
+ * pointers which won't be the same in a restarted run. Filters are
+ * restored by applying their interventions again, which only depends on
+ * the object's visits. If the interventions have changed, any attributes
+ * the old ones added are replaced by the new ones' defaults instead
+ */
+template <class T>
+static void pupObject(PUP::er &p, T *obj,  // NOLINT(runtime/references)
+    const std::vector<std::shared_ptr<Intervention<T>>> &interventions,
+    const AttributeTable &attributes, int firstAttribute, bool restore) {
+  std::vector<int> complied;
+  std::vector<int> filtered;
+  if (!p.isUnpacking()) {
+    std::vector<const void *> causes = obj->getVisitFilters();
+    for (int i = 0; i < static_cast<int>(interventions.size()); ++i) {
+      if (obj->willComply(i)) {
+        complied.push_back(i);
+      }
+      const void *cause = interventions[i].get();
+      if (causes.end() != std::find(causes.begin(), causes.end(), cause)) {
+        filtered.push_back(i);
+      }
+    }
+  }
+  p | complied;
+  p | filtered;
+
+  if (p.isUnpacking() && restore) {
+    for (int i = 0; i < static_cast<int>(interventions.size()); ++i) {
+      obj->toggleCompliance(i, false);
+    }
+    for (int i : complied) {
+      obj->toggleCompliance(i, true);
+    }
+    for (int i : filtered) {
+      interventions[i]->apply(obj);
+    }
+
+  } else if (p.isUnpacking()) {
+    if (0 > firstAttribute) {
+      firstAttribute = attributes.size();
+    }
+    std::vector<union Data> &data = obj->getData();
+    data.resize(std::min(firstAttribute, static_cast<int>(data.size())));
+    for (int i = data.size(); i < attributes.size(); ++i) {
+      data.push_back(attributes.getDefaultValue(i));
+    }
+  }
+}
+
+void InterventionModel::pupPerson(PUP::er &p, Person *person,
+    const AttributeTable &attributes, bool restore) const {
+  pupObject(p, person, personInterventions, attributes, firstPersonAttribute,
+    restore);
+}
+
+void InterventionModel::pupLocation(PUP::er &p, Location *location,
+    const AttributeTable &attributes, bool restore) const {
+  pupObject(p, location, locationInterventions, attributes,
+    firstLocationAttribute, restore);
+}
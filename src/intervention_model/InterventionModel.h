@@ -18,6 +18,13 @@
 #include <string>
 
 struct InterventionModel {
+  // Identifies which interventions these are, so that a restarted run only
+  // restores their state if it uses the same ones as the checkpointed run
+  uint64_t hash;
+  // The first of the attributes the interventions added to people and
+  // locations (or -1 if there aren't any interventions)
+  int firstPersonAttribute;
+  int firstLocationAttribute;
   std::vector<bool> triggerFlags;
   std::vector<std::shared_ptr<Intervention<Person>>> personInterventions;
   std::vector<std::shared_ptr<Intervention<Location>>> locationInterventions;
@@ -40,5 +47,17 @@ struct InterventionModel {
   int getNumLocationInterventions() const;
   void applyInterventions(int day, Id newDailyInfections, Id numPeople);
   void toggleInterventions(int day, Id newDailyInfections, Id numPeople);
+
+  // Saves or restores which triggers are on
+  void pupCheckpoint(PUP::er &p);  // NOLINT(runtime/references)
+  // Saves or checks which interventions a chare's checkpoint was taken with,
+  // returning whether the rest of their state should be restored
+  bool pupCheckpointHash(PUP::er &p) const;  // NOLINT(runtime/references)
+  // Saves or restores which interventions a person or location complies
+  // with, and which are filtering its visits
+  void pupPerson(PUP::er &p, Person *person,  // NOLINT(runtime/references)
+    const AttributeTable &attributes, bool restore) const;
+  void pupLocation(PUP::er &p, Location *location,  // NOLINT(runtime/references)
+    const AttributeTable &attributes, bool restore) const;
 };
 #endif  // INTERVENTION_MODEL_INTERVENTIONMODEL_H_
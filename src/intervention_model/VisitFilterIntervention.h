@@ -29,11 +29,13 @@ class VisitFilterIntervention : public Intervention<T> {
     };
   }
 
+  // Filters are keyed by the same pointer InterventionModel holds, so that
+  // checkpoints can record them by index (see InterventionModel::pupObject)
   void apply(T *p) const override {
-    p->filterVisits(this, keepVisit);
+    p->filterVisits(static_cast<const Intervention<T> *>(this), keepVisit);
   }
   void remove(T *p) const override {
-    p->restoreVisits(this);
+    p->restoreVisits(static_cast<const Intervention<T> *>(this));
   }
 };
 
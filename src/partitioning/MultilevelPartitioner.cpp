@@ -0,0 +1,401 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "MultilevelPartitioner.h"
+#include "../Types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+MultilevelPartitioner::MultilevelPartitioner(PartitionId numParts_, int seed) :
+    numParts(numParts_), generator(seed),
+    totalWeights(NUM_PARTITION_CONSTRAINTS, 0),
+    maxPartWeights(NUM_PARTITION_CONSTRAINTS, 0) {}
+
+std::vector<PartitionId> MultilevelPartitioner::partition(const Graph &graph) {
+  std::fill(totalWeights.begin(), totalWeights.end(), 0);
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      totalWeights[c] += graph.getVertexWeight(v, c);
+    }
+  }
+  for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+    maxPartWeights[c] = std::ceil(PARTITION_IMBALANCE_TOLERANCE
+      * totalWeights[c] / numParts);
+  }
+
+  // Coarsen...
+  std::vector<std::unique_ptr<Graph> > levels;
+  std::vector<std::vector<Id> > coarseMaps;
+  const Graph *current = &graph;
+  while (current->numVertices > numParts * COARSEST_VERTICES_PER_PART) {
+    std::vector<Id> coarseMap;
+    std::unique_ptr<Graph> coarse(new Graph(coarsen(*current, &coarseMap)));
+    if (coarse->numVertices
+        > (1.0 - MIN_COARSENING_RATIO) * current->numVertices) {
+      break;
+    }
+    levels.push_back(std::move(coarse));
+    coarseMaps.push_back(std::move(coarseMap));
+    current = levels.back().get();
+  }
+
+  // ...partition...
+  std::vector<PartitionId> parts;
+  partitionCoarsest(*current, &parts);
+  refine(*current, &parts);
+
+  // ...and uncoarsen
+  for (int level = static_cast<int>(levels.size()) - 1; 0 <= level; --level) {
+    const Graph &finer = 0 == level ? graph : *levels[level - 1];
+    const std::vector<Id> &coarseMap = coarseMaps[level];
+    std::vector<PartitionId> finerParts(finer.numVertices);
+    for (Id v = 0; v < finer.numVertices; ++v) {
+      finerParts[v] = parts[coarseMap[v]];
+    }
+    parts.swap(finerParts);
+    refine(finer, &parts);
+  }
+  return parts;
+}
+
+/**
+ * Contracts a heavy-edge matching of graph, setting coarseMap to the vertex
+ * of the returned graph each vertex of graph was contracted into
+ */
+Graph MultilevelPartitioner::coarsen(const Graph &graph,
+    std::vector<Id> *coarseMap) {
+  Id n = graph.numVertices;
+  std::vector<Id> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), generator);
+
+  // Keep any one vertex from getting too heavy to balance
+  std::vector<Id> maxVertexWeights(NUM_PARTITION_CONSTRAINTS);
+  for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+    maxVertexWeights[c] = std::max(static_cast<Id>(1), maxPartWeights[c] / 4);
+  }
+
+  std::vector<Id> match(n, -1);
+  for (Id v : order) {
+    if (-1 != match[v]) {
+      continue;
+    }
+
+    Id best = v;
+    Id bestWeight = 0;
+    for (Id e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+      Id u = graph.neighbors[e];
+      if (-1 != match[u] || u == v || graph.edgeWeights[e] <= bestWeight) {
+        continue;
+      }
+      bool isLight = true;
+      for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+        isLight = isLight && graph.getVertexWeight(v, c)
+          + graph.getVertexWeight(u, c) <= maxVertexWeights[c];
+      }
+      if (isLight) {
+        best = u;
+        bestWeight = graph.edgeWeights[e];
+      }
+    }
+    match[v] = best;
+    match[best] = v;
+  }
+
+  // Number the coarse vertices in order of their lowest fine vertex, so
+  // that they can be built in order below
+  coarseMap->assign(n, -1);
+  Graph coarse;
+  coarse.numVertices = 0;
+  for (Id v = 0; v < n; ++v) {
+    if (v <= match[v]) {
+      (*coarseMap)[v] = (*coarseMap)[match[v]] = coarse.numVertices++;
+    }
+  }
+
+  coarse.offsets.reserve(coarse.numVertices + 1);
+  coarse.offsets.push_back(0);
+  coarse.vertexWeights.reserve(coarse.numVertices * NUM_PARTITION_CONSTRAINTS);
+  // Where each coarse neighbor of the current coarse vertex is in its list
+  std::vector<Id> slots(coarse.numVertices, -1);
+  for (Id v = 0; v < n; ++v) {
+    if (v > match[v]) {
+      continue;
+    }
+
+    Id cv = (*coarseMap)[v];
+    Id first = coarse.neighbors.size();
+    Id members[2] = {v, match[v]};
+    int numMembers = v == match[v] ? 1 : 2;
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      Id weight = 0;
+      for (int i = 0; i < numMembers; ++i) {
+        weight += graph.getVertexWeight(members[i], c);
+      }
+      coarse.vertexWeights.push_back(weight);
+    }
+
+    for (int i = 0; i < numMembers; ++i) {
+      Id member = members[i];
+      for (Id e = graph.offsets[member]; e < graph.offsets[member + 1]; ++e) {
+        Id cu = (*coarseMap)[graph.neighbors[e]];
+        if (cu == cv) {
+          continue;
+        } else if (-1 == slots[cu]) {
+          slots[cu] = coarse.neighbors.size();
+          coarse.neighbors.push_back(cu);
+          coarse.edgeWeights.push_back(graph.edgeWeights[e]);
+        } else {
+          coarse.edgeWeights[slots[cu]] += graph.edgeWeights[e];
+        }
+      }
+    }
+
+    for (Id e = first; e < static_cast<Id>(coarse.neighbors.size()); ++e) {
+      slots[coarse.neighbors[e]] = -1;
+    }
+    coarse.offsets.push_back(coarse.neighbors.size());
+  }
+  return coarse;
+}
+
+/**
+ * Assigns vertices to parts in breadth-first order, moving on to the next
+ * part once the current one has its share of the (normalized) weight, or
+ * once the next vertex would push it over the cap for any one constraint
+ */
+void MultilevelPartitioner::partitionCoarsest(const Graph &graph,
+    std::vector<PartitionId> *parts) {
+  Id n = graph.numVertices;
+  parts->assign(n, -1);
+  std::vector<Id> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), generator);
+
+  std::vector<Id> partWeights(numParts * NUM_PARTITION_CONSTRAINTS, 0);
+  std::vector<bool> isQueued(n, false);
+  std::deque<Id> queue;
+  Id nextSeed = 0;
+  PartitionId part = 0;
+  double assignedWeight = 0.0;
+  for (Id numAssigned = 0; numAssigned < n; ++numAssigned) {
+    // Start a new region if we've run out of connected vertices
+    if (queue.empty()) {
+      while (isQueued[order[nextSeed]]) {
+        nextSeed++;
+      }
+      queue.push_back(order[nextSeed]);
+      isQueued[order[nextSeed]] = true;
+    }
+
+    Id v = queue.front();
+    queue.pop_front();
+    if (part + 1 < numParts && !fits(graph, v, part, partWeights)) {
+      part++;
+    }
+    // Anything that doesn't fit even in a fresh part (or in the last part)
+    // goes to whichever part has the most room left for it
+    PartitionId target = part;
+    if (!fits(graph, v, target, partWeights)) {
+      double room;
+      target = findRoomiestPart(graph, v, partWeights, -1, &room);
+    }
+    (*parts)[v] = target;
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      Id weight = graph.getVertexWeight(v, c);
+      partWeights[target * NUM_PARTITION_CONSTRAINTS + c] += weight;
+      if (0 != totalWeights[c]) {
+        assignedWeight += static_cast<double>(weight)
+          / totalWeights[c] / NUM_PARTITION_CONSTRAINTS;
+      }
+    }
+    if (part + 1 < numParts
+        && assignedWeight >= static_cast<double>(part + 1) / numParts) {
+      part++;
+    }
+
+    for (Id e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+      Id u = graph.neighbors[e];
+      if (!isQueued[u]) {
+        queue.push_back(u);
+        isQueued[u] = true;
+      }
+    }
+  }
+}
+
+/**
+ * Whether vertex can be added to part without pushing it over the cap on
+ * any constraint (it's fine to add to a constraint that's already over, so
+ * long as the vertex doesn't weigh anything on it)
+ */
+bool MultilevelPartitioner::fits(const Graph &graph, Id vertex,
+    PartitionId part, const std::vector<Id> &partWeights) const {
+  for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+    Id weight = graph.getVertexWeight(vertex, c);
+    if (0 < weight && partWeights[part * NUM_PARTITION_CONSTRAINTS + c]
+        + weight > maxPartWeights[c]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns how far under its cap a part with the given weights would be on
+ * its most constrained weight, as a fraction of the cap (so this is
+ * negative for overweight parts)
+ */
+double MultilevelPartitioner::getRoom(const Id *weights) const {
+  double room = std::numeric_limits<double>::infinity();
+  for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+    if (0 != maxPartWeights[c]) {
+      room = std::min(room,
+        1.0 - static_cast<double>(weights[c]) / maxPartWeights[c]);
+    }
+  }
+  return room;
+}
+
+/**
+ * Returns the part (other than exclude) that would have the most room left
+ * if vertex were added to it, and sets room to how much that would be
+ */
+PartitionId MultilevelPartitioner::findRoomiestPart(const Graph &graph,
+    Id vertex, const std::vector<Id> &partWeights, PartitionId exclude,
+    double *room) const {
+  PartitionId best = -1;
+  *room = -std::numeric_limits<double>::infinity();
+  Id weights[NUM_PARTITION_CONSTRAINTS];
+  for (PartitionId part = 0; part < numParts; ++part) {
+    if (part == exclude) {
+      continue;
+    }
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      weights[c] = partWeights[part * NUM_PARTITION_CONSTRAINTS + c]
+        + graph.getVertexWeight(vertex, c);
+    }
+    double partRoom = getRoom(weights);
+    if (-1 == best || partRoom > *room) {
+      best = part;
+      *room = partRoom;
+    }
+  }
+  return best;
+}
+
+/**
+ * Greedily moves boundary vertices to whichever neighboring part most
+ * reduces the edge cut without breaking the balance constraints (or, for
+ * vertices in overweight parts, to any part with more room, preferring
+ * neighboring ones they fit in)
+ */
+void MultilevelPartitioner::refine(const Graph &graph,
+    std::vector<PartitionId> *parts) {
+  std::vector<Id> partWeights(numParts * NUM_PARTITION_CONSTRAINTS, 0);
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      partWeights[(*parts)[v] * NUM_PARTITION_CONSTRAINTS + c] +=
+        graph.getVertexWeight(v, c);
+    }
+  }
+
+  std::vector<Id> order(graph.numVertices);
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<Id> connectivity(numParts, 0);
+  std::vector<PartitionId> neighborParts;
+  for (int pass = 0; pass < NUM_REFINEMENT_PASSES; ++pass) {
+    std::shuffle(order.begin(), order.end(), generator);
+    Id numMoved = 0;
+    for (Id v : order) {
+      PartitionId from = (*parts)[v];
+      for (Id e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+        PartitionId p = (*parts)[graph.neighbors[e]];
+        if (0 == connectivity[p]) {
+          neighborParts.push_back(p);
+        }
+        connectivity[p] += graph.edgeWeights[e];
+      }
+
+      // Only count the part as overweight if moving this vertex would help
+      bool isOverweight = false;
+      for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+        isOverweight = isOverweight || (0 < graph.getVertexWeight(v, c)
+          && partWeights[from * NUM_PARTITION_CONSTRAINTS + c]
+            > maxPartWeights[c]);
+      }
+
+      PartitionId best = from;
+      Id bestGain = 0;
+      for (PartitionId to : neighborParts) {
+        Id gain = connectivity[to] - connectivity[from];
+        bool isBetter = best == from ? 0 < gain || isOverweight
+          : gain > bestGain;
+        if (to != from && isBetter && fits(graph, v, to, partWeights)) {
+          best = to;
+          bestGain = gain;
+        }
+      }
+      // If none of the neighboring parts have room, any part will do, and
+      // failing that, we can at least move the excess somewhere with more
+      // room (where it may be easier to shed, if it's on another constraint)
+      if (isOverweight && best == from) {
+        for (PartitionId to = 0; to < numParts && best == from; ++to) {
+          if (to != from && fits(graph, v, to, partWeights)) {
+            best = to;
+          }
+        }
+
+        double room;
+        PartitionId to = findRoomiestPart(graph, v, partWeights, from, &room);
+        if (best == from && -1 != to && room > getRoom(&partWeights[from
+            * NUM_PARTITION_CONSTRAINTS])) {
+          best = to;
+        }
+      }
+
+      if (best != from) {
+        for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+          Id weight = graph.getVertexWeight(v, c);
+          partWeights[from * NUM_PARTITION_CONSTRAINTS + c] -= weight;
+          partWeights[best * NUM_PARTITION_CONSTRAINTS + c] += weight;
+        }
+        (*parts)[v] = best;
+        numMoved++;
+      }
+
+      for (PartitionId p : neighborParts) {
+        connectivity[p] = 0;
+      }
+      neighborParts.clear();
+    }
+
+    if (0 == numMoved) {
+      break;
+    }
+  }
+}
+
+Id MultilevelPartitioner::getEdgeCut(const Graph &graph,
+    const std::vector<PartitionId> &parts) {
+  Id cut = 0;
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    for (Id e = graph.offsets[v]; e < graph.offsets[v + 1]; ++e) {
+      if (parts[v] != parts[graph.neighbors[e]]) {
+        cut += graph.edgeWeights[e];
+      }
+    }
+  }
+  // Each edge was counted from both of its endpoints
+  return cut / 2;
+}
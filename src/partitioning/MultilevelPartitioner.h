@@ -0,0 +1,72 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PARTITIONING_MULTILEVELPARTITIONER_H_
+#define PARTITIONING_MULTILEVELPARTITIONER_H_
+
+#include "../Types.h"
+
+#include <random>
+#include <vector>
+
+// Vertices are balanced on each of these separately (for people/location
+// graphs, person load and location load)
+#define NUM_PARTITION_CONSTRAINTS 2
+// Each part may hold up to this multiple of its share of each constraint
+#define PARTITION_IMBALANCE_TOLERANCE 1.05
+// Coarsening stops once the graph has this many vertices per part...
+#define COARSEST_VERTICES_PER_PART 20
+// ...or once a round of coarsening removes fewer than this fraction of them
+#define MIN_COARSENING_RATIO 0.05
+#define NUM_REFINEMENT_PASSES 8
+
+// Undirected graph with weighted edges and vertices, stored in compressed
+// sparse row form (so each edge appears once for each of its endpoints)
+struct Graph {
+  Id numVertices;
+  // The neighbors of vertex v are neighbors[offsets[v]:offsets[v + 1]]
+  std::vector<Id> offsets;
+  std::vector<Id> neighbors;
+  std::vector<Id> edgeWeights;
+  // NUM_PARTITION_CONSTRAINTS weights for each vertex
+  std::vector<Id> vertexWeights;
+
+  Id getVertexWeight(Id vertex, int constraint) const {
+    return vertexWeights[vertex * NUM_PARTITION_CONSTRAINTS + constraint];
+  }
+};
+
+// Splits a graph into balanced parts while keeping the total weight of the
+// edges between parts low, in the style of METIS: the graph is repeatedly
+// coarsened by contracting heavy edges, the coarsest graph is partitioned
+// by growing regions, and that partition is projected back through each
+// level, with greedy boundary refinement at each step
+class MultilevelPartitioner {
+ private:
+  PartitionId numParts;
+  std::default_random_engine generator;
+  std::vector<Id> totalWeights;
+  std::vector<Id> maxPartWeights;
+
+  Graph coarsen(const Graph &graph, std::vector<Id> *coarseMap);
+  void partitionCoarsest(const Graph &graph, std::vector<PartitionId> *parts);
+  void refine(const Graph &graph, std::vector<PartitionId> *parts);
+  bool fits(const Graph &graph, Id vertex, PartitionId part,
+    const std::vector<Id> &partWeights) const;
+  double getRoom(const Id *weights) const;
+  PartitionId findRoomiestPart(const Graph &graph, Id vertex,
+    const std::vector<Id> &partWeights, PartitionId exclude,
+    double *room) const;
+
+ public:
+  MultilevelPartitioner(PartitionId numParts, int seed);
+  // Returns the part each vertex is assigned to
+  std::vector<PartitionId> partition(const Graph &graph);
+  static Id getEdgeCut(const Graph &graph,
+    const std::vector<PartitionId> &parts);
+};
+
+#endif  // PARTITIONING_MULTILEVELPARTITIONER_H_
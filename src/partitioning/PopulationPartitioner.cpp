@@ -0,0 +1,585 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "PopulationPartitioner.h"
+#include "MultilevelPartitioner.h"
+#include "../Types.h"
+#include "../Defs.h"
+#include "../readers/DataReader.h"
+#include "../readers/Compression.h"
+#include "../readers/Preprocess.h"
+#include "../protobuf/data.pb.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <google/protobuf/text_format.h>
+
+// A CSV file read fully into memory, with the positions of each row so that
+// rows can be rewritten in any order
+struct CsvFile {
+  std::string header;
+  std::string data;
+  // Row i is data[rowStarts[i]:rowStarts[i + 1] - 1] (dropping the newline)
+  std::vector<std::size_t> rowStarts;
+
+  Id getNumRows() const {
+    return rowStarts.size() - 1;
+  }
+  const char *getRow(Id row) const {
+    return data.c_str() + rowStarts[row];
+  }
+  std::size_t getRowLength(Id row) const {
+    return rowStarts[row + 1] - rowStarts[row] - 1;
+  }
+};
+
+static CsvFile readCsv(std::string path) {
+  std::unique_ptr<std::istream> input = openInput(path);
+  CsvFile csv;
+  std::getline(*input, csv.header);
+  csv.data.assign(std::istreambuf_iterator<char>(*input),
+    std::istreambuf_iterator<char>());
+  if (!csv.data.empty() && '\n' != csv.data.back()) {
+    csv.data.push_back('\n');
+  }
+
+  csv.rowStarts.push_back(0);
+  for (std::size_t i = 0; i < csv.data.size(); ++i) {
+    if ('\n' == csv.data[i]) {
+      csv.rowStarts.push_back(i + 1);
+    }
+  }
+  return csv;
+}
+
+static int getIdColumn(const loimos::proto::CSVDefinition &def,
+    bool isForeign, std::string path) {
+  for (int i = 0; i < def.fields_size(); ++i) {
+    if (isForeign ? def.fields(i).has_foreign_id()
+        : def.fields(i).has_unique_id()) {
+      return i;
+    }
+  }
+  CkAbort("Error: no column in %s marked as %s\n", path.c_str(),
+    isForeign ? "foreign id" : "id");
+  return -1;
+}
+
+static Id parseField(const char *row, int column) {
+  for (int i = 0; i < column; ++i) {
+    row = strchr(row, CSV_DELIM) + 1;
+  }
+  return strtol(row, NULL, 10);
+}
+
+/**
+ * Writes out a row with the values in the given columns replaced by new ids
+ */
+static void writeRow(std::ostream *out, const CsvFile &csv, Id row,
+    const std::vector<std::pair<int, Id> > &replacements) {
+  const char *start = csv.getRow(row);
+  const char *end = start + csv.getRowLength(row);
+  int column = 0;
+  while (start <= end) {
+    const char *fieldEnd = std::find(start, end, CSV_DELIM);
+    if (0 != column) {
+      out->put(CSV_DELIM);
+    }
+
+    bool isReplaced = false;
+    for (const std::pair<int, Id> &replacement : replacements) {
+      if (replacement.first == column) {
+        *out << replacement.second;
+        isReplaced = true;
+      }
+    }
+    if (!isReplaced) {
+      out->write(start, fieldEnd - start);
+    }
+
+    start = fieldEnd + 1;
+    column++;
+  }
+  out->put('\n');
+}
+
+static void writeMetadata(std::string path,
+    const loimos::proto::CSVDefinition &def) {
+  std::string text;
+  google::protobuf::TextFormat::PrintToString(def, &text);
+  std::ofstream out(path);
+  out << text;
+}
+
+static void writeOffsets(std::string path, Id numRows,
+    const std::vector<Id> &offsets) {
+  std::ofstream out(path);
+  out << "num_rows: " << numRows << "\n";
+  for (Id offset : offsets) {
+    out << "partition_offsets: " << offset << "\n";
+  }
+}
+
+/**
+ * Returns the first new id in each of numPartitions partitions, each made
+ * up of consecutive parts, where partStarts holds the first new id in
+ * each part (and the total number of ids at the end)
+ */
+static std::vector<Id> getPartitionOffsets(const std::vector<Id> &partStarts,
+    PartitionId numPartitions) {
+  PartitionId numParts = partStarts.size() - 1;
+  Id numObjects = partStarts.back();
+  std::vector<Id> offsets(numPartitions);
+  for (PartitionId i = 0; i < numPartitions; ++i) {
+    offsets[i] = partStarts[static_cast<Id>(i) * numParts / numPartitions];
+
+    // Keep partitions from being empty, since Partitioner can't handle that
+    offsets[i] = std::max(offsets[i], 0 == i ? 0 : offsets[i - 1] + 1);
+    offsets[i] = std::min(offsets[i], numObjects - (numPartitions - i));
+  }
+  return offsets;
+}
+
+/**
+ * Returns the new id of each object, such that the objects in each part
+ * have consecutive ids (in their original order), and sets partStarts to
+ * the first new id in each part
+ */
+static std::vector<Id> relabel(const std::vector<PartitionId> &parts,
+    Id firstVertex, Id numObjects, PartitionId numParts,
+    std::vector<Id> *partStarts) {
+  partStarts->assign(numParts + 1, 0);
+  for (Id i = 0; i < numObjects; ++i) {
+    (*partStarts)[parts[firstVertex + i] + 1]++;
+  }
+  for (PartitionId p = 0; p < numParts; ++p) {
+    (*partStarts)[p + 1] += (*partStarts)[p];
+  }
+
+  std::vector<Id> next(partStarts->begin(), partStarts->end() - 1);
+  std::vector<Id> newIds(numObjects);
+  for (Id i = 0; i < numObjects; ++i) {
+    newIds[i] = next[parts[firstVertex + i]]++;
+  }
+  return newIds;
+}
+// Everything we need to know about a population to renumber it
+struct Population {
+  loimos::proto::CSVDefinition personDef;
+  loimos::proto::CSVDefinition locationDef;
+  loimos::proto::CSVDefinition visitDef;
+  CsvFile people;
+  CsvFile locations;
+  CsvFile visits;
+  int personIdColumn;
+  int locationIdColumn;
+  int visitPersonColumn;
+  int visitLocationColumn;
+
+  // The original id in each row
+  std::vector<Id> personIds;
+  std::vector<Id> locationIds;
+  // The person and location row each visit refers to
+  std::vector<Id> visitPersonRows;
+  std::vector<Id> visitLocationRows;
+  // Visits are grouped by location, so we just need to remember where each
+  // location's visits start and end to write them out in a new order
+  std::vector<std::pair<Id, Id> > locationVisits;
+};
+
+static CsvFile readIds(std::string path, int column, std::vector<Id> *ids,
+    std::unordered_map<Id, Id> *rows) {
+  CsvFile csv = readCsv(path);
+  Id numRows = csv.getNumRows();
+  ids->resize(numRows);
+  rows->reserve(numRows);
+  for (Id row = 0; row < numRows; ++row) {
+    (*ids)[row] = parseField(csv.getRow(row), column);
+    if (!rows->emplace((*ids)[row], row).second) {
+      CkAbort("Error: id " ID_PRINT_TYPE " appears more than once in %s\n",
+        (*ids)[row], path.c_str());
+    }
+  }
+  return csv;
+}
+
+static void readPopulation(std::string scenarioPath, Population *population) {
+  checkReadResult(readProtobuf(scenarioPath + "people.textproto",
+    &population->personDef), scenarioPath + "people.textproto");
+  checkReadResult(readProtobuf(scenarioPath + "locations.textproto",
+    &population->locationDef), scenarioPath + "locations.textproto");
+  checkReadResult(readProtobuf(scenarioPath + "visits.textproto",
+    &population->visitDef), scenarioPath + "visits.textproto");
+
+  std::string personPath = resolveInputPath(scenarioPath + "people.csv");
+  population->personIdColumn = getIdColumn(population->personDef, false,
+    personPath);
+  std::unordered_map<Id, Id> personRows;
+  population->people = readIds(personPath, population->personIdColumn,
+    &population->personIds, &personRows);
+
+  std::string locationPath = resolveInputPath(scenarioPath + "locations.csv");
+  population->locationIdColumn = getIdColumn(population->locationDef, false,
+    locationPath);
+  std::unordered_map<Id, Id> locationRows;
+  population->locations = readIds(locationPath, population->locationIdColumn,
+    &population->locationIds, &locationRows);
+
+  std::string visitsPath = resolveInputPath(scenarioPath + "visits.csv");
+  population->visits = readCsv(visitsPath);
+  population->visitLocationColumn = getIdColumn(population->visitDef, false,
+    visitsPath);
+  population->visitPersonColumn = getIdColumn(population->visitDef, true,
+    visitsPath);
+  Id numVisits = population->visits.getNumRows();
+  population->visitPersonRows.resize(numVisits);
+  population->visitLocationRows.resize(numVisits);
+  population->locationVisits.assign(population->locationIds.size(),
+    std::make_pair(-1, -1));
+  for (Id row = 0; row < numVisits; ++row) {
+    const char *visit = population->visits.getRow(row);
+    auto location = locationRows.find(parseField(visit,
+      population->visitLocationColumn));
+    auto person = personRows.find(parseField(visit,
+      population->visitPersonColumn));
+    if (locationRows.end() == location || personRows.end() == person) {
+      CkAbort("Error: visit " ID_PRINT_TYPE " in %s refers to an unknown "
+        "person or location\n", row, visitsPath.c_str());
+    }
+    population->visitPersonRows[row] = person->second;
+    population->visitLocationRows[row] = location->second;
+
+    std::pair<Id, Id> &range = population->locationVisits[location->second];
+    if (-1 == range.first) {
+      range = std::make_pair(row, row + 1);
+    } else if (range.second == row) {
+      range.second++;
+    } else {
+      CkAbort("Error: visits in %s must be sorted by location\n",
+        visitsPath.c_str());
+    }
+  }
+}
+
+/**
+ * Writes out the original id of each new id, so that outputs can be mapped
+ * back onto the input population
+ */
+static void writeIdMap(std::string path, const std::vector<Id> &order,
+    const std::vector<Id> &originalIds) {
+  std::ofstream out(path);
+  out << "id,original_id\n";
+  for (std::size_t newId = 0; newId < order.size(); ++newId) {
+    out << newId << CSV_DELIM << originalIds[order[newId]] << "\n";
+  }
+}
+
+/**
+ * Writes a copy of population to outputPath in which each row's id is
+ * replaced with its new id (which must run from 0 to the number of rows),
+ * with rows sorted by their new ids
+ */
+static void writePopulation(std::string outputPath,
+    const Population &population, const std::vector<Id> &newPersonIds,
+    const std::vector<Id> &newLocationIds) {
+  Id numPeople = newPersonIds.size();
+  std::vector<Id> personOrder(numPeople);
+  for (Id row = 0; row < numPeople; ++row) {
+    personOrder[newPersonIds[row]] = row;
+  }
+  std::ofstream personStream(outputPath + "people.csv");
+  personStream << population.people.header << "\n";
+  for (Id row : personOrder) {
+    writeRow(&personStream, population.people, row,
+      {std::make_pair(population.personIdColumn, newPersonIds[row])});
+  }
+  personStream.close();
+
+  Id numLocations = newLocationIds.size();
+  std::vector<Id> locationOrder(numLocations);
+  for (Id row = 0; row < numLocations; ++row) {
+    locationOrder[newLocationIds[row]] = row;
+  }
+  std::ofstream locationStream(outputPath + "locations.csv");
+  locationStream << population.locations.header << "\n";
+  for (Id row : locationOrder) {
+    writeRow(&locationStream, population.locations, row,
+      {std::make_pair(population.locationIdColumn, newLocationIds[row])});
+  }
+  locationStream.close();
+
+  // Keep visits sorted by location
+  std::ofstream visitStream(outputPath + "visits.csv");
+  visitStream << population.visits.header << "\n";
+  for (Id row : locationOrder) {
+    const std::pair<Id, Id> &range = population.locationVisits[row];
+    for (Id visit = range.first; visit < range.second; ++visit) {
+      writeRow(&visitStream, population.visits, visit,
+        {std::make_pair(population.visitLocationColumn, newLocationIds[row]),
+        std::make_pair(population.visitPersonColumn,
+          newPersonIds[population.visitPersonRows[visit]])});
+    }
+  }
+  visitStream.close();
+
+  writeMetadata(outputPath + "people.textproto", population.personDef);
+  writeMetadata(outputPath + "locations.textproto", population.locationDef);
+  writeMetadata(outputPath + "visits.textproto", population.visitDef);
+  writeIdMap(outputPath + "person_ids.csv", personOrder, population.personIds);
+  writeIdMap(outputPath + "location_ids.csv", locationOrder,
+    population.locationIds);
+}
+
+/**
+ * Returns the header marking a rewritten population as up to date, which
+ * covers all three of its inputs and their metadata
+ */
+static CacheHeader getPopulationHeader(std::string scenarioPath,
+    std::vector<Id> layout) {
+  for (std::string name : {"people.csv", "locations.csv"}) {
+    std::string path = resolveInputPath(scenarioPath + name);
+    layout.push_back(createCacheHeader(path, {}, 0, 0).inputHash);
+  }
+  return createCacheHeader(resolveInputPath(scenarioPath + "visits.csv"),
+    layout, 0, hashMetadata(scenarioPath));
+}
+
+// Only mark the population as usable once everything else is written
+static void writeMarker(std::string path, const CacheHeader &header) {
+  FILE *marker = fopen(path.c_str(), "wb");
+  if (NULL == marker) {
+    CkAbort("Error: failed to open %s\n", path.c_str());
+  }
+  fwrite(&header, sizeof(CacheHeader), 1, marker);
+  fclose(marker);
+}
+
+std::string partitionPopulation(std::string scenarioPath,
+    std::string cachePath, PartitionId numPersonPartitions,
+    PartitionId numLocationPartitions, int seed) {
+  std::string outputDir = cachePath + "partitioned_"
+    + std::to_string(numPersonPartitions) + "_"
+    + std::to_string(numLocationPartitions);
+  std::string outputPath = outputDir + "/";
+  CacheHeader header = getPopulationHeader(scenarioPath,
+    {numPersonPartitions, numLocationPartitions, seed});
+  std::string markerPath = outputPath + "partitions.cache";
+  createDirectory(outputDir, scenarioPath);
+  if (isCacheValid(markerPath, header)) {
+    CkPrintf("Using partitioned population in %s\n", outputPath.c_str());
+    return outputPath;
+  }
+  double startTime = CkWallTimer();
+
+  Population population;
+  readPopulation(scenarioPath, &population);
+  Id numPeople = population.personIds.size();
+  Id numLocations = population.locationIds.size();
+  Id numVisits = population.visits.getNumRows();
+  if (numPersonPartitions > numPeople
+      || numLocationPartitions > numLocations) {
+    CkAbort("Error: more partitions than people or locations\n");
+  }
+
+  // People come first in the graph, followed by locations, in the order
+  // they appear in their files. Each is weighted by the number of visits
+  // they're involved in, plus one so that idle ones still get spread out
+  Graph graph;
+  graph.numVertices = numPeople + numLocations;
+  graph.vertexWeights.assign(graph.numVertices * NUM_PARTITION_CONSTRAINTS, 0);
+  for (Id row = 0; row < numPeople; ++row) {
+    graph.vertexWeights[row * NUM_PARTITION_CONSTRAINTS] = 1;
+  }
+  for (Id row = 0; row < numLocations; ++row) {
+    graph.vertexWeights[(numPeople + row) * NUM_PARTITION_CONSTRAINTS + 1] = 1;
+  }
+
+  std::vector<std::pair<Id, Id> > edges;
+  edges.reserve(numVisits);
+  for (Id row = 0; row < numVisits; ++row) {
+    Id personVertex = population.visitPersonRows[row];
+    Id locationVertex = numPeople + population.visitLocationRows[row];
+    graph.vertexWeights[personVertex * NUM_PARTITION_CONSTRAINTS]++;
+    graph.vertexWeights[locationVertex * NUM_PARTITION_CONSTRAINTS + 1]++;
+    edges.emplace_back(personVertex, locationVertex);
+  }
+
+  // Combine repeat visits into a single, heavier edge
+  std::sort(edges.begin(), edges.end());
+  std::vector<Id> degrees(graph.numVertices, 0);
+  std::vector<Id> weights;
+  Id numEdges = 0;
+  for (Id i = 0; i < numVisits; ++i) {
+    if (0 != i && edges[i] == edges[numEdges - 1]) {
+      weights[numEdges - 1]++;
+    } else {
+      edges[numEdges++] = edges[i];
+      weights.push_back(1);
+      degrees[edges[i].first]++;
+      degrees[edges[i].second]++;
+    }
+  }
+  edges.resize(numEdges);
+
+  graph.offsets.assign(graph.numVertices + 1, 0);
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    graph.offsets[v + 1] = graph.offsets[v] + degrees[v];
+  }
+  graph.neighbors.resize(2 * numEdges);
+  graph.edgeWeights.resize(2 * numEdges);
+  std::vector<Id> next(graph.offsets.begin(), graph.offsets.end() - 1);
+  for (Id i = 0; i < numEdges; ++i) {
+    Id a = edges[i].first;
+    Id b = edges[i].second;
+    graph.neighbors[next[a]] = b;
+    graph.edgeWeights[next[a]++] = weights[i];
+    graph.neighbors[next[b]] = a;
+    graph.edgeWeights[next[b]++] = weights[i];
+  }
+
+  // Split into enough parts that each partition of people and locations is
+  // made up of whole parts
+  PartitionId numParts = std::max(numPersonPartitions, numLocationPartitions);
+  MultilevelPartitioner partitioner(numParts, seed);
+  std::vector<PartitionId> parts = partitioner.partition(graph);
+
+  std::vector<Id> personPartStarts;
+  std::vector<Id> locationPartStarts;
+  std::vector<Id> newPersonIds = relabel(parts, 0, numPeople, numParts,
+    &personPartStarts);
+  std::vector<Id> newLocationIds = relabel(parts, numPeople, numLocations,
+    numParts, &locationPartStarts);
+
+  // Any offsets the population came with no longer apply
+  population.personDef.clear_partition_offsets();
+  population.locationDef.clear_partition_offsets();
+  writePopulation(outputPath, population, newPersonIds, newLocationIds);
+  writeOffsets(outputPath + "person_offsets_"
+    + std::to_string(numPersonPartitions) + ".textproto", numPeople,
+    getPartitionOffsets(personPartStarts, numPersonPartitions));
+  writeOffsets(outputPath + "location_offsets_"
+    + std::to_string(numLocationPartitions) + ".textproto", numLocations,
+    getPartitionOffsets(locationPartStarts, numLocationPartitions));
+  writeMarker(markerPath, header);
+
+  Id numLocalVisits = 0;
+  for (Id row = 0; row < numVisits; ++row) {
+    numLocalVisits += parts[population.visitPersonRows[row]]
+      == parts[numPeople + population.visitLocationRows[row]];
+  }
+  CkPrintf("Partitioned population into %d parts in %f seconds "
+    "(%.2f%% of visits local, edge cut " ID_PRINT_TYPE ")\n", numParts,
+    CkWallTimer() - startTime,
+    0 == numVisits ? 100.0 : 100.0 * numLocalVisits / numVisits,
+    MultilevelPartitioner::getEdgeCut(graph, parts));
+  return outputPath;
+}
+
+/**
+ * Moves each offset onto the dense id of the first object at or after it
+ */
+static void remapOffsets(const std::vector<Id> &sortedIds,
+    google::protobuf::RepeatedField<google::protobuf::int64> *offsets) {
+  for (int i = 0; i < offsets->size(); ++i) {
+    offsets->Set(i, std::lower_bound(sortedIds.begin(), sortedIds.end(),
+      offsets->Get(i)) - sortedIds.begin());
+  }
+}
+
+/**
+ * Returns the dense id of each row (its id's rank among all the ids), and
+ * sets sortedIds to the original ids in order
+ */
+static std::vector<Id> getDenseIds(const std::vector<Id> &ids,
+    std::vector<Id> *sortedIds) {
+  std::vector<Id> order(ids.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&ids](Id a, Id b) {
+    return ids[a] < ids[b];
+  });
+
+  std::vector<Id> denseIds(ids.size());
+  sortedIds->resize(ids.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    denseIds[order[i]] = i;
+    (*sortedIds)[i] = ids[order[i]];
+  }
+  return denseIds;
+}
+
+/**
+ * Copies an offset file from the input population, if there is one, with
+ * its offsets moved onto the dense ids
+ */
+static void remapOffsetFile(std::string inputPath, std::string outputPath,
+    const std::vector<Id> &sortedIds) {
+  loimos::proto::CSVDefinition offsetDef;
+  if (FILE_READ_ERROR == readProtobuf(inputPath, &offsetDef)) {
+    return;
+  }
+  remapOffsets(sortedIds, offsetDef.mutable_partition_offsets());
+  std::vector<Id> offsets(offsetDef.partition_offsets().begin(),
+    offsetDef.partition_offsets().end());
+  writeOffsets(outputPath, offsetDef.num_rows(), offsets);
+}
+
+std::string densifyPopulation(std::string scenarioPath, std::string cachePath,
+    PartitionId numPersonPartitions, PartitionId numLocationPartitions) {
+  std::string outputDir = cachePath + "dense";
+  std::string outputPath = outputDir + "/";
+  CacheHeader header = getPopulationHeader(scenarioPath,
+    {numPersonPartitions, numLocationPartitions});
+  std::string markerPath = outputPath + "ids.cache";
+  createDirectory(outputDir, scenarioPath);
+  if (isCacheValid(markerPath, header)) {
+    CkPrintf("Using population with dense ids in %s\n", outputPath.c_str());
+    return outputPath;
+  }
+  double startTime = CkWallTimer();
+
+  Population population;
+  readPopulation(scenarioPath, &population);
+
+  // Ranking ids keeps them in the same order, so any partition offsets
+  // the population came with still describe the same partitions
+  std::vector<Id> sortedPersonIds;
+  std::vector<Id> sortedLocationIds;
+  std::vector<Id> newPersonIds = getDenseIds(population.personIds,
+    &sortedPersonIds);
+  std::vector<Id> newLocationIds = getDenseIds(population.locationIds,
+    &sortedLocationIds);
+  remapOffsets(sortedPersonIds,
+    population.personDef.mutable_partition_offsets());
+  remapOffsets(sortedLocationIds,
+    population.locationDef.mutable_partition_offsets());
+
+  writePopulation(outputPath, population, newPersonIds, newLocationIds);
+  std::string personOffsetName = "person_offsets_"
+    + std::to_string(numPersonPartitions) + ".textproto";
+  remapOffsetFile(scenarioPath + personOffsetName,
+    outputPath + personOffsetName, sortedPersonIds);
+  std::string locationOffsetName = "location_offsets_"
+    + std::to_string(numLocationPartitions) + ".textproto";
+  remapOffsetFile(scenarioPath + locationOffsetName,
+    outputPath + locationOffsetName, sortedLocationIds);
+  writeMarker(markerPath, header);
+
+  CkPrintf("Remapped " ID_PRINT_TYPE " person and " ID_PRINT_TYPE
+    " location ids onto dense ids in %f seconds\n",
+    static_cast<Id>(newPersonIds.size()),
+    static_cast<Id>(newLocationIds.size()), CkWallTimer() - startTime);
+  return outputPath;
+}
@@ -0,0 +1,41 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PARTITIONING_POPULATIONPARTITIONER_H_
+#define PARTITIONING_POPULATIONPARTITIONER_H_
+
+#include "../Types.h"
+
+#include <string>
+
+/**
+ * Partitions the bipartite graph of people and the locations they visit so
+ * that people mostly visit locations in the same partition, then writes a
+ * copy of the population in which people and locations are renumbered so
+ * that each partition holds a contiguous range of ids (which is what
+ * Partitioner expects), along with the matching offset files. Returns the
+ * path to the new population, which is reused on later runs as long as
+ * the inputs haven't changed. Both this and densifyPopulation also write
+ * person_ids.csv and location_ids.csv, which map the new ids back onto the
+ * original ones
+ */
+std::string partitionPopulation(std::string scenarioPath,
+  std::string cachePath, PartitionId numPersonPartitions,
+  PartitionId numLocationPartitions, int seed);
+
+/**
+ * Writes a copy of the population in which the (possibly sparse) ids of
+ * people and locations are replaced by their rank, so that they run from 0
+ * to the number of people or locations, which is what Partitioner and the
+ * data caches expect. Any partition offsets, including those in the offset
+ * files for the given numbers of partitions, are moved onto the new ids.
+ * Returns the path to the new population, which is reused on later runs as
+ * long as the inputs haven't changed
+ */
+std::string densifyPopulation(std::string scenarioPath, std::string cachePath,
+  PartitionId numPersonPartitions, PartitionId numLocationPartitions);
+
+#endif  // PARTITIONING_POPULATIONPARTITIONER_H_
@@ -0,0 +1,297 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Support for reading population data stored as block-compressed gzip
+ * files. Since each block is an independent gzip member, a chare can start
+ * decompressing at the block containing its data (found using the block
+ * index) rather than having to decompress the file from the beginning
+ */
+
+#include "Compression.h"
+#include "Preprocess.h"
+#include "../Types.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+std::string resolveInputPath(std::string path) {
+  struct stat inputStat;
+  std::string compressedPath = path + COMPRESSED_INPUT_SUFFIX;
+  if (0 != stat(path.c_str(), &inputStat)
+      && 0 == stat(compressedPath.c_str(), &inputStat)) {
+    return compressedPath;
+  }
+  return path;
+}
+
+bool isCompressedInput(std::string path) {
+  std::string suffix = COMPRESSED_INPUT_SUFFIX;
+  return path.size() >= suffix.size()
+    && 0 == path.compare(path.size() - suffix.size(), suffix.size(), suffix);
+}
+
+std::string getBlockIndexPath(std::string inputPath, std::string cachePath) {
+  std::size_t nameStart = inputPath.find_last_of('/');
+  std::string name = std::string::npos == nameStart ?
+    inputPath : inputPath.substr(nameStart + 1);
+  return cachePath + name + BLOCK_INDEX_SUFFIX;
+}
+
+/**
+ * Decompresses the input at inputPath once to find where each block starts,
+ * and saves the result to indexPath (unless an up-to-date index exists)
+ */
+void buildBlockIndex(std::string inputPath, std::string indexPath) {
+  // The block index only depends on the compressed bytes themselves
+  CacheHeader header = createCacheHeader(inputPath, std::vector<Id>(), 0, 0);
+  if (isCacheValid(indexPath, header)) {
+    CkPrintf("  Using existing block index\n");
+    return;
+  }
+
+  GzipFileStream inputStream(inputPath);
+  if (!inputStream) {
+    CkAbort("Error: Could not open %s\n", inputPath.c_str());
+  }
+  std::vector<char> buf(DECOMPRESSION_BUFFER_SIZE);
+  while (inputStream.read(buf.data(), buf.size()) || 0 < inputStream.gcount()) {}
+  const BlockIndex &blocks = inputStream.getBlocks();
+  if (2 >= blocks.size()) {
+    CkPrintf("  Warning: %s is compressed as a single block, so every chare"
+      " will need to decompress all of it\n", inputPath.c_str());
+  }
+
+  CkPrintf("  Saving block index to %s\n", indexPath.c_str());
+  std::ofstream outputStream(indexPath, std::ios_base::binary);
+  if (!outputStream) {
+    CkAbort("Error: Could not open cache file %s\n", indexPath.c_str());
+  }
+  outputStream.write(reinterpret_cast<const char *>(&header),
+    sizeof(CacheHeader));
+  outputStream.write(reinterpret_cast<const char *>(blocks.data()),
+    blocks.size() * sizeof(CompressedBlock));
+}
+
+BlockIndex readBlockIndex(std::string indexPath) {
+  std::ifstream indexStream(indexPath, std::ios_base::binary);
+  if (!indexStream) {
+    CkAbort("Error: unable to read block index %s\n", indexPath.c_str());
+  }
+  indexStream.seekg(0, std::ios_base::end);
+  std::size_t numBlocks = (static_cast<std::size_t>(indexStream.tellg())
+    - sizeof(CacheHeader)) / sizeof(CompressedBlock);
+  if (0 == numBlocks) {
+    CkAbort("Error: block index %s is truncated\n", indexPath.c_str());
+  }
+
+  BlockIndex blocks(numBlocks);
+  indexStream.seekg(sizeof(CacheHeader));
+  indexStream.read(reinterpret_cast<char *>(blocks.data()),
+    numBlocks * sizeof(CompressedBlock));
+  return blocks;
+}
+
+std::unique_ptr<std::istream> openInput(std::string path) {
+  if (isCompressedInput(path)) {
+    return std::unique_ptr<std::istream>(new GzipFileStream(path));
+  }
+  return std::unique_ptr<std::istream>(
+    new std::ifstream(path, std::ios_base::binary));
+}
+
+GzipFileBuffer::GzipFileBuffer(std::string path_) : path(path_),
+    input(DECOMPRESSION_BUFFER_SIZE), output(DECOMPRESSION_BUFFER_SIZE),
+    numBytesRead(0), outputOffset(0), atBlockStart(true), finished(false) {
+  file = fopen(path.c_str(), "rb");
+  memset(&stream, 0, sizeof(z_stream));
+  if (Z_OK != inflateInit2(&stream, GZIP_WINDOW_BITS)) {
+    CkAbort("Error: failed to initialize decompression of %s\n", path.c_str());
+  }
+  setg(output.data(), output.data(), output.data());
+}
+
+GzipFileBuffer::~GzipFileBuffer() {
+  inflateEnd(&stream);
+  if (NULL != file) {
+    fclose(file);
+  }
+}
+
+bool GzipFileBuffer::isOpen() const {
+  return NULL != file;
+}
+
+const BlockIndex &GzipFileBuffer::getBlocks() const {
+  return blocks;
+}
+
+std::streambuf::int_type GzipFileBuffer::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  outputOffset += egptr() - eback();
+  if (finished || NULL == file) {
+    return traits_type::eof();
+  }
+
+  stream.next_out = reinterpret_cast<Bytef *>(output.data());
+  stream.avail_out = output.size();
+  while (output.size() == stream.avail_out && !finished) {
+    if (0 == stream.avail_in) {
+      std::size_t numRead = fread(input.data(), 1, input.size(), file);
+      if (0 == numRead) {
+        if (!atBlockStart) {
+          CkAbort("Error: %s is truncated\n", path.c_str());
+        }
+        blocks.push_back({numBytesRead, outputOffset});
+        finished = true;
+        break;
+      }
+      numBytesRead += numRead;
+      stream.next_in = reinterpret_cast<Bytef *>(input.data());
+      stream.avail_in = numRead;
+    }
+
+    if (atBlockStart) {
+      blocks.push_back({numBytesRead - stream.avail_in,
+        outputOffset + (output.size() - stream.avail_out)});
+      atBlockStart = false;
+    }
+    int result = inflate(&stream, Z_NO_FLUSH);
+    if (Z_STREAM_END == result) {
+      inflateReset(&stream);
+      atBlockStart = true;
+    } else if (Z_OK != result && Z_BUF_ERROR != result) {
+      CkAbort("Error: failed to decompress %s (%s)\n", path.c_str(),
+        NULL == stream.msg ? "unknown error" : stream.msg);
+    }
+  }
+
+  std::size_t numDecompressed = output.size() - stream.avail_out;
+  setg(output.data(), output.data(), output.data() + numDecompressed);
+  if (0 == numDecompressed) {
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(*gptr());
+}
+
+std::streambuf::pos_type GzipFileBuffer::seekoff(off_type offset,
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (std::ios_base::cur != dir || 0 != offset) {
+    return pos_type(off_type(-1));
+  }
+  return pos_type(outputOffset + (gptr() - eback()));
+}
+
+GzipFileStream::GzipFileStream(std::string path) :
+    std::istream(NULL), buffer(path) {
+  rdbuf(&buffer);
+  if (!buffer.isOpen()) {
+    setstate(std::ios_base::failbit);
+  }
+}
+
+const BlockIndex &GzipFileStream::getBlocks() const {
+  return buffer.getBlocks();
+}
+
+CompressedSliceBuffer::CompressedSliceBuffer(const char *data_,
+    const CompressedBlock *blocks_, std::size_t numBlocks_, CacheOffset begin) :
+    data(data_), blocks(blocks_), numBlocks(numBlocks_),
+    currentBlock(numBlocks_) {
+  memset(&stream, 0, sizeof(z_stream));
+  if (Z_OK != inflateInit2(&stream, GZIP_WINDOW_BITS)) {
+    CkAbort("Error: failed to initialize decompression\n");
+  }
+  setg(NULL, NULL, NULL);
+  if (0 < numBlocks) {
+    seekoff(begin, std::ios_base::beg, std::ios_base::in);
+  }
+}
+
+CompressedSliceBuffer::~CompressedSliceBuffer() {
+  inflateEnd(&stream);
+}
+
+void CompressedSliceBuffer::decompressBlock(std::size_t blockIdx) {
+  const CompressedBlock &block = blocks[blockIdx];
+  const CompressedBlock &next = blocks[blockIdx + 1];
+  output.resize(next.uncompressedOffset - block.uncompressedOffset);
+
+  inflateReset(&stream);
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data
+    + (block.compressedOffset - blocks[0].compressedOffset)));
+  stream.avail_in = next.compressedOffset - block.compressedOffset;
+  stream.next_out = reinterpret_cast<Bytef *>(output.data());
+  stream.avail_out = output.size();
+  if (Z_STREAM_END != inflate(&stream, Z_FINISH) || 0 != stream.avail_out) {
+    CkAbort("Error: failed to decompress block starting at byte %lu\n",
+      block.compressedOffset);
+  }
+
+  currentBlock = blockIdx;
+  setg(output.data(), output.data(), output.data() + output.size());
+}
+
+std::streambuf::int_type CompressedSliceBuffer::underflow() {
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  std::size_t nextBlock = numBlocks == currentBlock ? 0 : currentBlock + 1;
+  if (nextBlock >= numBlocks) {
+    return traits_type::eof();
+  }
+  decompressBlock(nextBlock);
+  return traits_type::to_int_type(*gptr());
+}
+
+std::streambuf::pos_type CompressedSliceBuffer::seekoff(off_type offset,
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (0 == numBlocks) {
+    return pos_type(off_type(-1));
+  }
+
+  CacheOffset pos;
+  if (std::ios_base::beg == dir) {
+    pos = offset;
+  } else if (std::ios_base::cur == dir) {
+    pos = numBlocks == currentBlock ? blocks[0].uncompressedOffset
+      : blocks[currentBlock].uncompressedOffset + (gptr() - eback());
+    pos += offset;
+  } else {
+    pos = blocks[numBlocks].uncompressedOffset + offset;
+  }
+  if (pos < blocks[0].uncompressedOffset
+      || pos > blocks[numBlocks].uncompressedOffset) {
+    return pos_type(off_type(-1));
+  }
+
+  // Seeking to the very end of the slice leaves us at the end of its last
+  // block, rather than at the start of a block we don't have
+  const CompressedBlock *found = std::upper_bound(blocks,
+    blocks + numBlocks, pos,
+    [](CacheOffset offset, const CompressedBlock &block) {
+      return offset < block.uncompressedOffset;
+    });
+  std::size_t blockIdx = (found - blocks) - 1;
+  if (blockIdx != currentBlock) {
+    decompressBlock(blockIdx);
+  }
+  setg(eback(), eback() + (pos - blocks[blockIdx].uncompressedOffset),
+    egptr());
+  return pos_type(pos);
+}
+
+std::streambuf::pos_type CompressedSliceBuffer::seekpos(pos_type pos,
+    std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
@@ -0,0 +1,119 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef READERS_COMPRESSION_H_
+#define READERS_COMPRESSION_H_
+
+#include "../Types.h"
+
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <zlib.h>
+
+#define COMPRESSED_INPUT_SUFFIX ".gz"
+#define BLOCK_INDEX_SUFFIX ".blocks"
+// Size of the buffers used when streaming through an entire compressed file
+#define DECOMPRESSION_BUFFER_SIZE (1 << 20)  // 1 MiB
+// Tells zlib to expect gzip (rather than raw zlib) headers
+#define GZIP_WINDOW_BITS (15 + 16)
+
+// Compressed inputs are expected to be a series of independently compressed
+// gzip members (as written by scripts/preprocessing/compress.py), each of
+// which can be decompressed without reading any of the preceding members.
+// Each block is described by where it starts in the compressed file and
+// where its contents start in the uncompressed input, so that the data
+// caches can keep using uncompressed byte offsets
+struct CompressedBlock {
+  CacheOffset compressedOffset;
+  CacheOffset uncompressedOffset;
+};
+
+// The blocks of a compressed input, in order, followed by a sentinel block
+// holding the compressed and uncompressed sizes of the input
+typedef std::vector<CompressedBlock> BlockIndex;
+
+// Returns path with COMPRESSED_INPUT_SUFFIX appended if only the compressed
+// version of the input exists, and path otherwise
+std::string resolveInputPath(std::string path);
+bool isCompressedInput(std::string path);
+std::string getBlockIndexPath(std::string inputPath, std::string cachePath);
+void buildBlockIndex(std::string inputPath, std::string indexPath);
+BlockIndex readBlockIndex(std::string indexPath);
+// Opens a (possibly compressed) input for sequential reading
+std::unique_ptr<std::istream> openInput(std::string path);
+
+// Decompresses an entire input file front to back, recording where each
+// block starts along the way. Only tellg() is supported, not seeking
+class GzipFileBuffer : public std::streambuf {
+ private:
+  std::string path;
+  FILE *file;
+  z_stream stream;
+  std::vector<char> input;
+  std::vector<char> output;
+  CacheOffset numBytesRead;
+  // Uncompressed offset of the start of the current get area
+  CacheOffset outputOffset;
+  bool atBlockStart;
+  bool finished;
+  BlockIndex blocks;
+
+ protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+    std::ios_base::openmode which) override;
+
+ public:
+  explicit GzipFileBuffer(std::string path);
+  ~GzipFileBuffer();
+  bool isOpen() const;
+  // Only complete once the whole file has been read
+  const BlockIndex &getBlocks() const;
+};
+
+class GzipFileStream : public std::istream {
+ private:
+  GzipFileBuffer buffer;
+
+ public:
+  explicit GzipFileStream(std::string path);
+  const BlockIndex &getBlocks() const;
+};
+
+// Random access to a run of blocks of a compressed input which has already
+// been read into memory. Blocks are only decompressed once they are read
+// from (one at a time), so each chare decompresses just the data it parses,
+// on its own PE, and never holds more than one decompressed block
+class CompressedSliceBuffer : public std::streambuf {
+ private:
+  // Compressed bytes, starting with the first block
+  const char *data;
+  // numBlocks blocks, plus the start of the block following them
+  const CompressedBlock *blocks;
+  std::size_t numBlocks;
+  std::size_t currentBlock;
+  std::vector<char> output;
+  z_stream stream;
+
+  void decompressBlock(std::size_t blockIdx);
+
+ protected:
+  int_type underflow() override;
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+    std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+ public:
+  CompressedSliceBuffer(const char *data, const CompressedBlock *blocks,
+    std::size_t numBlocks, CacheOffset begin);
+  ~CompressedSliceBuffer();
+};
+
+#endif  // READERS_COMPRESSION_H_
@@ -41,10 +41,16 @@ class DataInterface {
   union Data getValue(int idx) const;
   std::vector<union Data> &getData();
   void setSeed(int seed);
+  // Seeds replicateGenerator for one of several replicates of this entity
+  // (see Scenario::numReplicates)
+  void seedReplicate(std::default_random_engine *replicateGenerator, int seed,
+    int replicate) const;
   std::default_random_engine * getGenerator();
   void toggleCompliance(int interventionIndex, bool value);
   bool willComply(int interventionIndex);
   virtual void filterVisits(const void *cause, VisitTest keepVisit) = 0;
   virtual void restoreVisits(const void *cause) = 0;
+  // Returns the cause of each filter currently applied with filterVisits
+  virtual std::vector<const void *> getVisitFilters() const = 0;
 };
 #endif  // READERS_DATAINTERFACE_H_
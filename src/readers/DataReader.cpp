@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <string>
 #include <fstream>
+#include <istream>
 #include <tuple>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -33,7 +34,7 @@ void checkReadResult(int result, std::string path) {
   }
 }
 
-std::tuple<Id, Id, Time, Time> parseActivityStream(std::ifstream *input,
+std::tuple<Id, Id, Time, Time> parseActivityStream(std::istream *input,
     loimos::proto::CSVDefinition *dataFormat, std::vector<union Data> *attributes) {
   Id locationId = -1;
   Id personId = -1;
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <string>
 #include <fstream>
+#include <istream>
 #include <tuple>
 #include <fcntl.h>
 
@@ -32,7 +33,7 @@ int readProtobuf(std::string path, google::protobuf::Message *buffer);
  */
 void checkReadResult(int result, std::string path);
 
-std::tuple<Id, Id, Time, Time> parseActivityStream(std::ifstream *input,
+std::tuple<Id, Id, Time, Time> parseActivityStream(std::istream *input,
     loimos::proto::CSVDefinition *dataFormat, std::vector<union Data> *attributes);
 
 /**
@@ -41,7 +42,7 @@ std::tuple<Id, Id, Time, Time> parseActivityStream(std::ifstream *input,
  * code be defined in the .h file rather than in the .C.
  */
 template <class T = DataInterface>
-void readData(std::ifstream *input,
+void readData(std::istream *input,
     loimos::proto::CSVDefinition *dataFormat,
     std::vector<T> *dataObjs, Id totalObjs) {
   char buf[MAX_INPUT_lineLength];
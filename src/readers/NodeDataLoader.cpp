@@ -0,0 +1,487 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Collective, node-level loading of the population data. Rather than having
+ * every chare open the input files and caches and seek to its own data
+ * (which means hundreds of concurrent file handles on the same file on
+ * large nodes), one PE per node reads the union of the byte ranges needed
+ * by all of the chares on that node, using as few large reads as possible.
+ * Each chare then parses its own slice from memory on its own PE.
+ *
+ * For block-compressed inputs, the node reads the compressed blocks
+ * overlapping each slice, and each chare decompresses its blocks on demand
+ * as it parses them, so decompression is spread across all of the PEs on
+ * the node. On each PE, blocks are decompressed in between parsing them,
+ * rather than alongside it.
+ *
+ * When visit schedules are paged in one day at a time, the visits file is
+ * instead mapped into memory, so that it is only read in as needed and
+ * never has to be held in memory in full.
+ */
+
+#include "NodeDataLoader.h"
+#include "Compression.h"
+#include "Preprocess.h"
+#include "../Defs.h"
+#include "../Types.h"
+#include "../Partitioner.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Number of visit cache entries to read at a time when searching for the
+// end of a partition's visits
+#define VISIT_SCAN_BLOCK_SIZE 4096
+
+FileSliceBuffer::FileSliceBuffer(const FileSlice &slice) : begin(slice.begin) {
+  char *data = const_cast<char *>(slice.data);
+  setg(data, data, data + (slice.end - slice.begin));
+}
+
+std::streambuf::pos_type FileSliceBuffer::seekoff(off_type offset,
+    std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type pos;
+  if (std::ios_base::beg == dir) {
+    pos = offset - begin;
+  } else if (std::ios_base::cur == dir) {
+    pos = (gptr() - eback()) + offset;
+  } else {
+    pos = (egptr() - eback()) + offset;
+  }
+
+  if (0 > pos || egptr() - eback() < pos) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos + begin);
+}
+
+std::streambuf::pos_type FileSliceBuffer::seekpos(pos_type pos,
+    std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+FileSliceStream::FileSliceStream(const FileSlice &slice) :
+    std::istream(NULL) {
+  if (NULL == slice.blocks) {
+    buffer.reset(new FileSliceBuffer(slice));
+  } else {
+    buffer.reset(new CompressedSliceBuffer(slice.data, slice.blocks,
+      slice.numBlocks, slice.begin));
+  }
+  rdbuf(buffer.get());
+}
+
+NodeDataLoader::NodeDataLoader(std::string scenarioPath_, std::string cachePath_,
+    std::string scenarioId_, int numDays_, const Partitioner *partitioner_,
+    bool pageVisits_) :
+    scenarioPath(scenarioPath_), cachePath(cachePath_),
+    scenarioId(scenarioId_), numDays(numDays_), partitioner(partitioner_),
+    pageVisits(pageVisits_), numPendingSlices(0) {}
+
+void NodeDataLoader::load(const std::vector<PartitionId> &personPartitions,
+    const std::vector<PartitionId> &locationPartitions) {
+  double startTime = CkWallTimer();
+  numPendingSlices = personPartitions.size() + locationPartitions.size();
+  std::string peoplePath = resolveInputPath(scenarioPath + "people.csv");
+  std::string locationsPath = resolveInputPath(scenarioPath + "locations.csv");
+  std::string visitsPath = resolveInputPath(scenarioPath + "visits.csv");
+
+  // Find which bytes of the people and locations files we need...
+  PartitionId numPersonPartitions = partitioner->personPartitionOffsets.size();
+  std::vector<CacheOffset> offsets = readObjectOffsets(
+    cachePath + scenarioId + "_people.cache", numPersonPartitions,
+    getInputSize(peoplePath));
+  for (PartitionId p : personPartitions) {
+    personSlices[p] = FileSlice(NULL, offsets[p], offsets[p + 1]);
+  }
+
+  PartitionId numLocationPartitions =
+    partitioner->locationPartitionOffsets.size();
+  offsets = readObjectOffsets(cachePath + scenarioId + "_locations.cache",
+    numLocationPartitions, getInputSize(locationsPath));
+  for (PartitionId p : locationPartitions) {
+    locationSlices[p] = FileSlice(NULL, offsets[p], offsets[p + 1]);
+  }
+  CacheOffset visitsSize = getInputSize(visitsPath);
+  readVisitOffsets(locationPartitions, visitsSize, &visitSlices);
+
+  // ...and then read them in
+  readSlices(peoplePath, &personSlices);
+  readSlices(locationsPath, &locationSlices);
+  if (pageVisits) {
+    mapVisitFile(visitsPath, visitsSize);
+  } else {
+    readSlices(visitsPath, &visitSlices);
+  }
+
+#if ENABLE_DEBUG >= DEBUG_PER_CHARE
+  CkPrintf("  Node %d read data for %lu person and %lu location partitions"
+    " in %f s\n", CkMyNode(), personPartitions.size(),
+    locationPartitions.size(), CkWallTimer() - startTime);
+#endif
+}
+
+/**
+ * Returns the (uncompressed) size of the input at inputPath, first loading
+ * its block index if it is compressed
+ */
+CacheOffset NodeDataLoader::getInputSize(std::string inputPath) {
+  if (isCompressedInput(inputPath)) {
+    BlockIndex &blocks = blockIndices[inputPath];
+    blocks = readBlockIndex(getBlockIndexPath(inputPath, cachePath));
+    return blocks.back().uncompressedOffset;
+  }
+
+  struct stat inputStat;
+  if (0 != stat(inputPath.c_str(), &inputStat)) {
+    CkAbort("Error: unable to stat %s\n", inputPath.c_str());
+  }
+  return inputStat.st_size;
+}
+
+/**
+ * Returns the starting byte offset of each partition in the object cache at
+ * path, followed by the size of the corresponding input file (so that the
+ * end of partition p is always the p+1-th entry)
+ */
+std::vector<CacheOffset> NodeDataLoader::readObjectOffsets(std::string path,
+    PartitionId numPartitions, CacheOffset inputSize) const {
+  std::vector<CacheOffset> offsets(numPartitions + 1);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (0 > fd) {
+    CkAbort("Error: unable to read cache %s\n", path.c_str());
+  }
+
+  ssize_t size = numPartitions * sizeof(CacheOffset);
+  if (size != pread(fd, offsets.data(), size, getCacheEntryOffset(0))) {
+    CkAbort("Error: cache %s is truncated\n", path.c_str());
+  }
+  close(fd);
+
+  offsets[numPartitions] = inputSize;
+  return offsets;
+}
+
+/**
+ * Reads the visit cache entries for each location in partitions, and
+ * uses them to find the range of bytes of the visits file containing the
+ * visits to those locations. This relies on visits being sorted by
+ * location, as they are by the preprocessing scripts, and aborts if they
+ * aren't
+ */
+void NodeDataLoader::readVisitOffsets(const std::vector<PartitionId> &partitions,
+    CacheOffset inputSize, std::unordered_map<PartitionId, FileSlice> *ranges) {
+  std::string path = cachePath + scenarioId + "_visits.cache";
+  int fd = open(path.c_str(), O_RDONLY);
+  if (0 > fd) {
+    CkAbort("Error: unable to read cache %s\n", path.c_str());
+  }
+  for (PartitionId p : partitions) {
+    Id firstIdx = partitioner->getGlobalLocationIndex(0, p);
+    CacheOffset firstEntry = numDays
+      * partitioner->getLocationCacheIndex(firstIdx);
+    CacheOffset numLocalEntries = numDays
+      * partitioner->getLocationPartitionSize(p);
+
+    std::vector<CacheOffset> &local = visitOffsets[p];
+    local.resize(numLocalEntries);
+    ssize_t size = numLocalEntries * sizeof(CacheOffset);
+    if (size != pread(fd, local.data(), size,
+        getCacheEntryOffset(firstEntry))) {
+      CkAbort("Error: cache %s is truncated\n", path.c_str());
+    }
+
+    // Since visits are sorted by location (and then by day), each
+    // non-empty entry should start after the one before it
+    CacheOffset begin = EMPTY_VISIT_SCHEDULE;
+    CacheOffset last = EMPTY_VISIT_SCHEDULE;
+    for (CacheOffset offset : local) {
+      if (EMPTY_VISIT_SCHEDULE == offset) {
+        continue;
+      } else if (EMPTY_VISIT_SCHEDULE == begin) {
+        begin = offset;
+      } else if (offset <= last) {
+        CkAbort("Error: visits are not sorted by location (see %s)\n",
+          path.c_str());
+      }
+      last = offset;
+    }
+    if (EMPTY_VISIT_SCHEDULE == begin) {
+      (*ranges)[p] = FileSlice(NULL, 0, 0);
+      continue;
+    }
+
+    CacheOffset end = findVisitsEnd(fd, path, firstEntry + numLocalEntries,
+      inputSize);
+    if (end <= last) {
+      CkAbort("Error: visits are not sorted by location (see %s)\n",
+        path.c_str());
+    }
+    (*ranges)[p] = FileSlice(NULL, begin, end);
+  }
+  close(fd);
+}
+
+/**
+ * Returns where the visits before the given entry of the visit cache (open
+ * as fd) end, which is where the next non-empty day's visits (which may
+ * belong to a later partition) begin, or the end of the visits file
+ */
+CacheOffset NodeDataLoader::findVisitsEnd(int fd, const std::string &path,
+    CacheOffset entry, CacheOffset inputSize) const {
+  CacheOffset numEntries = partitioner->numLocations * numDays;
+  std::vector<CacheOffset> buf(VISIT_SCAN_BLOCK_SIZE);
+  while (entry < numEntries) {
+    CacheOffset numToRead = std::min(static_cast<CacheOffset>(buf.size()),
+      numEntries - entry);
+    ssize_t size = numToRead * sizeof(CacheOffset);
+    if (size != pread(fd, buf.data(), size, getCacheEntryOffset(entry))) {
+      CkAbort("Error: cache %s is truncated\n", path.c_str());
+    }
+    for (CacheOffset i = 0; i < numToRead; ++i) {
+      if (EMPTY_VISIT_SCHEDULE != buf[i]) {
+        return buf[i];
+      }
+    }
+    entry += numToRead;
+  }
+  return inputSize;
+}
+
+/**
+ * Reads the byte range of each slice from the file at path, merging
+ * adjacent or overlapping ranges so that each contiguous run of bytes
+ * is read with a single large read. For compressed inputs, this reads
+ * every block overlapping each slice instead
+ */
+void NodeDataLoader::readSlices(std::string path,
+    std::unordered_map<PartitionId, FileSlice> *slices) {
+  auto found = blockIndices.find(path);
+  const BlockIndex *blocks = blockIndices.end() == found ?
+    NULL : &found->second;
+
+  // Each entry is the range of bytes of the file needed by a slice
+  std::vector<std::tuple<CacheOffset, CacheOffset, FileSlice *> > sorted;
+  for (auto &entry : *slices) {
+    FileSlice &slice = entry.second;
+    if (slice.begin == slice.end) {
+      continue;
+    }
+    if (NULL == blocks) {
+      sorted.emplace_back(slice.begin, slice.end, &slice);
+      continue;
+    }
+
+    auto first = std::upper_bound(blocks->begin(), blocks->end(),
+      slice.begin, [](CacheOffset offset, const CompressedBlock &block) {
+        return offset < block.uncompressedOffset;
+      }) - 1;
+    auto last = std::lower_bound(first, blocks->end(), slice.end,
+      [](const CompressedBlock &block, CacheOffset offset) {
+        return block.uncompressedOffset < offset;
+      });
+    slice.blocks = &*first;
+    slice.numBlocks = last - first;
+    sorted.emplace_back(first->compressedOffset, last->compressedOffset,
+      &slice);
+  }
+  if (sorted.empty()) {
+    return;
+  }
+  std::sort(sorted.begin(), sorted.end());
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (0 > fd) {
+    CkAbort("Error: unable to read %s\n", path.c_str());
+  }
+
+  size_t runStart = 0;
+  while (runStart < sorted.size()) {
+    CacheOffset begin = std::get<0>(sorted[runStart]);
+    CacheOffset end = std::get<1>(sorted[runStart]);
+    size_t runEnd = runStart + 1;
+    while (runEnd < sorted.size() && std::get<0>(sorted[runEnd]) <= end) {
+      end = std::max(end, std::get<1>(sorted[runEnd]));
+      runEnd++;
+    }
+
+    buffers.emplace_back(end - begin);
+    std::vector<char> &buffer = buffers.back();
+    CacheOffset numRead = 0;
+    while (numRead < buffer.size()) {
+      size_t size = std::min(static_cast<CacheOffset>(MAX_READ_SIZE),
+        buffer.size() - numRead);
+      ssize_t result = pread(fd, buffer.data() + numRead, size,
+        begin + numRead);
+      if (0 >= result) {
+        CkAbort("Error: failed to read bytes %lu-%lu of %s\n",
+          begin + numRead, end, path.c_str());
+      }
+      numRead += result;
+    }
+
+    for (size_t i = runStart; i < runEnd; ++i) {
+      std::get<2>(sorted[i])->data = buffer.data()
+        + (std::get<0>(sorted[i]) - begin);
+    }
+    runStart = runEnd;
+  }
+  close(fd);
+}
+
+void NodeDataLoader::mapVisits() {
+  std::string visitsPath = resolveInputPath(scenarioPath + "visits.csv");
+  mapVisitFile(visitsPath, getInputSize(visitsPath));
+}
+
+/**
+ * Returns the headers of the people, locations and visits caches back to
+ * back, so that anything built from the caches can tell if they've changed
+ */
+std::string NodeDataLoader::getCacheHeaders() const {
+  std::string headers;
+  for (const char *suffix : {"_people.cache", "_locations.cache",
+      "_visits.cache"}) {
+    std::ifstream cache(cachePath + scenarioId + suffix,
+      std::ios_base::binary);
+    char header[sizeof(CacheHeader)] = {};
+    cache.read(header, sizeof(CacheHeader));
+    headers.append(header, sizeof(CacheHeader));
+  }
+  return headers;
+}
+
+void NodeDataLoader::mapVisitFile(std::string path, CacheOffset inputSize) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat fileStat;
+  if (0 > fd || 0 != fstat(fd, &fileStat)) {
+    CkAbort("Error: unable to read %s\n", path.c_str());
+  }
+  void *data = NULL;
+  if (0 < fileStat.st_size) {
+    data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == data) {
+      CkAbort("Error: unable to map %s\n", path.c_str());
+    }
+  }
+  close(fd);
+
+  visitFile = FileSlice(reinterpret_cast<const char *>(data), 0, inputSize);
+  auto found = blockIndices.find(path);
+  if (blockIndices.end() != found) {
+    visitFileBlocks = found->second;
+    visitFile.blocks = visitFileBlocks.data();
+    visitFile.numBlocks = visitFileBlocks.size() - 1;
+  }
+}
+
+const FileSlice &NodeDataLoader::getVisitFile() const {
+  return visitFile;
+}
+
+void NodeDataLoader::prefetchVisits(CacheOffset begin, CacheOffset end) const {
+  if (NULL == visitFile.data || begin >= end) {
+    return;
+  }
+
+  // Translate to offsets in the compressed file, if need be
+  if (NULL != visitFile.blocks) {
+    const CompressedBlock *blocksEnd = visitFile.blocks + visitFile.numBlocks;
+    const CompressedBlock *first = std::upper_bound(visitFile.blocks,
+      blocksEnd, begin, [](CacheOffset offset, const CompressedBlock &block) {
+        return offset < block.uncompressedOffset;
+      }) - 1;
+    const CompressedBlock *last = std::lower_bound(first, blocksEnd, end,
+      [](const CompressedBlock &block, CacheOffset offset) {
+        return block.uncompressedOffset < offset;
+      });
+    begin = first->compressedOffset;
+    end = last->compressedOffset;
+  }
+
+  CacheOffset pageSize = sysconf(_SC_PAGESIZE);
+  CacheOffset alignedBegin = begin - begin % pageSize;
+  madvise(const_cast<char *>(visitFile.data) + alignedBegin,
+    end - alignedBegin, MADV_WILLNEED);
+}
+
+const FileSlice &NodeDataLoader::getPersonSlice(PartitionId partitionIdx) const {
+  return personSlices.at(partitionIdx);
+}
+
+const FileSlice &NodeDataLoader::getLocationSlice(
+    PartitionId partitionIdx) const {
+  return locationSlices.at(partitionIdx);
+}
+
+const FileSlice &NodeDataLoader::getVisitSlice(PartitionId partitionIdx) const {
+  return visitSlices.at(partitionIdx);
+}
+
+const std::vector<CacheOffset> &NodeDataLoader::getVisitOffsets(
+    PartitionId partitionIdx) const {
+  return visitOffsets.at(partitionIdx);
+}
+
+std::vector<CacheOffset> NodeDataLoader::loadVisitOffsets(
+    PartitionId partitionIdx) const {
+  std::string path = cachePath + scenarioId + "_visits.cache";
+  int fd = open(path.c_str(), O_RDONLY);
+  if (0 > fd) {
+    CkAbort("Error: unable to read cache %s\n", path.c_str());
+  }
+
+  Id firstIdx = partitioner->getGlobalLocationIndex(0, partitionIdx);
+  CacheOffset firstEntry = numDays
+    * partitioner->getLocationCacheIndex(firstIdx);
+  std::vector<CacheOffset> offsets(numDays
+    * partitioner->getLocationPartitionSize(partitionIdx));
+  ssize_t size = offsets.size() * sizeof(CacheOffset);
+  if (size != pread(fd, offsets.data(), size,
+      getCacheEntryOffset(firstEntry))) {
+    CkAbort("Error: cache %s is truncated\n", path.c_str());
+  }
+  close(fd);
+  return offsets;
+}
+
+CacheOffset NodeDataLoader::loadVisitsEnd(PartitionId partitionIdx) const {
+  std::string path = cachePath + scenarioId + "_visits.cache";
+  int fd = open(path.c_str(), O_RDONLY);
+  if (0 > fd) {
+    CkAbort("Error: unable to read cache %s\n", path.c_str());
+  }
+
+  Id firstIdx = partitioner->getGlobalLocationIndex(0, partitionIdx);
+  CacheOffset nextEntry = numDays * (partitioner->getLocationCacheIndex(
+    firstIdx) + partitioner->getLocationPartitionSize(partitionIdx));
+  CacheOffset end = findVisitsEnd(fd, path, nextEntry, visitFile.end);
+  close(fd);
+  return end;
+}
+
+void NodeDataLoader::releaseSlices() {
+  if (0 == --numPendingSlices) {
+    buffers.clear();
+    buffers.shrink_to_fit();
+    personSlices.clear();
+    locationSlices.clear();
+    visitSlices.clear();
+    visitOffsets.clear();
+    blockIndices.clear();
+  }
+}
@@ -0,0 +1,139 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef READERS_NODEDATALOADER_H_
+#define READERS_NODEDATALOADER_H_
+
+#include "Compression.h"
+#include "../Types.h"
+#include "../Partitioner.h"
+
+#include <atomic>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reads of more than this many bytes are split into several calls to pread
+#define MAX_READ_SIZE (1 << 30)  // 1 GiB
+
+// A window onto a range of bytes of an input file which has already been
+// read into memory. begin and end are offsets into the original file, so
+// that offsets from the data caches can be used without translation. For
+// compressed inputs, these are offsets into the uncompressed data, and data
+// holds the compressed blocks containing that range
+struct FileSlice {
+  const char *data;
+  CacheOffset begin;
+  CacheOffset end;
+  const CompressedBlock *blocks;
+  std::size_t numBlocks;
+
+  FileSlice() : data(NULL), begin(0), end(0), blocks(NULL), numBlocks(0) {}
+  FileSlice(const char *data_, CacheOffset begin_, CacheOffset end_) :
+    data(data_), begin(begin_), end(end_), blocks(NULL), numBlocks(0) {}
+};
+
+// Lets the existing stream-based readers parse a FileSlice without copying
+class FileSliceBuffer : public std::streambuf {
+ private:
+  CacheOffset begin;
+
+ protected:
+  pos_type seekoff(off_type offset, std::ios_base::seekdir dir,
+    std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+ public:
+  explicit FileSliceBuffer(const FileSlice &slice);
+};
+
+class FileSliceStream : public std::istream {
+ private:
+  std::unique_ptr<std::streambuf> buffer;
+
+ public:
+  explicit FileSliceStream(const FileSlice &slice);
+};
+
+// Reads each of the population input files once per node, rather than once
+// per chare, and hands each chare on this node its slice in memory. Chares
+// then parse their slices in parallel on their own PEs
+class NodeDataLoader {
+ private:
+  std::string scenarioPath;
+  std::string cachePath;
+  std::string scenarioId;
+  int numDays;
+  const Partitioner *partitioner;
+  bool pageVisits;
+
+  // Each buffer holds one contiguous run of bytes read from an input file
+  std::vector<std::vector<char> > buffers;
+  std::unordered_map<PartitionId, FileSlice> personSlices;
+  std::unordered_map<PartitionId, FileSlice> locationSlices;
+  std::unordered_map<PartitionId, FileSlice> visitSlices;
+  std::unordered_map<PartitionId, std::vector<CacheOffset> > visitOffsets;
+  // Keyed by input path; only present for compressed inputs
+  std::unordered_map<std::string, BlockIndex> blockIndices;
+  std::atomic<int> numPendingSlices;
+
+  // When paging visits, the whole visits file is mapped into memory for
+  // the length of the run instead of being read in up front
+  FileSlice visitFile;
+  BlockIndex visitFileBlocks;
+
+  CacheOffset getInputSize(std::string inputPath);
+  std::vector<CacheOffset> readObjectOffsets(std::string path,
+    PartitionId numPartitions, CacheOffset inputSize) const;
+  void readVisitOffsets(const std::vector<PartitionId> &partitions,
+    CacheOffset inputSize, std::unordered_map<PartitionId, FileSlice> *ranges);
+  CacheOffset findVisitsEnd(int fd, const std::string &path,
+    CacheOffset entry, CacheOffset inputSize) const;
+  void readSlices(std::string path,
+    std::unordered_map<PartitionId, FileSlice> *slices);
+  void mapVisitFile(std::string path, CacheOffset inputSize);
+
+ public:
+  NodeDataLoader(std::string scenarioPath, std::string cachePath,
+    std::string scenarioId, int numDays, const Partitioner *partitioner,
+    bool pageVisits);
+  // Reads every slice needed by the specified person and location
+  // partitions, which should be those resident on this node
+  void load(const std::vector<PartitionId> &personPartitions,
+    const std::vector<PartitionId> &locationPartitions);
+  const FileSlice &getPersonSlice(PartitionId partitionIdx) const;
+  const FileSlice &getLocationSlice(PartitionId partitionIdx) const;
+  const FileSlice &getVisitSlice(PartitionId partitionIdx) const;
+  // Returns the visit cache entries (one per day per location) for each
+  // location in the specified partition
+  const std::vector<CacheOffset> &getVisitOffsets(
+    PartitionId partitionIdx) const;
+  // Reads the same entries as getVisitOffsets from the visits cache, for
+  // chares which need them after the loaded slices have been released
+  // (e.g. after migrating)
+  std::vector<CacheOffset> loadVisitOffsets(PartitionId partitionIdx) const;
+  // Returns where the visits to the specified partition's locations end in
+  // the visits file; only available when paging visits
+  CacheOffset loadVisitsEnd(PartitionId partitionIdx) const;
+  // Maps the visits file for paging without reading in any slices (e.g.
+  // when chares are restored from a snapshot instead of loading)
+  void mapVisits();
+  // Returns the headers of the caches, which change whenever they're rebuilt
+  std::string getCacheHeaders() const;
+  // Only available when paging visits; remains valid for the whole run
+  const FileSlice &getVisitFile() const;
+  // Asks the OS to start reading in the given range of the visits file in
+  // the background (with madvise), ahead of it being paged in
+  void prefetchVisits(CacheOffset begin, CacheOffset end) const;
+  // Should be called once by each chare after parsing its slices; the
+  // buffers are freed once every chare on this node is done with them
+  void releaseSlices();
+};
+
+#endif  // READERS_NODEDATALOADER_H_
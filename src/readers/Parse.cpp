@@ -6,12 +6,17 @@
 
 #include "Parse.h"
 #include "Preprocess.h"
+#include "../Defs.h"
 #include "../Types.h"
 #include "../contact_model/ContactModel.h"
+#include "../VisitGenerator.h"
+#include "../Analytics.h"
+#include "../TimingReport.h"
 #include "charm++.h"
 
 #include <vector>
 #include <string>
+#include <sstream>
 #include <cstdlib>
 #include <cstdio>
 #include <sys/time.h>
@@ -119,6 +124,25 @@ void parse(int argc, char **argv, Arguments *args) {
   // Optional arguments
   args->contactModelType = static_cast<int>(ContactModelType::constant_probability);
   args->hasIntervention = false;
+  args->pageVisits = false;
+  args->lazyVisits = false;
+  args->collectiveOutput = false;
+  args->analyticsFlags = 0;
+  args->timingReport = false;
+  args->numSlowestLocations = TIMING_REPORT_NUM_SLOWEST;
+  args->sampleRate = 1.0;
+  args->multilevelPartition = false;
+  args->remapIds = false;
+  args->colocateChares = false;
+  args->useStartupSnapshot = false;
+  args->numReplicates = 1;
+  args->lbStartDay = LB_START_DAY;
+  args->lbInterval = LB_INTERVAL;
+  args->lbThreshold = LB_IMBALANCE_THRESHOLD;
+  args->checkpointInterval = CHECKPOINT_INTERVAL;
+  args->onTheFly.generatorType = static_cast<int>(VisitGeneratorType::grid);
+  args->onTheFly.locationSizeExponent = 0.0;
+  args->onTheFly.householdSize = HOUSEHOLD_SIZE;
   args->transmissibility = -1.0;
   for (; argNum < argc; ++argNum) {
     std::string tmp = std::string(argv[argNum]);
@@ -145,8 +169,160 @@ void parse(int argc, char **argv, Arguments *args) {
       args->partitionsToOffsetsRatio = atol(argv[++argNum]);
     } else if (("-t" == tmp || "--transmissibility" == tmp)
         && argNum + 1 < argc) {
-      args->transmissibility = atof(argv[++argNum]);
+      // A comma-separated list gives one replicate per transmissibility
+      std::stringstream values(argv[++argNum]);
+      std::string value;
+      args->replicateTransmissibilities.clear();
+      while (std::getline(values, value, ',')) {
+        args->replicateTransmissibilities.push_back(atof(value.c_str()));
+      }
+      if (args->replicateTransmissibilities.empty()) {
+        CkAbort("Error: no transmissibility given\n");
+      }
+      args->transmissibility = args->replicateTransmissibilities[0];
+    } else if (("-c" == tmp || "--cache-dir" == tmp)
+        && argNum + 1 < argc) {
+      args->cachePath = std::string(argv[++argNum]);
+    } else if ("-pv" == tmp || "--page-visits" == tmp) {
+      args->pageVisits = true;
+    } else if ("-lv" == tmp || "--lazy-visits" == tmp) {
+      args->lazyVisits = true;
+    } else if (("-pl" == tmp || "--power-law" == tmp) && argNum + 1 < argc) {
+      args->onTheFly.generatorType =
+        static_cast<int>(VisitGeneratorType::power_law);
+      args->onTheFly.locationSizeExponent = atof(argv[++argNum]);
+      if (0.0 > args->onTheFly.locationSizeExponent) {
+        CkAbort("Error: location size exponent must be non-negative, not %f\n",
+          args->onTheFly.locationSizeExponent);
+      }
+    } else if (("-hs" == tmp || "--household-size" == tmp)
+        && argNum + 1 < argc) {
+      args->onTheFly.householdSize = atof(argv[++argNum]);
+      if (1.0 > args->onTheFly.householdSize) {
+        CkAbort("Error: average household size must be at least 1, not %f\n",
+          args->onTheFly.householdSize);
+      }
+    } else if ("-co" == tmp || "--collective-output" == tmp) {
+      args->collectiveOutput = true;
+    } else if (("-an" == tmp || "--analytics" == tmp) && argNum + 1 < argc) {
+      args->analyticsFlags = parseAnalyticsFlags(argv[++argNum]);
+    } else if ("-tr" == tmp || "--timing-report" == tmp) {
+      args->timingReport = true;
+      if (argNum + 1 < argc && argv[argNum + 1][0] != '-'
+          && argv[argNum + 1][0] != '+') {
+        args->numSlowestLocations = atoi(argv[++argNum]);
+      }
+    } else if (("-sr" == tmp || "--sample-rate" == tmp) && argNum + 1 < argc) {
+      args->sampleRate = atof(argv[++argNum]);
+      if (0.0 >= args->sampleRate || 1.0 < args->sampleRate) {
+        CkAbort("Error: sample rate must be in (0, 1], not %f\n",
+          args->sampleRate);
+      }
+    } else if ("-mp" == tmp || "--multilevel-partition" == tmp) {
+      args->multilevelPartition = true;
+    } else if ("-ri" == tmp || "--remap-ids" == tmp) {
+      args->remapIds = true;
+    } else if ("-cc" == tmp || "--colocate-chares" == tmp) {
+      args->colocateChares = true;
+    } else if ("-ss" == tmp || "--startup-snapshot" == tmp) {
+      args->useStartupSnapshot = true;
+    } else if (("-r" == tmp || "--replicates" == tmp) && argNum + 1 < argc) {
+      args->numReplicates = atoi(argv[++argNum]);
+      if (0 >= args->numReplicates) {
+        CkAbort("Error: number of replicates must be positive, not %d\n",
+          args->numReplicates);
+      }
+    } else if (("-lbs" == tmp || "--lb-start" == tmp) && argNum + 1 < argc) {
+      args->lbStartDay = atoi(argv[++argNum]);
+    } else if (("-lbi" == tmp || "--lb-interval" == tmp)
+        && argNum + 1 < argc) {
+      args->lbInterval = atoi(argv[++argNum]);
+      if (0 >= args->lbInterval) {
+        CkAbort("Error: load balancing interval must be positive, not %d\n",
+          args->lbInterval);
+      }
+    } else if (("-lbt" == tmp || "--lb-threshold" == tmp)
+        && argNum + 1 < argc) {
+      args->lbThreshold = atof(argv[++argNum]);
+    } else if (("-cp" == tmp || "--checkpoint" == tmp) && argNum + 1 < argc) {
+      args->checkpointPath = std::string(argv[++argNum]);
+    } else if (("-cpi" == tmp || "--checkpoint-interval" == tmp)
+        && argNum + 1 < argc) {
+      args->checkpointInterval = atoi(argv[++argNum]);
+      if (0 >= args->checkpointInterval) {
+        CkAbort("Error: checkpoint interval must be positive, not %d\n",
+          args->checkpointInterval);
+      }
+    } else if (("-rs" == tmp || "--restart" == tmp) && argNum + 1 < argc) {
+      args->restartPath = std::string(argv[++argNum]);
+    }
+  }
+
+  // Power-law populations follow a weekly routine, and let anyone visit
+  // anywhere, so a Locations chare can't find its visitors on its own
+  if (static_cast<int>(VisitGeneratorType::power_law)
+      == args->onTheFly.generatorType) {
+    if (!args->isOnTheFlyRun) {
+      CkAbort("Error: power-law populations can only be generated "
+        "on-the-fly\n");
+    } else if (args->lazyVisits) {
+      CkAbort("Error: power-law visits can't be generated lazily\n");
+    }
+    args->numDaysWithDistinctVisits = DAYS_IN_WEEK;
+  }
+
+  // Lazily generated visits are never gathered in one place, so there's no
+  // record of which chares exchange the most of them
+  if (args->lazyVisits && args->colocateChares) {
+    CkAbort("Error: chares can't be colocated when visits are generated "
+      "lazily\n");
+  }
+
+  // Unless told otherwise, run one replicate per transmissibility
+  int numTransmissibilities = args->replicateTransmissibilities.size();
+  if (1 == numTransmissibilities) {
+    args->replicateTransmissibilities.clear();
+  } else if (1 < numTransmissibilities) {
+    if (1 == args->numReplicates) {
+      args->numReplicates = numTransmissibilities;
+    } else if (numTransmissibilities != args->numReplicates) {
+      CkAbort("Error: given %d transmissibilities for %d replicates\n",
+        numTransmissibilities, args->numReplicates);
+    }
+  }
+  if (MAX_REPLICATES < args->numReplicates) {
+    CkAbort("Error: at most %d replicates can be run at once, not %d\n",
+      MAX_REPLICATES, args->numReplicates);
+  }
+
+  // Replicates share everything but their disease states, so anything which
+  // depends on each replicate's outbreak or writes per-person output would
+  // need its own copy for each of them
+  if (1 < args->numReplicates) {
+#ifdef OUTPUT_FLAGS
+    CkAbort("Error: replicates aren't supported when writing detailed output\n");
+#endif
+    // Interventions change people's attributes and filter the visit
+    // schedules, which all replicates share, and are triggered by a single
+    // set of case counts. Supporting them (and so sweeps over compliance)
+    // would take a ReplicateMask per intervention for compliance, triggers
+    // per replicate, and visits masked out of the replicates filtering them
+    if (args->hasIntervention) {
+      CkAbort("Error: replicates aren't supported with interventions, so "
+        "compliance sweeps need a separate run for each value\n");
+    }
+  }
+
+  // Caches are saved alongside the population data unless we were pointed
+  // elsewhere (e.g. because the population directory is read-only)
+  if (args->cachePath.empty()) {
+    args->cachePath = args->scenarioPath;
+  } else if (!args->isOnTheFlyRun) {
+    if (args->cachePath.back() == '/') {
+      args->cachePath.pop_back();
     }
+    createDirectory(args->cachePath, args->scenarioPath);
+    args->cachePath.push_back('/');
   }
 
 #if ENABLE_DEBUG
@@ -157,6 +333,7 @@ void parse(int argc, char **argv, Arguments *args) {
   }
   if (!args->isOnTheFlyRun) {
     CkPrintf("Loading people and locations from %s.\n", args->scenarioPath.c_str());
+    CkPrintf("Saving data caches to %s.\n", args->cachePath.c_str());
   }
 #endif
 
@@ -11,6 +11,7 @@
 #include "pup_stl.h"
 
 #include <string>
+#include <vector>
 
 struct OnTheFlyArguments {
   Grid<Id> personGrid;
@@ -19,6 +20,12 @@ struct OnTheFlyArguments {
   Grid<Id> localLocationGrid;
 
   double averageVisitsPerDay;
+
+  // Which VisitGenerator to use, along with the settings only used by the
+  // power-law generator
+  int generatorType;
+  double locationSizeExponent;
+  double householdSize;
 };
 PUPbytes(OnTheFlyArguments);
 
@@ -32,14 +39,47 @@ struct Arguments {
   Time numDaysWithDistinctVisits;
   Time numDaysToSeedOutbreak;
   double transmissibility;
+  // If given a list of transmissibilities, each replicate uses its own
+  std::vector<double> replicateTransmissibilities;
   int seed;
 
   bool hasIntervention;
   int contactModelType;
+  bool pageVisits;
+  bool lazyVisits;
+  bool collectiveOutput;
+  int analyticsFlags;
+  // Whether to report summaries of each chare's timings each day, and how
+  // many of the slowest locations to include
+  bool timingReport;
+  int numSlowestLocations;
+  // Fraction of exposures and overlaps to write out
+  double sampleRate;
+  // Renumber people and locations to keep visits within partitions
+  bool multilevelPartition;
+  // Replace sparse person and location ids with dense ones before loading
+  bool remapIds;
+  bool colocateChares;
+  // Save (or start from) a snapshot of every chare right after startup
+  bool useStartupSnapshot;
+  // How many independent replicates of the simulation to run on the same
+  // population at once
+  int numReplicates;
+  // When to check whether to load balance, and how imbalanced the predicted
+  // loads must be for us to go through with it
+  int lbStartDay;
+  int lbInterval;
+  double lbThreshold;
+  // Where to save checkpoints and how often, and which checkpoint (if any)
+  // to restart from
+  int checkpointInterval;
+  std::string checkpointPath;
+  std::string restartPath;
 
   std::string diseasePath;
   std::string interventionPath;
   std::string outputPath;
+  std::string cachePath;
 
   bool isOnTheFlyRun;
   struct OnTheFlyArguments onTheFly;
@@ -57,12 +97,32 @@ struct Arguments {
     p | numInitialInfectionsPerDay;
     p | partitionsToOffsetsRatio;
     p | transmissibility;
+    p | replicateTransmissibilities;
     p | seed;
     p | hasIntervention;
     p | contactModelType;
+    p | pageVisits;
+    p | lazyVisits;
+    p | collectiveOutput;
+    p | analyticsFlags;
+    p | timingReport;
+    p | numSlowestLocations;
+    p | sampleRate;
+    p | multilevelPartition;
+    p | remapIds;
+    p | colocateChares;
+    p | useStartupSnapshot;
+    p | numReplicates;
+    p | lbStartDay;
+    p | lbInterval;
+    p | lbThreshold;
+    p | checkpointInterval;
+    p | checkpointPath;
+    p | restartPath;
     p | diseasePath;
     p | interventionPath;
     p | outputPath;
+    p | cachePath;
     p | scenarioPath;
     p | isOnTheFlyRun;
     p | onTheFly;
@@ -13,6 +13,7 @@
 
 #include "../loimos.decl.h"
 #include "Preprocess.h"
+#include "Compression.h"
 #include "DataReader.h"
 #include "../Partitioner.h"
 #include "../Defs.h"
@@ -25,9 +26,12 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <tuple>
 #include <sstream>
+#include <cstdio>
 #include <sys/stat.h>
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
@@ -39,7 +43,7 @@
  */
 // TODO(IanCostello): Replace getline with function that doesn't need to copy to
 //                    string object in subfunctions.
-std::string buildCache(std::string scenarioPath,
+std::string buildCache(std::string scenarioPath, std::string cachePath,
     Id numPeople, const std::vector<Id> &personPartitionOffsets,
     Id numLocations, const std::vector<Id> &locationPartitionOffsets, int numDays) {
   PartitionId numPeopleChares = personPartitionOffsets.size();
@@ -50,21 +54,34 @@ std::string buildCache(std::string scenarioPath,
       numLocations, numLocationChares);
   CkPrintf("  Running with scenario id: %s\n", uniqueScenario.c_str());
 
+  // Compressed inputs also need an index of where each block starts
+  std::string peoplePath = resolveInputPath(scenarioPath + "people.csv");
+  std::string locationsPath = resolveInputPath(scenarioPath + "locations.csv");
+  std::string visitsPath = resolveInputPath(scenarioPath + "visits.csv");
+  for (std::string inputPath : {peoplePath, locationsPath, visitsPath}) {
+    if (isCompressedInput(inputPath)) {
+      buildBlockIndex(inputPath, getBlockIndexPath(inputPath, cachePath));
+    }
+  }
+
   // Build person and location cache.
+  uint64_t metadataHash = hashMetadata(scenarioPath);
   buildObjectLookupCache(numPeople, personPartitionOffsets,
-    scenarioPath + "people.textproto", scenarioPath + "people.csv",
-    scenarioPath + uniqueScenario + "_people.cache");
+    scenarioPath + "people.textproto", peoplePath,
+    cachePath + uniqueScenario + "_people.cache", metadataHash);
   buildObjectLookupCache(numLocations,
     locationPartitionOffsets, scenarioPath + "locations.textproto",
-    scenarioPath + "locations.csv", scenarioPath + uniqueScenario + "_locations.cache");
-  buildActivityCache(numLocations, numDays, locationPartitionOffsets[0],
-    scenarioPath + "visits.textproto", scenarioPath + "visits.csv",
-    scenarioPath + uniqueScenario + "_visits.cache");
+    locationsPath, cachePath + uniqueScenario + "_locations.cache",
+    metadataHash);
+  buildActivityCache(numLocations, numDays, locationPartitionOffsets,
+    scenarioPath + "visits.textproto", visitsPath,
+    cachePath + uniqueScenario + "_visits.cache", metadataHash);
   return uniqueScenario;
 }
 
 void buildObjectLookupCache(Id numObjs, const std::vector<Id> &offsets,
-  std::string metadataPath, std::string inputPath, std::string outputPath) {
+  std::string metadataPath, std::string inputPath, std::string outputPath,
+  uint64_t metadataHash) {
   /**
    * Assumptions: (about person file)
    * -- Contigious block of IDs that are sorted.
@@ -75,8 +92,20 @@ void buildObjectLookupCache(Id numObjs, const std::vector<Id> &offsets,
    * Returns:
    *    int offset of lowest contigious block.
    */
+  // Check if an up-to-date file cache was already created.
+  CacheHeader header = createCacheHeader(inputPath, offsets, 0, metadataHash);
+  if (isCacheValid(outputPath, header)) {
+    if (0 == CkMyNode()) {
+      CkPrintf("  Using existing object cache\n");
+    }
+    return;
+  }
+
   // Open activity stream..
-  std::ifstream activityStream(inputPath, std::ios_base::binary);
+  std::unique_ptr<std::istream> activityStream = openInput(inputPath);
+  if (!*activityStream) {
+    CkAbort("Error: Could not open %s\n", inputPath.c_str());
+  }
 
   // Read config file.
   loimos::proto::CSVDefinition csvDefinition;
@@ -93,56 +122,52 @@ void buildObjectLookupCache(Id numObjs, const std::vector<Id> &offsets,
 
   std::string line;
   // Clear header.
-  std::getline(activityStream, line);
-  CacheOffset currentPosition = activityStream.tellg();
-
-  // Check if file cache already created.
-  std::ifstream existenceCheck(outputPath, std::ios_base::binary);
-  if (existenceCheck.good()) {
-    if (0 == CkMyNode()) {
-      CkPrintf("  Using existing object cache\n");
-    }
-    existenceCheck.close();
+  std::getline(*activityStream, line);
+  CacheOffset currentPosition = activityStream->tellg();
 
-  } else {
-    CkPrintf("  Saving object cache to %s\n", outputPath.c_str());
-    existenceCheck.close();
-    std::ofstream outputStream(outputPath, std::ios_base::binary);
-    for (PartitionId p = 0; p < offsets.size(); p++) {
-      // Write current offset.
-      outputStream.write(reinterpret_cast<char *>(&currentPosition),
-        sizeof(CacheOffset));
-
-      // Skip next n lines.
-      // We already read the first location on the first chare to get
-      // its id, so don't double count that line
-      Id numObjs = getPartitionSize(p, numObjs, offsets);
-      // - (0 == p);
-      for (int i = 0; i < numObjs; i++) {
-        std::getline(activityStream, line);
-      }
-      currentPosition = activityStream.tellg();
+  CkPrintf("  Saving object cache to %s\n", outputPath.c_str());
+  std::ofstream outputStream(outputPath, std::ios_base::binary);
+  if (!outputStream) {
+    CkAbort("Error: Could not open cache file %s\n", outputPath.c_str());
+  }
+  outputStream.write(reinterpret_cast<const char *>(&header),
+    sizeof(CacheHeader));
+  for (PartitionId p = 0; p < offsets.size(); p++) {
+    // Write current offset.
+    outputStream.write(reinterpret_cast<char *>(&currentPosition),
+      sizeof(CacheOffset));
+
+    // Skip next n lines.
+    // We already read the first location on the first chare to get
+    // its id, so don't double count that line
+    Id numObjs = getPartitionSize(p, numObjs, offsets);
+    // - (0 == p);
+    for (int i = 0; i < numObjs; i++) {
+      std::getline(*activityStream, line);
     }
-    outputStream.flush();
+    currentPosition = activityStream->tellg();
   }
+  outputStream.flush();
 }
 
-void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
-  std::string metadataPath, std::string inputPath, std::string outputPath) {
+void buildActivityCache(Id numLocations, int numDays, const std::vector<Id> &offsets,
+  std::string metadataPath, std::string inputPath, std::string outputPath,
+  uint64_t metadataHash) {
   /**
    * Assumptions.
    * Stream is sorted by start time per person.
    */
-  // Check if cache already created.
-  std::ifstream existenceCheck(outputPath, std::ios_base::binary);
-  if (existenceCheck.good()) {
+  // Check if an up-to-date cache was already created.
+  CacheHeader header = createCacheHeader(inputPath, offsets, numDays,
+    metadataHash);
+  if (isCacheValid(outputPath, header)) {
     CkPrintf("  Using existing activity cache\n");
     return;
   }
   CkPrintf("  Saving activity cache to %s\n", outputPath.c_str());
 
-  std::ifstream activityStream(inputPath, std::ios_base::binary);
-  if (!activityStream) {
+  std::unique_ptr<std::istream> activityStream = openInput(inputPath);
+  if (!*activityStream) {
     CkAbort("Error: Could not open visit data input.\n");
   }
 
@@ -151,6 +176,7 @@ void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
   readProtobuf(metadataPath, &csvDefinition);
 
   // Create position vector for each person.
+  Id firstLocationIdx = offsets[0];
   std::size_t totalDataSize = numLocations * numDays * sizeof(CacheOffset);
   CacheOffset *elements = reinterpret_cast<CacheOffset *>(malloc(totalDataSize));
   if (NULL == elements) {
@@ -166,8 +192,8 @@ void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
   // Various initialization.
   std::string line;
   // Clear header.
-  std::getline(activityStream, line);
-  CacheOffset current_position = activityStream.tellg();
+  std::getline(*activityStream, line);
+  CacheOffset current_position = activityStream->tellg();
   Id lastLocation = -1;
   Time lastTime = -1;
   Id nextLocation = 0;
@@ -178,13 +204,13 @@ void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
   Id totalVisits = 0;
   // For better looping efficiency simulate one break of inner loop to start.
   std::tie(nextLocation, personId, nextTime, duration) =
-    parseActivityStream(&activityStream, &csvDefinition, NULL);
+    parseActivityStream(activityStream.get(), &csvDefinition, NULL);
   nextTimeSec = nextTime;
   nextTime = getDay(nextTime, firstDay);
 
   // Loop over the entire activity file and note boundaries on people and days
   Id numVisits = 0;
-  while (!activityStream.eof()) {
+  while (!activityStream->eof()) {
     // CkPrintf("Person %d has %d visits on day %d (next byte is %u)\n",
     //   lastPerson, numVisits, lastTime, current_position);
 
@@ -209,12 +235,12 @@ void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
     // }
 
     // Scan until the next boundary.
-    while (!activityStream.eof()
+    while (!activityStream->eof()
         && lastTime == nextTime
         && lastLocation == nextLocation) {
-      current_position = activityStream.tellg();
+      current_position = activityStream->tellg();
       std::tie(nextLocation, personId, nextTime, duration) =
-        parseActivityStream(&activityStream,
+        parseActivityStream(activityStream.get(),
             &csvDefinition, NULL);
 
       nextTime = getDay(nextTime, firstDay);
@@ -226,8 +252,138 @@ void buildActivityCache(Id numLocations, int numDays, Id firstLocationIdx,
 
   // Output
   std::ofstream outputStream(outputPath, std::ios::out | std::ios::binary);
+  if (!outputStream) {
+    CkAbort("Error: Could not open cache file %s\n", outputPath.c_str());
+  }
+  outputStream.write(reinterpret_cast<const char *>(&header),
+    sizeof(CacheHeader));
   outputStream.write(reinterpret_cast<const char *>(elements), totalDataSize);
   outputStream.close();
+  free(elements);
+}
+
+bool CacheHeader::operator==(const CacheHeader &rhs) const {
+  return magic == rhs.magic
+    && version == rhs.version
+    && inputSize == rhs.inputSize
+    && inputModifiedTime == rhs.inputModifiedTime
+    && inputHash == rhs.inputHash
+    && layoutHash == rhs.layoutHash;
+}
+
+bool CacheHeader::operator!=(const CacheHeader &rhs) const {
+  return !(*this == rhs);
+}
+
+/**
+ * 64-bit FNV-1a hash of size bytes starting at data, continuing from hash
+ * (pass FNV_OFFSET_BASIS to start a new hash)
+ */
+uint64_t hashBytes(const void *data, std::size_t size, uint64_t hash) {
+  const unsigned char *bytes = reinterpret_cast<const unsigned char *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/**
+ * Hashes the whole of each of the scenario's metadata files, since changing
+ * a column's type or the partition offsets changes how the inputs are read
+ * without changing the inputs themselves
+ */
+uint64_t hashMetadata(std::string scenarioPath) {
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (std::string name : {"people", "locations", "visits"}) {
+    std::ifstream metadataStream(scenarioPath + name + ".textproto",
+      std::ios_base::binary);
+    std::string metadata((std::istreambuf_iterator<char>(metadataStream)),
+      std::istreambuf_iterator<char>());
+    std::size_t size = metadata.size();
+    hash = hashBytes(&size, sizeof(std::size_t), hash);
+    hash = hashBytes(metadata.data(), size, hash);
+  }
+  return hash;
+}
+
+/**
+ * Fingerprints the file at inputPath, along with the partitioning and
+ * metadata used to build a cache from it. Rather than hashing the entire
+ * input (which can be tens of GB), we hash CACHE_HASH_NUM_BLOCKS evenly
+ * spaced blocks, which together with the size and modification time catches
+ * regenerated inputs
+ */
+CacheHeader createCacheHeader(std::string inputPath,
+    const std::vector<Id> &offsets, int numDays, uint64_t metadataHash) {
+  CacheHeader header;
+  memset(&header, 0, sizeof(CacheHeader));
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+
+  struct stat inputStat;
+  if (0 != stat(inputPath.c_str(), &inputStat)) {
+    CkAbort("Error: Could not stat %s\n", inputPath.c_str());
+  }
+  header.inputSize = inputStat.st_size;
+  header.inputModifiedTime = inputStat.st_mtime;
+
+  FILE *input = fopen(inputPath.c_str(), "rb");
+  if (NULL == input) {
+    CkAbort("Error: Could not open %s\n", inputPath.c_str());
+  }
+  std::vector<char> buf(CACHE_HASH_BLOCK_SIZE);
+  uint64_t hash = FNV_OFFSET_BASIS;
+  uint64_t stride = header.inputSize / CACHE_HASH_NUM_BLOCKS;
+  if (stride < CACHE_HASH_BLOCK_SIZE) {
+    // Small inputs are cheap enough to hash in full
+    std::size_t numRead;
+    while (0 < (numRead = fread(buf.data(), 1, buf.size(), input))) {
+      hash = hashBytes(buf.data(), numRead, hash);
+    }
+  } else {
+    for (int i = 0; i < CACHE_HASH_NUM_BLOCKS; ++i) {
+      fseeko(input, i * stride, SEEK_SET);
+      std::size_t numRead = fread(buf.data(), 1, buf.size(), input);
+      hash = hashBytes(buf.data(), numRead, hash);
+    }
+  }
+  fclose(input);
+  header.inputHash = hash;
+
+  hash = hashBytes(offsets.data(), offsets.size() * sizeof(Id),
+    FNV_OFFSET_BASIS);
+  hash = hashBytes(&numDays, sizeof(int), hash);
+  header.layoutHash = hashBytes(&metadataHash, sizeof(uint64_t), hash);
+  return header;
+}
+
+/**
+ * Returns whether the cache file at cachePath exists and was built from the
+ * same input and partitioning as described by expected
+ */
+bool isCacheValid(std::string cachePath, const CacheHeader &expected) {
+  std::ifstream cacheStream(cachePath, std::ios_base::binary);
+  if (!cacheStream) {
+    return false;
+  }
+
+  CacheHeader found;
+  cacheStream.read(reinterpret_cast<char *>(&found), sizeof(CacheHeader));
+  if (sizeof(CacheHeader) != cacheStream.gcount()) {
+    found.magic = 0;
+  }
+  cacheStream.close();
+
+  if (found != expected) {
+    CkPrintf("  Cache %s is out of date\n", cachePath.c_str());
+    return false;
+  }
+  return true;
+}
+
+CacheOffset getCacheEntryOffset(CacheOffset entry) {
+  return sizeof(CacheHeader) + entry * sizeof(CacheOffset);
 }
 
 int getDay(Time timeInSeconds, Time firstDay) {
@@ -247,14 +403,14 @@ std::string getScenarioId(Id numPeople, PartitionId numPeopleChares, Id numLocat
 }
 
 Id getFirstIndex(const loimos::proto::CSVDefinition *metadata, std::string inputPath) {
-  std::ifstream activityStream(inputPath, std::ios_base::binary);
+  std::unique_ptr<std::istream> activityStream = openInput(inputPath);
 
   // Skip header
   std::string line;
-  std::getline(activityStream, line);
+  std::getline(*activityStream, line);
 
   // Find the id column
-  std::getline(activityStream, line);
+  std::getline(*activityStream, line);
   char *str = strdup(line.c_str());
   char *tmp;
   char *tok = strtok_r(str, ",", &tmp);
@@ -15,16 +15,54 @@
 #include <string>
 #include <google/protobuf/text_format.h>
 
+#define CACHE_MAGIC 0x4548434143534f4cULL  // "LOSCACHE"
+#define CACHE_VERSION 2
+// Inputs are fingerprinted by hashing this many evenly spaced blocks, so
+// validating a cache costs a handful of reads regardless of input size
+#define CACHE_HASH_NUM_BLOCKS 16
+#define CACHE_HASH_BLOCK_SIZE 65536  // 2^16
+// Used to start a new hash with hashBytes
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+// Stamped at the start of every cache file so that stale caches (e.g. from
+// regenerating an input with the same number of rows) are detected and
+// rebuilt rather than silently used
+struct CacheHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t inputSize;
+  int64_t inputModifiedTime;
+  uint64_t inputHash;
+  // Covers the partition offsets (and number of days, for visit caches)
+  // used to build the cache, and the metadata describing the inputs
+  uint64_t layoutHash;
+
+  bool operator==(const CacheHeader &rhs) const;
+  bool operator!=(const CacheHeader &rhs) const;
+};
+
 // Main entry point.
-std::string buildCache(std::string scenarioPath,
+std::string buildCache(std::string scenarioPath, std::string cachePath,
     Id numPeople, const std::vector<Id> &personPartitionOffsets,
     Id numLocations, const std::vector<Id> &locationPartitionOffsets, int numDays);
 
 // Helper functions.
 void buildObjectLookupCache(Id numObjs, const std::vector<Id> &offsets,
-  std::string metadataPath, std::string inputPath, std::string outputPath);
-void buildActivityCache(Id numPeople, int numDays, Id firstPersonIdx,
-  std::string metadataPath, std::string inputPath, std::string outputPath);
+  std::string metadataPath, std::string inputPath, std::string outputPath,
+  uint64_t metadataHash);
+void buildActivityCache(Id numPeople, int numDays, const std::vector<Id> &offsets,
+  std::string metadataPath, std::string inputPath, std::string outputPath,
+  uint64_t metadataHash);
+
+// Cache validation
+uint64_t hashBytes(const void *data, std::size_t size, uint64_t hash);
+uint64_t hashMetadata(std::string scenarioPath);
+CacheHeader createCacheHeader(std::string inputPath,
+  const std::vector<Id> &offsets, int numDays, uint64_t metadataHash);
+bool isCacheValid(std::string cachePath, const CacheHeader &expected);
+// Returns the byte offset of the entry-th cache entry, skipping the header
+CacheOffset getCacheEntryOffset(CacheOffset entry);
 int getDay(Time timeInSeconds, Time firstDay);
 int getSeconds(Time day, Time firstDay);
 std::string getScenarioId(Id numPeople, PartitionId numPeopleChares, Id numLocations,
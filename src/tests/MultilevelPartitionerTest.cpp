@@ -0,0 +1,127 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../partitioning/MultilevelPartitioner.h"
+#include "../Types.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <vector>
+
+/** Tests the multilevel graph partitioner. */
+
+namespace {
+
+// Builds a graph from a list of undirected edges (each given once), with
+// unit edge weights and the given weights for each vertex
+Graph makeGraph(Id numVertices, const std::vector<std::pair<Id, Id> > &edges,
+    const std::vector<Id> &vertexWeights) {
+  std::vector<std::vector<Id> > adjacency(numVertices);
+  for (const std::pair<Id, Id> &edge : edges) {
+    adjacency[edge.first].push_back(edge.second);
+    adjacency[edge.second].push_back(edge.first);
+  }
+
+  Graph graph;
+  graph.numVertices = numVertices;
+  graph.offsets.push_back(0);
+  for (const std::vector<Id> &neighbors : adjacency) {
+    graph.neighbors.insert(graph.neighbors.end(), neighbors.begin(),
+      neighbors.end());
+    graph.offsets.push_back(graph.neighbors.size());
+  }
+  graph.edgeWeights.assign(graph.neighbors.size(), 1);
+  graph.vertexWeights = vertexWeights;
+  return graph;
+}
+
+// A width by height grid, with every vertex weighing 1 on each constraint
+Graph makeGrid(Id width, Id height) {
+  std::vector<std::pair<Id, Id> > edges;
+  for (Id y = 0; y < height; ++y) {
+    for (Id x = 0; x < width; ++x) {
+      Id v = y * width + x;
+      if (x + 1 < width) {
+        edges.emplace_back(v, v + 1);
+      }
+      if (y + 1 < height) {
+        edges.emplace_back(v, v + width);
+      }
+    }
+  }
+  return makeGraph(width * height, edges,
+    std::vector<Id>(width * height * NUM_PARTITION_CONSTRAINTS, 1));
+}
+
+// Checks that every vertex is assigned to a valid part, and that no part
+// is over its cap on any constraint
+void expectBalanced(const Graph &graph, PartitionId numParts,
+    const std::vector<PartitionId> &parts) {
+  ASSERT_EQ(static_cast<Id>(parts.size()), graph.numVertices);
+  std::vector<Id> totalWeights(NUM_PARTITION_CONSTRAINTS, 0);
+  std::vector<Id> partWeights(numParts * NUM_PARTITION_CONSTRAINTS, 0);
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    ASSERT_LE(0, parts[v]);
+    ASSERT_LT(parts[v], numParts);
+    for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+      totalWeights[c] += graph.getVertexWeight(v, c);
+      partWeights[parts[v] * NUM_PARTITION_CONSTRAINTS + c] +=
+        graph.getVertexWeight(v, c);
+    }
+  }
+
+  for (int c = 0; c < NUM_PARTITION_CONSTRAINTS; ++c) {
+    Id maxPartWeight = std::ceil(PARTITION_IMBALANCE_TOLERANCE
+      * totalWeights[c] / numParts);
+    for (PartitionId p = 0; p < numParts; ++p) {
+      EXPECT_LE(partWeights[p * NUM_PARTITION_CONSTRAINTS + c], maxPartWeight)
+        << "part " << p << ", constraint " << c;
+    }
+  }
+}
+
+TEST(MultilevelPartitionerTest, BalancesSmallGrid) {
+  /** Tests a graph small enough to be partitioned without coarsening. */
+  Graph graph = makeGrid(8, 8);
+  MultilevelPartitioner partitioner(4, 0);
+  std::vector<PartitionId> parts = partitioner.partition(graph);
+  expectBalanced(graph, 4, parts);
+
+  // Splitting the grid into quadrants cuts 16 edges; a decent partition
+  // shouldn't be much worse than that
+  EXPECT_LE(MultilevelPartitioner::getEdgeCut(graph, parts), 32);
+}
+
+TEST(MultilevelPartitionerTest, BalancesCoarsenedGrid) {
+  /** Tests a graph big enough to be coarsened several times. */
+  Graph graph = makeGrid(40, 40);
+  MultilevelPartitioner partitioner(8, 1);
+  std::vector<PartitionId> parts = partitioner.partition(graph);
+  expectBalanced(graph, 8, parts);
+  EXPECT_LT(MultilevelPartitioner::getEdgeCut(graph, parts),
+    static_cast<Id>(graph.neighbors.size()) / 2 / 4);
+}
+
+TEST(MultilevelPartitionerTest, RespectsEachConstraintsCap) {
+  /**
+   * Tests a grid whose second constraint is all on its left half, so that
+   * filling parts by their combined weight alone would give some of them
+   * far more than their share of it.
+   */
+  const Id width = 8;
+  Graph graph = makeGrid(width, width);
+  for (Id v = 0; v < graph.numVertices; ++v) {
+    graph.vertexWeights[v * NUM_PARTITION_CONSTRAINTS + 1] =
+      v % width < width / 2 ? 1 : 0;
+  }
+
+  for (int seed = 0; seed < 20; ++seed) {
+    MultilevelPartitioner partitioner(4, seed);
+    expectBalanced(graph, 4, partitioner.partition(graph));
+  }
+}
+
+}  // namespace
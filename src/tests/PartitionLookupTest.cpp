@@ -0,0 +1,100 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../Partitioner.h"
+#include "../Types.h"
+#include "gtest/gtest.h"
+
+#include <random>
+#include <vector>
+
+/** Tests that partition lookup tables agree with a full binary search. */
+
+namespace {
+
+// Checks the lookup against getPartition for the first and last indices,
+// the first index of each partition and the one before it, and a sample of
+// random indices in between
+void expectMatchesSearch(const std::vector<Id> &offsets, Id numObjects,
+    std::default_random_engine *generator) {
+  PartitionLookup lookup;
+  lookup.build(offsets, numObjects);
+
+  Id firstIndex = offsets.front();
+  Id lastIndex = firstIndex + numObjects - 1;
+  std::vector<Id> indices { firstIndex, lastIndex };
+  for (Id offset : offsets) {
+    if (offset <= lastIndex) {
+      indices.push_back(offset);
+    }
+    if (firstIndex < offset && offset <= lastIndex + 1) {
+      indices.push_back(offset - 1);
+    }
+  }
+  std::uniform_int_distribution<Id> indexDistribution(firstIndex, lastIndex);
+  for (int i = 0; i < 1000; ++i) {
+    indices.push_back(indexDistribution(*generator));
+  }
+
+  for (Id index : indices) {
+    EXPECT_EQ(lookup.getPartition(index), getPartition(index, offsets))
+      << "index " << index;
+  }
+}
+
+TEST(PartitionLookupTest, MatchesEvenPartitions) {
+  /** Tests equally sized partitions, starting from index 0. */
+  std::default_random_engine generator(0);
+  for (PartitionId numPartitions : {1, 2, 7, 64}) {
+    Id numObjects = 1000;
+    std::vector<Id> offsets;
+    for (PartitionId p = 0; p < numPartitions; ++p) {
+      offsets.push_back(getFirstIndex(p, numObjects, numPartitions, 0));
+    }
+    expectMatchesSearch(offsets, numObjects, &generator);
+  }
+}
+
+TEST(PartitionLookupTest, MatchesRandomPartitions) {
+  /**
+   * Tests random partition sizes (including empty partitions, and empty
+   * first and last partitions) with indices that don't start at 0.
+   */
+  std::default_random_engine generator(1);
+  std::uniform_int_distribution<PartitionId> numPartitionsDistribution(1, 100);
+  std::uniform_int_distribution<Id> firstIndexDistribution(0, 1000000);
+  std::uniform_int_distribution<int> skewDistribution(0, 3);
+  for (int trial = 0; trial < 200; ++trial) {
+    PartitionId numPartitions = numPartitionsDistribution(generator);
+    // Make some partitions tiny, some huge, and about a quarter empty
+    std::vector<Id> sizes(numPartitions);
+    for (Id &size : sizes) {
+      int skew = skewDistribution(generator);
+      std::uniform_int_distribution<Id> sizeDistribution(0,
+        0 == skew ? 0 : 1 << (4 * skew));
+      size = sizeDistribution(generator);
+    }
+    if (trial % 4 == 1) {
+      sizes.front() = 0;
+    } else if (trial % 4 == 2) {
+      sizes.back() = 0;
+    }
+
+    Id firstIndex = firstIndexDistribution(generator);
+    std::vector<Id> offsets;
+    Id numObjects = 0;
+    for (Id size : sizes) {
+      offsets.push_back(firstIndex + numObjects);
+      numObjects += size;
+    }
+    if (0 == numObjects) {
+      continue;
+    }
+    expectMatchesSearch(offsets, numObjects, &generator);
+  }
+}
+
+}  // namespace
@@ -0,0 +1,404 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/**
+ * Buffered, asynchronous writing of the optional simulation outputs
+ * (exposures, state transitions and visit overlaps). Rather than each chare
+ * formatting a CSV line and flushing it to its own file for every record,
+ * chares copy fixed-width binary records into a per-PE ring buffer, and a
+ * background thread on each node drains these buffers into one file per
+ * output type using large sequential writes, whenever one of them fills up
+ * past halfway (and at the end of each day, in collective mode). In
+ * collective mode, the nodes instead share a single file per output type,
+ * with each day's records from each node written to a disjoint range of
+ * that file.
+ */
+
+#include "OutputWriter.h"
+#include "../Defs.h"
+#include "charm++.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *streamNames[NUM_OUTPUT_STREAMS] = {
+  "exposures", "transitions", "interactions"
+};
+static const int streamFlags[NUM_OUTPUT_STREAMS] = {
+  OUTPUT_EXPOSURES, OUTPUT_TRANSITIONS, OUTPUT_OVERLAPS
+};
+static const uint32_t recordSizes[NUM_OUTPUT_STREAMS] = {
+  sizeof(ExposureRecord), sizeof(TransitionRecord), sizeof(OverlapRecord)
+};
+
+static void writeAll(int fd, const void *data, std::size_t size) {
+  const char *bytes = reinterpret_cast<const char *>(data);
+  while (0 < size) {
+    ssize_t result = ::write(fd, bytes, size);
+    if (0 > result) {
+      CkAbort("Error: failed to write simulation output\n");
+    }
+    bytes += result;
+    size -= result;
+  }
+}
+
+static void writeAllAt(int fd, const void *data, std::size_t size,
+    CacheOffset offset) {
+  const char *bytes = reinterpret_cast<const char *>(data);
+  while (0 < size) {
+    ssize_t result = ::pwrite(fd, bytes, size, offset);
+    if (0 > result) {
+      CkAbort("Error: failed to write simulation output\n");
+    }
+    bytes += result;
+    size -= result;
+    offset += result;
+  }
+}
+
+/**
+ * Writes the header for the given stream to fd, returning its size
+ */
+static CacheOffset writeHeader(int fd, int stream,
+    const std::vector<std::string> &stateLabels, double sampleRate) {
+  // Only transitions need the state labels to be interpreted
+  OutputHeader header;
+  memset(&header, 0, sizeof(OutputHeader));
+  header.magic = OUTPUT_MAGIC;
+  header.version = OUTPUT_VERSION;
+  header.stream = stream;
+  header.recordSize = recordSizes[stream];
+  header.numLabels = TRANSITION_STREAM == stream ? stateLabels.size() : 0;
+  // Transitions are never sampled
+  header.weight = TRANSITION_STREAM == stream ? 1.0 : 1.0 / sampleRate;
+  writeAll(fd, &header, sizeof(OutputHeader));
+  CacheOffset size = sizeof(OutputHeader);
+  for (uint32_t i = 0; i < header.numLabels; ++i) {
+    uint32_t length = stateLabels[i].size();
+    writeAll(fd, &length, sizeof(uint32_t));
+    writeAll(fd, stateLabels[i].data(), length);
+    size += sizeof(uint32_t) + length;
+  }
+  return size;
+}
+
+RecordRing::RecordRing(std::size_t capacity) : data(capacity), head(0),
+    tail(0) {}
+
+bool RecordRing::push(const void *record, std::size_t size) {
+  std::size_t currentHead = head.load(std::memory_order_relaxed);
+  if (data.size() - (currentHead - tail.load(std::memory_order_acquire))
+      < size) {
+    return false;
+  }
+
+  // Records may wrap around the end of the buffer
+  std::size_t start = currentHead % data.size();
+  std::size_t firstPart = std::min(size, data.size() - start);
+  std::memcpy(data.data() + start, record, firstPart);
+  std::memcpy(data.data(), reinterpret_cast<const char *>(record) + firstPart,
+    size - firstPart);
+  head.store(currentHead + size, std::memory_order_release);
+  return true;
+}
+
+bool RecordRing::filledPastHalf(std::size_t size) const {
+  std::size_t used = head.load(std::memory_order_relaxed)
+    - tail.load(std::memory_order_acquire);
+  std::size_t half = data.size() / 2;
+  return used >= half && used - size < half;
+}
+
+std::size_t RecordRing::drain(int fd) {
+  std::size_t currentTail = tail.load(std::memory_order_relaxed);
+  std::size_t size = head.load(std::memory_order_acquire) - currentTail;
+  if (0 == size) {
+    return 0;
+  }
+
+  std::size_t start = currentTail % data.size();
+  std::size_t firstPart = std::min(size, data.size() - start);
+  writeAll(fd, data.data() + start, firstPart);
+  writeAll(fd, data.data(), size - firstPart);
+  tail.store(currentTail + size, std::memory_order_release);
+  return size;
+}
+
+std::size_t RecordRing::drain(std::vector<char> *buffer) {
+  std::size_t currentTail = tail.load(std::memory_order_relaxed);
+  std::size_t size = head.load(std::memory_order_acquire) - currentTail;
+  if (0 == size) {
+    return 0;
+  }
+
+  std::size_t start = currentTail % data.size();
+  std::size_t firstPart = std::min(size, data.size() - start);
+  buffer->insert(buffer->end(), data.data() + start,
+    data.data() + start + firstPart);
+  buffer->insert(buffer->end(), data.data(), data.data() + size - firstPart);
+  tail.store(currentTail + size, std::memory_order_release);
+  return size;
+}
+
+OutputWriter::OutputWriter(std::string outputPath, int outputFlags,
+    const std::vector<std::string> &stateLabels, bool isCollective_,
+    double sampleRate_, int seed) :
+    isCollective(isCollective_), sampleRate(std::min(sampleRate_, 1.0)),
+    // 2^64 times the sample rate (only used when the rate is less than 1)
+    sampleThreshold(1.0 > sampleRate ? sampleRate * 18446744073709551616.0 : 0),
+    sampleSeed(mixBits(seed)), paths(NUM_OUTPUT_STREAMS),
+    files(NUM_OUTPUT_STREAMS, -1),
+    indexFiles(NUM_OUTPUT_STREAMS, -1), fileSizes(NUM_OUTPUT_STREAMS, 0),
+    rings(NUM_OUTPUT_STREAMS), isClosing(false), hasWork(false),
+    staged(NUM_OUTPUT_STREAMS) {
+  // In collective mode, node 0 is responsible for the parts of each file
+  // which aren't output records
+  bool isLeader = !isCollective || 0 == CkMyNode();
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    if (0 == (outputFlags & streamFlags[stream])) {
+      continue;
+    }
+
+    std::string &path = paths[stream];
+    path = outputPath + streamNames[stream];
+    if (!isCollective) {
+      path += "_node_" + std::to_string(CkMyNode());
+    }
+    path += ".bin";
+
+    // Other nodes only open the shared files once node 0 has created them
+    // (see writeDay)
+    if (isLeader) {
+      files[stream] = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (0 > files[stream]) {
+        CkAbort("Error: unable to open output file %s\n", path.c_str());
+      }
+      fileSizes[stream] = writeHeader(files[stream], stream, stateLabels,
+        sampleRate);
+    }
+    if (isCollective && isLeader) {
+      std::string indexPath = outputPath + streamNames[stream] + ".index";
+      indexFiles[stream] = open(indexPath.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (0 > indexFiles[stream]) {
+        CkAbort("Error: unable to open output file %s\n", indexPath.c_str());
+      }
+    }
+
+    for (int rank = 0; rank < CkMyNodeSize(); ++rank) {
+      rings[stream].emplace_back(new RecordRing(OUTPUT_RING_SIZE));
+    }
+  }
+
+  writerThread = std::thread(&OutputWriter::run, this);
+}
+
+OutputWriter::~OutputWriter() {
+  close();
+}
+
+bool OutputWriter::getIsCollective() const {
+  return isCollective;
+}
+
+/**
+ * Empties every ring, either straight into the output files or (in
+ * collective mode, where stagingLock must be held) into the staging buffers
+ */
+std::size_t OutputWriter::drainRings() {
+  std::size_t numDrained = 0;
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    for (std::unique_ptr<RecordRing> &ring : rings[stream]) {
+      numDrained += isCollective ? ring->drain(&staged[stream])
+        : ring->drain(files[stream]);
+    }
+  }
+  return numDrained;
+}
+
+void OutputWriter::wakeWriter() {
+  {
+    std::lock_guard<std::mutex> guard(wakeLock);
+    hasWork = true;
+  }
+  writerWakeup.notify_one();
+}
+
+/**
+ * Waits for the writer thread to free up enough space in ring for the
+ * given record, and then pushes it
+ */
+void OutputWriter::waitToPush(RecordRing *ring, const void *record,
+    std::size_t size) {
+  std::unique_lock<std::mutex> lock(wakeLock);
+  hasWork = true;
+  writerWakeup.notify_one();
+  spaceFreed.wait(lock, [&] { return ring->push(record, size); });
+}
+
+std::vector<CacheOffset> OutputWriter::finishDay(int day) {
+  std::vector<CacheOffset> sizes(NUM_OUTPUT_STREAMS * CkNumNodes(), 0);
+  std::lock_guard<std::mutex> guard(stagingLock);
+
+  // Every record from today has been pushed by now, so this picks up
+  // anything the writer thread hasn't gotten to yet
+  drainRings();
+  std::vector<std::vector<char> > &dayData = finishedDays[day];
+  dayData.swap(staged);
+  staged.assign(NUM_OUTPUT_STREAMS, std::vector<char>());
+
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    sizes[stream * CkNumNodes() + CkMyNode()] = dayData[stream].size();
+  }
+  return sizes;
+}
+
+std::vector<CacheOffset> OutputWriter::allocateDay(int day,
+    const CacheOffset *sizes) {
+  std::vector<CacheOffset> offsets(NUM_OUTPUT_STREAMS * CkNumNodes(), 0);
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    if (0 > files[stream]) {
+      continue;
+    }
+
+    OutputIndexEntry entry;
+    memset(&entry, 0, sizeof(OutputIndexEntry));
+    entry.day = day;
+    entry.offset = fileSizes[stream];
+
+    // Each node's output goes right after the previous node's
+    for (int node = 0; node < CkNumNodes(); ++node) {
+      int i = stream * CkNumNodes() + node;
+      offsets[i] = fileSizes[stream];
+      fileSizes[stream] += sizes[i];
+    }
+
+    entry.numRecords = (fileSizes[stream] - entry.offset) / recordSizes[stream];
+    writeAll(indexFiles[stream], &entry, sizeof(OutputIndexEntry));
+  }
+  return offsets;
+}
+
+void OutputWriter::writeDay(int day, const CacheOffset *offsets) {
+  std::vector<CacheOffset> nodeOffsets(NUM_OUTPUT_STREAMS);
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    nodeOffsets[stream] = offsets[stream * CkNumNodes() + CkMyNode()];
+
+    // Node 0 creates (and truncates) the shared files before it ever
+    // assigns anyone offsets in them, so they're safe to open by now
+    if (!paths[stream].empty() && 0 > files[stream]) {
+      files[stream] = open(paths[stream].c_str(), O_WRONLY);
+      if (0 > files[stream]) {
+        CkAbort("Error: unable to open output file %s\n",
+          paths[stream].c_str());
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(stagingLock);
+    pendingWrites.emplace_back(day, nodeOffsets);
+  }
+  wakeWriter();
+}
+
+/**
+ * Writes out each finished day this node has been assigned offsets for
+ */
+std::size_t OutputWriter::writePendingDays() {
+  std::size_t numWritten = 0;
+  while (true) {
+    std::vector<std::vector<char> > dayData;
+    std::vector<CacheOffset> offsets;
+    {
+      std::lock_guard<std::mutex> guard(stagingLock);
+      if (pendingWrites.empty()) {
+        break;
+      }
+      int day = pendingWrites.front().first;
+      offsets.swap(pendingWrites.front().second);
+      dayData.swap(finishedDays[day]);
+      finishedDays.erase(day);
+      pendingWrites.pop_front();
+    }
+
+    for (std::size_t stream = 0; stream < dayData.size(); ++stream) {
+      if (!dayData[stream].empty()) {
+        writeAllAt(files[stream], dayData[stream].data(),
+          dayData[stream].size(), offsets[stream]);
+        numWritten += dayData[stream].size();
+      }
+    }
+  }
+  return numWritten;
+}
+
+void OutputWriter::run() {
+  while (true) {
+    // Check this before draining, so that we don't miss any records pushed
+    // between our last drain and close() being called
+    bool closing = isClosing.load(std::memory_order_acquire);
+
+    std::size_t numWritten = 0;
+    if (isCollective) {
+      {
+        std::lock_guard<std::mutex> guard(stagingLock);
+        numWritten += drainRings();
+      }
+      numWritten += writePendingDays();
+    } else {
+      numWritten += drainRings();
+    }
+
+    if (0 < numWritten) {
+      // Taking the lock means any PE waiting for space is either already
+      // asleep or will see the space we just freed
+      wakeLock.lock();
+      wakeLock.unlock();
+      spaceFreed.notify_all();
+    } else if (closing) {
+      break;
+    } else {
+      std::unique_lock<std::mutex> lock(wakeLock);
+      writerWakeup.wait(lock, [this] {
+        return hasWork || isClosing.load(std::memory_order_acquire);
+      });
+      hasWork = false;
+    }
+  }
+}
+
+void OutputWriter::close() {
+  if (!writerThread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(wakeLock);
+    isClosing.store(true, std::memory_order_release);
+  }
+  writerWakeup.notify_one();
+  writerThread.join();
+
+  for (int stream = 0; stream < NUM_OUTPUT_STREAMS; ++stream) {
+    if (0 <= indexFiles[stream]) {
+      // Only node 0 knows how long the shared file should be
+      if (0 != ftruncate(files[stream], fileSizes[stream])) {
+        CkAbort("Error: failed to write simulation output\n");
+      }
+      ::close(indexFiles[stream]);
+      indexFiles[stream] = -1;
+    }
+    if (0 <= files[stream]) {
+      ::close(files[stream]);
+      files[stream] = -1;
+    }
+  }
+}
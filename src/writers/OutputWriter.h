@@ -0,0 +1,223 @@
+/* Copyright 2020-2024 The Loimos Project Developers.
+ * See the top-level LICENSE file for details.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef WRITERS_OUTPUTWRITER_H_
+#define WRITERS_OUTPUTWRITER_H_
+
+#include "../Types.h"
+#include "charm++.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define OUTPUT_MAGIC 0x54554f534d494f4cULL  // "LOIMSOUT"
+#define OUTPUT_VERSION 3
+// Size of the buffer each PE fills for each type of output
+#define OUTPUT_RING_SIZE (1 << 22)  // 4 MiB
+
+enum OutputStream {
+  EXPOSURE_STREAM,
+  TRANSITION_STREAM,
+  OVERLAP_STREAM,
+  NUM_OUTPUT_STREAMS
+};
+
+// Each output file starts with this header, followed (for transitions) by
+// numLabels state labels, each written as a uint32_t length followed by
+// that many characters, and then by fixed-width records until the end of
+// the file. See scripts/analysis/convert_output.py to convert these to CSV
+struct OutputHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t stream;
+  uint32_t recordSize;
+  uint32_t numLabels;
+  // How many records each record in this file stands for, i.e. the inverse
+  // of the probability each record was sampled with
+  double weight;
+};
+
+// In collective mode, each shared output file has an accompanying index
+// file holding one of these for each day, so readers can seek by day
+struct OutputIndexEntry {
+  int32_t day;
+  uint32_t padding;
+  // Where this day's records start in the output file
+  uint64_t offset;
+  uint64_t numRecords;
+};
+
+// Records are packed so that their layout on disk is independent of the
+// compiler's choice of padding
+#pragma pack(push, 1)
+struct ExposureRecord {
+  static const OutputStream stream = EXPOSURE_STREAM;
+  int32_t day;
+  Id susceptibleIdx;
+  Id infectiousIdx;
+  Time startTime;
+  Time endTime;
+  double propensity;
+};
+
+struct TransitionRecord {
+  static const OutputStream stream = TRANSITION_STREAM;
+  int32_t day;
+  Id personIdx;
+  int32_t exitState;
+  // Both are -1 unless this transition is an infection
+  Id contactIdx;
+  Time contactStartTime;
+};
+
+struct OverlapRecord {
+  static const OutputStream stream = OVERLAP_STREAM;
+  int32_t day;
+  Id locationIdx;
+  // The person whose departure ended the overlap...
+  Id personIdx;
+  Time arrivalTime;
+  Time departureTime;
+  // ...and the person they overlapped with
+  Id otherIdx;
+  Time otherArrivalTime;
+  Time otherDepartureTime;
+};
+#pragma pack(pop)
+
+// Lock-free byte queue with a single producer (the PE it belongs to) and a
+// single consumer (the writer thread)
+class RecordRing {
+ private:
+  std::vector<char> data;
+  // Total number of bytes ever pushed and written out, respectively
+  std::atomic<std::size_t> head;
+  std::atomic<std::size_t> tail;
+
+ public:
+  explicit RecordRing(std::size_t capacity);
+  // Returns false (without pushing anything) if there isn't enough space
+  bool push(const void *record, std::size_t size);
+  // Whether the last push, of size bytes, filled the ring past halfway
+  bool filledPastHalf(std::size_t size) const;
+  // Writes everything currently in the ring to fd, returning the number of
+  // bytes written
+  std::size_t drain(int fd);
+  // As above, but appends everything to buffer instead
+  std::size_t drain(std::vector<char> *buffer);
+};
+
+// Collects the simulation outputs from every PE on this node, and writes
+// them out from a background thread, so that chares never wait on the file
+// system. By default, each node writes one file per output type. In
+// collective mode, all nodes share one file per output type instead: each
+// node holds on to its records until the end of the day, and then writes
+// them at the offset it was assigned by a prefix sum over every node's
+// output for that day (see allocateDay)
+class OutputWriter {
+ private:
+  const bool isCollective;
+  // Exposures and overlaps are each kept with this probability
+  const double sampleRate;
+  const uint64_t sampleThreshold;
+  const uint64_t sampleSeed;
+  // Empty for streams which aren't being written
+  std::vector<std::string> paths;
+  std::vector<int> files;
+  // Only used in collective mode, and only on node 0
+  std::vector<int> indexFiles;
+  std::vector<CacheOffset> fileSizes;
+  // Indexed by stream and then by rank within this node
+  std::vector<std::vector<std::unique_ptr<RecordRing> > > rings;
+  std::thread writerThread;
+  std::atomic<bool> isClosing;
+
+  // The writer thread sleeps until a ring is filled past halfway, a day is
+  // finished or written, or we're closing. PEs whose rings are full sleep
+  // until the writer thread has drained something
+  std::mutex wakeLock;
+  std::condition_variable writerWakeup;
+  std::condition_variable spaceFreed;
+  bool hasWork;
+
+  // In collective mode, records drained from the rings wait here until the
+  // end of the day, when they are moved into finishedDays until we know
+  // where to write them
+  std::mutex stagingLock;
+  std::vector<std::vector<char> > staged;
+  std::map<int, std::vector<std::vector<char> > > finishedDays;
+  std::deque<std::pair<int, std::vector<CacheOffset> > > pendingWrites;
+
+  std::size_t drainRings();
+  std::size_t writePendingDays();
+  void wakeWriter();
+  void waitToPush(RecordRing *ring, const void *record, std::size_t size);
+  void run();
+
+ public:
+  OutputWriter(std::string outputPath, int outputFlags,
+    const std::vector<std::string> &stateLabels, bool isCollective,
+    double sampleRate, int seed);
+  ~OutputWriter();
+
+  // Decides whether to keep the exposure or overlap between the given people
+  // on the given day. This only depends on the seed and its arguments, so
+  // the same records are sampled regardless of how the run is decomposed
+  bool isSampled(int day, Id firstIdx, Id secondIdx) const {
+    if (1.0 <= sampleRate) {
+      return true;
+    }
+    uint64_t hash = mixBits(sampleSeed ^ mixBits(static_cast<uint64_t>(day)
+      ^ mixBits(static_cast<uint64_t>(firstIdx)
+      ^ mixBits(static_cast<uint64_t>(secondIdx)))));
+    return hash < sampleThreshold;
+  }
+
+  // SplitMix64 finalizer
+  static uint64_t mixBits(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  bool getIsCollective() const;
+  // Collective mode only. Sets aside everything written on this node so far
+  // as the given day's output, returning how many bytes there are of each
+  // type of output, laid out so that a reduction over all nodes yields
+  // sizes indexed by stream * CkNumNodes() + node
+  std::vector<CacheOffset> finishDay(int day);
+  // Collective mode only, called on node 0. Takes the result of the above
+  // reduction and assigns each node the offsets in each shared file at
+  // which to write its output for the day (laid out in the same way)
+  std::vector<CacheOffset> allocateDay(int day, const CacheOffset *sizes);
+  // Collective mode only. Queues this node's output for the given day to be
+  // written at the offsets assigned to it by allocateDay (opening the
+  // shared files the first time, on nodes other than node 0)
+  void writeDay(int day, const CacheOffset *offsets);
+
+  template <class R>
+  void write(const R &record) {
+    RecordRing *ring = rings[R::stream][CkMyRank()].get();
+    if (!ring->push(&record, sizeof(R))) {
+      waitToPush(ring, &record, sizeof(R));
+    } else if (ring->filledPastHalf(sizeof(R))) {
+      wakeWriter();
+    }
+  }
+
+  // Writes out anything still buffered and closes the output files
+  void close();
+};
+
+#endif  // WRITERS_OUTPUTWRITER_H_